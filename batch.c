@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "conf.h"
+#include "game.h"
+#include "mem.h"
+#include "pool.h"
+#include "swallow.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * Batched stepping for agents that play many games at once. All games live
+ * in one array and share the parsed level read-only; the per-step input is
+ * fed in through the bot interface, so a batch game runs exactly the code a
+ * tournament game does. Stepping allocates nothing itself: observations go
+ * straight into the caller's arrays. The build also produces libswallow.so
+ * so the API can be used from other languages.
+ */
+
+static int batch_key(const BotView* view, void* state) {
+    (void)view;
+    return *(const int*)state;
+}
+
+static void start_env(Batch* batch, const int index) {
+    Game* game = &batch->games[index];
+
+    game->replay.tick = 0;
+    game->config.seed = batch->config.seed + index + (batch->episodes[index] * batch->count);
+    batch->episodes[index]++;
+    prepare_game(game);
+}
+
+static void mark_cells(const Batch* batch, const Game* game, unsigned char* grid,
+                       const entity_t* ent, const collision_t kind) {
+    const int top = ent->y * batch->grid_rows / game->arena_rows;
+    const int bottom = (ent->y + ent->height - 1) * batch->grid_rows / game->arena_rows;
+    const int left = ent->x * batch->grid_cols / game->arena_cols;
+    const int right = (ent->x + ent->width - 1) * batch->grid_cols / game->arena_cols;
+
+    for (int row = top < 0 ? 0 : top; row <= bottom && row < batch->grid_rows; row++) {
+        memset(grid + (row * batch->grid_cols) + left, kind, (size_t)(right - left + 1));
+    }
+}
+
+/**
+ * observe - Writes one environment's observation
+ * @batch: the batch
+ * @index: environment index
+ *
+ * The grid is rasterised from the entity lists rather than sampled from the
+ * occupancy map, so it costs the number of entities, not the arena size.
+ * Hunters are drawn last: a cell shared with a star reads as a hunter.
+ *
+ * RETURNS
+ * Void.
+ */
+static void observe(Batch* batch, const int index) {
+    const Game* game = &batch->games[index];
+    BatchObservation* obs = batch->obs;
+    const int cells = batch->grid_rows * batch->grid_cols;
+    unsigned char* grid = obs->grids + ((size_t)index * (size_t)cells);
+
+    memset(grid, EMPTY, (size_t)cells);
+    for (int row = 0; row < batch->grid_rows; row++) {
+        grid[row * batch->grid_cols] = WALL;
+        grid[(row * batch->grid_cols) + batch->grid_cols - 1] = WALL;
+    }
+    memset(grid, WALL, (size_t)batch->grid_cols);
+    memset(grid + cells - batch->grid_cols, WALL, (size_t)batch->grid_cols);
+
+    for (const Star* st = game->entities.stars; st; st = st->next) {
+        mark_cells(batch, game, grid, &st->ent, STAR);
+    }
+    if (game->taxi.active) {
+        entity_t taxi;
+        albatross_taxi_entity(game, &taxi);
+        mark_cells(batch, game, grid, &taxi, SWALLOW);
+    } else {
+        mark_cells(batch, game, grid, &game->entities.swallow->ent, SWALLOW);
+    }
+    for (const Hunter* hu = game->entities.hunters; hu; hu = hu->next) {
+        mark_cells(batch, game, grid, &hu->ent, HUNTER);
+    }
+
+    obs->hp[index] = game->entities.swallow->hp;
+    obs->time_left[index] = game->time_left;
+    obs->stars[index] = game->stars_collected;
+}
+
+static void step_env(void* ctx, const int index) {
+    Batch* batch = (Batch*)ctx;
+    Game* game = &batch->games[index];
+
+    batch->keys[index] = batch->step_keys ? batch->step_keys[index] : 0;
+    simulate_tick(game);
+
+    batch->obs->done[index] = !game->running;
+    if (!game->running) {
+        batch->obs->final_score[index] = game->score;
+        release_game(game);
+        start_env(batch, index);
+    }
+    observe(batch, index);
+}
+
+static void reset_env(void* ctx, const int index) {
+    Batch* batch = (Batch*)ctx;
+
+    release_game(&batch->games[index]);
+    start_env(batch, index);
+    batch->obs->done[index] = 0;
+    observe(batch, index);
+}
+
+static void init_env(Batch* batch, const int index) {
+    Game* game = &batch->games[index];
+
+    game->replay.fd = -1;
+    game->replay.replay_state = REPLAY_OFF;
+    game->config = batch->config;
+    size_windows(&game->main_win, &game->status_win, &game->config);
+    game->bot = &batch->input;
+    game->bot_state = &batch->keys[index];
+    start_env(batch, index);
+}
+
+/**
+ * batch_create - Sets up @count games of one level
+ * @level_path: level file to play
+ * @count: number of environments
+ * @threads: threads to step on, 0 for one per core
+ * @grid_rows: rows of each observation grid
+ * @grid_cols: columns of each observation grid
+ *
+ * Environment i plays seed level.seed + i on its first episode and moves
+ * on by @count every episode, so no two episodes of a batch share a seed.
+ *
+ * RETURNS
+ * The batch, or NULL if the level cannot be read or a size is not positive.
+ */
+Batch* batch_create(const char* level_path, const int count, const int threads,
+                    const int grid_rows, const int grid_cols) {
+    size_t level_size = 0;
+    char* level_data = read_file_contents(level_path, &level_size);
+    if (!level_data || count <= 0 || grid_rows <= 0 || grid_cols <= 0) {
+        free(level_data);
+        return NULL;
+    }
+
+    Batch* batch = (Batch*)calloc(1, sizeof(Batch));
+    if (!batch) {
+        exit(1);
+    }
+    batch->config = read_config_data(level_data, level_size);
+    free(level_data);
+    batch->count = count;
+    batch->grid_rows = grid_rows;
+    batch->grid_cols = grid_cols;
+    batch->input.key = batch_key;
+    batch->games = (Game*)calloc((size_t)count, sizeof(Game));
+    batch->keys = (int*)calloc((size_t)count, sizeof(int));
+    batch->episodes = (int*)calloc((size_t)count, sizeof(int));
+    if (!batch->games || !batch->keys || !batch->episodes) {
+        exit(1);
+    }
+
+    for (int i = 0; i < count; i++) {
+        init_env(batch, i);
+    }
+    pool_start(&batch->pool, threads);
+    return batch;
+}
+
+/**
+ * batch_reset - Starts a new episode in every environment
+ * @batch: the batch
+ * @obs: receives the first observation of every environment
+ *
+ * RETURNS
+ * Void.
+ */
+void batch_reset(Batch* batch, BatchObservation* obs) {
+    batch->obs = obs;
+    pool_run(&batch->pool, reset_env, batch, batch->count);
+}
+
+/**
+ * batch_step - Advances every environment by one tick
+ * @batch: the batch
+ * @keys: one key per environment (0 for none), or NULL for no input at all
+ * @obs: receives the observations; finished environments are reset
+ *
+ * RETURNS
+ * Void.
+ */
+void batch_step(Batch* batch, const int* keys, BatchObservation* obs) {
+    batch->step_keys = keys;
+    batch->obs = obs;
+    pool_run(&batch->pool, step_env, batch, batch->count);
+}
+
+void batch_destroy(Batch* batch) {
+    if (!batch) {
+        return;
+    }
+    pool_stop(&batch->pool);
+    for (int i = 0; i < batch->count; i++) {
+        release_game(&batch->games[i]);
+        mem_free(batch->games[i].entities.swallow);
+    }
+    free_config(&batch->config);
+    free(batch->games);
+    free(batch->keys);
+    free(batch->episodes);
+    free(batch);
+}
@@ -0,0 +1,11 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "types.h"
+
+Batch* batch_create(const char* level_path, int count, int threads, int grid_rows, int grid_cols);
+void batch_reset(Batch* batch, BatchObservation* obs);
+void batch_step(Batch* batch, const int* keys, BatchObservation* obs);
+void batch_destroy(Batch* batch);
+
+#endif  // BATCH_H
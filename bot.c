@@ -0,0 +1,109 @@
+#include <ctype.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bot.h"
+#include "types.h"
+
+/*
+ * Bots replace the keyboard: once per tick the bot gets a read-only view of
+ * the game and returns the key a player would have pressed (or 0 for none),
+ * which then goes through the same path as a key read from the terminal.
+ * The host is linked with -rdynamic, so bots may call the simulation's own
+ * helpers such as occupancy_get().
+ */
+
+static void* bot_symbol(void* handle, const char* name) {
+    dlerror();
+    void* symbol = dlsym(handle, name);
+    return dlerror() ? NULL : symbol;
+}
+
+static char* bot_name(const char* path) {
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    const char* dot = strrchr(base, '.');
+    return strndup(base, dot ? (size_t)(dot - base) : strlen(base));
+}
+
+/**
+ * bot_load - Loads a bot plug-in
+ * @bot: receives the entry points
+ * @path: shared object to load; a bare file name is looked up in the
+ *        current directory rather than the library path
+ *
+ * RETURNS
+ * 0 on success, -1 (with a message on stderr) if the object cannot be loaded
+ * or was built against another BOT_API_VERSION.
+ */
+int bot_load(BotPlugin* bot, const char* path) {
+    char* local = NULL;
+    memset(bot, 0, sizeof(*bot));
+    if (!strchr(path, '/') && asprintf(&local, "./%s", path) < 0) {
+        exit(1);
+    }
+    bot->handle = dlopen(local ? local : path, RTLD_NOW | RTLD_LOCAL);
+    free(local);
+    if (!bot->handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        return -1;
+    }
+
+    const unsigned int* api = (const unsigned int*)bot_symbol(bot->handle, "swallow_bot_api");
+    void* key = bot_symbol(bot->handle, "swallow_bot_key");
+    if (!api || *api != BOT_API_VERSION || !key) {
+        fprintf(stderr, "%s: not a swallow bot for API version %d\n", path, BOT_API_VERSION);
+        dlclose(bot->handle);
+        bot->handle = NULL;
+        return -1;
+    }
+    void* init = bot_symbol(bot->handle, "swallow_bot_init");
+    void* free_state = bot_symbol(bot->handle, "swallow_bot_free");
+    // ISO C has no object to function pointer cast; copying the bits is the POSIX idiom.
+    memcpy((void*)&bot->key, (void*)&key, sizeof(key));
+    memcpy((void*)&bot->init, (void*)&init, sizeof(init));
+    memcpy((void*)&bot->free, (void*)&free_state, sizeof(free_state));
+    bot->name = bot_name(path);
+    return 0;
+}
+
+void bot_unload(BotPlugin* bot) {
+    if (bot->handle) {
+        dlclose(bot->handle);
+    }
+    free(bot->name);
+    memset(bot, 0, sizeof(*bot));
+}
+
+void bot_view(const Game* game, BotView* view) {
+    view->tick = game->replay.tick;
+    view->arena_rows = game->arena_rows;
+    view->arena_cols = game->arena_cols;
+    view->swallow = &game->entities.swallow->ent;
+    view->hp = game->entities.swallow->hp;
+    view->hunters = game->entities.hunters;
+    view->stars = game->entities.stars;
+    view->occupancy_map = &game->occupancy_map;
+    view->stars_collected = game->stars_collected;
+    view->star_quota = game->config.star_quota;
+    view->game_speed = game->game_speed;
+    view->time_left = game->time_left;
+    view->albatross_cooldown = game->albatross_cooldown;
+    view->taxi_active = game->taxi.active;
+}
+
+/**
+ * bot_next_key - Asks the game's bot for this tick's key
+ * @game: Main game struct (game->bot must be set)
+ *
+ * RETURNS
+ * The lowercase key, or ERR if the bot does not press one.
+ */
+int bot_next_key(Game* game) {
+    BotView view;
+    bot_view(game, &view);
+    const int ch = game->bot->key(&view, game->bot_state);
+    return ch > 0 ? tolower(ch) : ERR;
+}
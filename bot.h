@@ -0,0 +1,11 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "types.h"
+
+int bot_load(BotPlugin* bot, const char* path);
+void bot_unload(BotPlugin* bot);
+void bot_view(const Game* game, BotView* view);
+int bot_next_key(Game* game);
+
+#endif  // BOT_H
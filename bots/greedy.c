@@ -0,0 +1,73 @@
+#include <stdlib.h>
+
+#include "types.h"
+
+/*
+ * Example bot: heads for the nearest star along the axis with the larger
+ * distance, and sidesteps when a hunter is about to cross its path. Build
+ * with `make bots` and run with `./swallow --tournament bots/greedy.so`.
+ */
+
+const unsigned int swallow_bot_api = BOT_API_VERSION;
+
+#define GREEDY_DANGER_DISTANCE 4
+
+static int centre_x(const entity_t* ent) {
+    return ent->x + (ent->width / 2);
+}
+
+static int centre_y(const entity_t* ent) {
+    return ent->y + (ent->height / 2);
+}
+
+static int distance(const entity_t* a, const entity_t* b) {
+    return abs(centre_x(a) - centre_x(b)) + abs(centre_y(a) - centre_y(b));
+}
+
+static int key_towards(const entity_t* from, const entity_t* to) {
+    const int dx = centre_x(to) - centre_x(from);
+    const int dy = centre_y(to) - centre_y(from);
+
+    if (abs(dx) >= abs(dy)) {
+        return dx < 0 ? 'a' : 'd';
+    }
+    return dy < 0 ? 'w' : 's';
+}
+
+static int key_away(const entity_t* from, const entity_t* threat) {
+    // Step sideways relative to the threat, which clears it fastest.
+    if (abs(centre_x(threat) - centre_x(from)) >= abs(centre_y(threat) - centre_y(from))) {
+        return centre_y(threat) < centre_y(from) ? 's' : 'w';
+    }
+    return centre_x(threat) < centre_x(from) ? 'd' : 'a';
+}
+
+/**
+ * swallow_bot_key - Picks this tick's key
+ * @view: the game as of the start of the tick
+ * @state: unused, the bot keeps no state
+ *
+ * RETURNS
+ * The key to press, or 0 for none.
+ */
+int swallow_bot_key(const BotView* view, void* state) {
+    (void)state;
+    const entity_t* self = view->swallow;
+
+    if (view->taxi_active) {
+        return 0;
+    }
+    for (const Hunter* hu = view->hunters; hu; hu = hu->next) {
+        if (distance(self, &hu->ent) <= GREEDY_DANGER_DISTANCE + hu->ent.width + hu->ent.height) {
+            return key_away(self, &hu->ent);
+        }
+    }
+
+    const Star* nearest = NULL;
+    for (const Star* st = view->stars; st; st = st->next) {
+        if (!nearest || distance(self, &st->ent) < distance(self, &nearest->ent)) {
+            nearest = st;
+        }
+    }
+    return nearest ? key_towards(self, &nearest->ent) : 0;
+}
@@ -0,0 +1,380 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "broadcast.h"
+#include "buffer.h"
+#include "graphics.h"
+#include "mem.h"
+#include "swallow.h"
+#include "types.h"
+
+/*
+ * Live games are broadcast to spectators through a shared-memory ring. Each
+ * tick the drawn entities are diffed against what was last published and the
+ * changes (spawns, moves, new looks, removals, status values) are appended as
+ * one record. Every SPECTATE_KEYFRAME_TICKS a keyframe with the full picture
+ * is written instead; late joiners and readers that fell a whole ring behind
+ * start from the latest one. The game never learns who is watching, so a
+ * tick costs the same with no spectators as with many.
+ */
+
+static uint64_t float_bits(const float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/**
+ * open_ring_name - Creates a shared-memory object no one else uses yet
+ * @name: receives its name
+ *
+ * Names carry the pid, so only a ring left behind by a crashed process
+ * that had the same pid can be in the way; such a ring is left alone and
+ * the next suffix is tried.
+ *
+ * RETURNS
+ * The descriptor, or -1 if none could be created.
+ */
+static int open_ring_name(char* name) {
+    const int pid = (int)getpid();
+    int fd = -1;
+
+    for (int i = 0; fd < 0 && i < SPECTATE_NAME_ATTEMPTS; i++) {
+        if (i == 0) {
+            snprintf(name, SPECTATE_NAME_LENGTH, "%s%d", SPECTATE_SHM_PREFIX, pid);
+        } else {
+            snprintf(name, SPECTATE_NAME_LENGTH, "%s%d-%d", SPECTATE_SHM_PREFIX, pid, i);
+        }
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (fd < 0 && errno != EEXIST) {
+            break;
+        }
+    }
+    return fd;
+}
+
+static SpectateRing* create_ring(Broadcast* bc) {
+    const int fd = open_ring_name(bc->shm_name);
+    if (fd < 0) {
+        bc->shm_name[0] = '\0';
+        return NULL;
+    }
+    void* mem = MAP_FAILED;
+    if (ftruncate(fd, sizeof(SpectateRing)) == 0) {
+        mem = mmap(NULL, sizeof(SpectateRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        shm_unlink(bc->shm_name);
+        bc->shm_name[0] = '\0';
+        return NULL;
+    }
+
+    SpectateRing* ring = (SpectateRing*)mem;
+    memcpy(ring->magic, SPECTATE_MAGIC, sizeof(ring->magic));
+    ring->version = SPECTATE_VERSION;
+    ring->pid = (int32_t)getpid();
+    ring->uid = (uint32_t)getuid();
+    return ring;
+}
+
+static void copy_in(SpectateRing* ring, const uint64_t pos, const unsigned char* data,
+                    const size_t len) {
+    const size_t offset = (size_t)(pos % SPECTATE_RING_BYTES);
+    const size_t first = len < SPECTATE_RING_BYTES - offset ? len : SPECTATE_RING_BYTES - offset;
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, data + first, len - first);
+}
+
+/**
+ * ring_write - Appends a record to the ring
+ * @ring: the shared ring
+ * @rec: record ops
+ * @keyframe: whether readers may start at this record
+ *
+ * reserved is moved past the record before any byte is overwritten, so a
+ * reader that copied bytes the writer was about to reuse can tell.
+ *
+ * RETURNS
+ * Void.
+ */
+static void ring_write(SpectateRing* ring, const ByteBuffer* rec, const int keyframe) {
+    if (rec->len + sizeof(uint32_t) > SPECTATE_MAX_RECORD) {
+        return;
+    }
+
+    const uint32_t len = (uint32_t)rec->len;
+    const unsigned char header[sizeof(uint32_t)] = {len & 0xFF, (len >> 8) & 0xFF,
+                                                    (len >> 16) & 0xFF, len >> 24};
+    const uint64_t pos = atomic_load_explicit(&ring->committed, memory_order_relaxed);
+    const uint64_t end = pos + sizeof(header) + len;
+
+    atomic_store_explicit(&ring->reserved, end, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    copy_in(ring, pos, header, sizeof(header));
+    copy_in(ring, pos + sizeof(header), rec->data, len);
+    atomic_store_explicit(&ring->committed, end, memory_order_release);
+    if (keyframe) {
+        atomic_store_explicit(&ring->keyframe, pos, memory_order_release);
+    }
+}
+
+static void reserve_entities(Broadcast* bc, const int count) {
+    if (count <= bc->capacity) {
+        return;
+    }
+
+    int capacity = bc->capacity ? bc->capacity : SPECTATE_INITIAL_ENTITIES;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    const size_t size = sizeof(BroadcastEntity) * (size_t)capacity;
+    BroadcastEntity* shadow = mem_realloc(MEM_BROADCAST, bc->shadow, size);
+    BroadcastEntity* current = mem_realloc(MEM_BROADCAST, bc->current, size);
+    if (!shadow || !current) {
+        exit(1);
+    }
+    bc->shadow = shadow;
+    bc->current = current;
+    bc->capacity = capacity;
+}
+
+static void add_entity(Broadcast* bc, int* count, const entity_t* ent, const uint32_t id,
+                       const int layer) {
+    reserve_entities(bc, *count + 1);
+    const FrameSprite sprite = frame_sprite(ent);
+    bc->current[(*count)++] = (BroadcastEntity){id,           sprite.x,      sprite.y,
+                                                sprite.width, sprite.height, sprite.sprite,
+                                                sprite.color, layer};
+}
+
+static int compare_entities(const void* a, const void* b) {
+    const uint32_t x = ((const BroadcastEntity*)a)->id;
+    const uint32_t y = ((const BroadcastEntity*)b)->id;
+    return (x > y) - (x < y);
+}
+
+/**
+ * collect_entities - Lists what is drawn this tick in bc->current
+ * @game: Main game struct
+ * @bc: broadcast state
+ *
+ * Sorted by entity id, which is the order diff_entities walks both lists in.
+ *
+ * RETURNS
+ * The number of entities listed.
+ */
+static int collect_entities(const Game* game, Broadcast* bc) {
+    int count = 0;
+    for (const Star* st = game->entities.stars; st; st = st->next) {
+        add_entity(bc, &count, &st->ent, st->ent.id, 0);
+    }
+    for (const Hunter* hu = game->entities.hunters; hu; hu = hu->next) {
+        add_entity(bc, &count, &hu->ent, hu->ent.id, 0);
+    }
+    if (game->taxi.active) {
+        entity_t taxi;
+        albatross_taxi_entity(game, &taxi);
+        add_entity(bc, &count, &taxi, SPECTATE_TAXI_ID, 1);
+    } else {
+        const entity_t* swallow = &game->entities.swallow->ent;
+        add_entity(bc, &count, swallow, swallow->id, 1);
+    }
+    qsort(bc->current, (size_t)count, sizeof(BroadcastEntity), compare_entities);
+    return count;
+}
+
+static void put_reset(ByteBuffer* rec, const Game* game) {
+    const char* username = game->username ? game->username : "";
+    const size_t len = strlen(username);
+
+    buffer_put_u8(rec, SPECTATE_OP_RESET);
+    buffer_put_varint(rec, (uint64_t)game->config.window_width);
+    buffer_put_varint(rec, (uint64_t)game->config.window_height);
+    buffer_put_varint(rec, (uint64_t)game->config.level_nr);
+    buffer_put_varint(rec, (uint64_t)game->config.star_quota);
+    buffer_put_varint(rec, (uint64_t)game->practice);
+    buffer_put_varint(rec, len);
+    buffer_put_bytes(rec, username, len);
+}
+
+static void put_status(ByteBuffer* rec, Broadcast* bc, const Game* game, const int keyframe) {
+    uint64_t now[SPECTATE_STATUS_FIELDS];
+    now[SPECTATE_HP] = (uint64_t)game->entities.swallow->hp;
+    now[SPECTATE_STARS] = (uint64_t)game->stars_collected;
+    now[SPECTATE_SPEED] = (uint64_t)game->game_speed;
+    now[SPECTATE_SCORE] = (uint64_t)game->score;
+    now[SPECTATE_TIME_LEFT] = float_bits(game->time_left);
+    now[SPECTATE_COOLDOWN] = float_bits(game->albatross_cooldown);
+    now[SPECTATE_REWIND_SECONDS] = float_bits((float)game->rewind.count * (float)TICK_BASE_US /
+                                              1000000.0F / (float)game->game_speed);
+    now[SPECTATE_CAMERA_X] = (uint64_t)game->camera_x;
+    now[SPECTATE_CAMERA_Y] = (uint64_t)game->camera_y;
+
+    uint64_t mask = 0;
+    for (int i = 0; i < SPECTATE_STATUS_FIELDS; i++) {
+        if (keyframe || now[i] != bc->status[i]) {
+            mask |= 1ULL << i;
+        }
+    }
+    if (mask == 0) {
+        return;
+    }
+    buffer_put_u8(rec, SPECTATE_OP_STATUS);
+    buffer_put_varint(rec, mask);
+    for (int i = 0; i < SPECTATE_STATUS_FIELDS; i++) {
+        if (mask & (1ULL << i)) {
+            buffer_put_varint(rec, now[i]);
+        }
+    }
+    memcpy(bc->status, now, sizeof(now));
+}
+
+static void put_look(ByteBuffer* rec, const BroadcastEntity* ent) {
+    buffer_put_varint(rec, (uint64_t)ent->width);
+    buffer_put_varint(rec, (uint64_t)ent->height);
+    buffer_put_varint(rec, (uint64_t)ent->color);
+    buffer_put_bytes(rec, ent->sprite, (size_t)ent->width * (size_t)ent->height);
+}
+
+static void put_spawn(ByteBuffer* rec, const BroadcastEntity* ent) {
+    buffer_put_u8(rec, SPECTATE_OP_SPAWN);
+    buffer_put_varint(rec, ent->id);
+    buffer_put_varint(rec, (uint64_t)ent->layer);
+    buffer_put_svarint(rec, ent->x);
+    buffer_put_svarint(rec, ent->y);
+    put_look(rec, ent);
+}
+
+static void put_changes(ByteBuffer* rec, const BroadcastEntity* old, const BroadcastEntity* cur) {
+    if (old->x != cur->x || old->y != cur->y) {
+        buffer_put_u8(rec, SPECTATE_OP_MOVE);
+        buffer_put_varint(rec, cur->id);
+        buffer_put_svarint(rec, cur->x);
+        buffer_put_svarint(rec, cur->y);
+    }
+    if (old->sprite != cur->sprite || old->color != cur->color || old->width != cur->width ||
+        old->height != cur->height) {
+        buffer_put_u8(rec, SPECTATE_OP_LOOK);
+        buffer_put_varint(rec, cur->id);
+        put_look(rec, cur);
+    }
+}
+
+static void diff_entities(ByteBuffer* rec, const Broadcast* bc, const int count) {
+    int i = 0;
+    int j = 0;
+
+    while (i < bc->shadow_count || j < count) {
+        const BroadcastEntity* old = i < bc->shadow_count ? &bc->shadow[i] : NULL;
+        const BroadcastEntity* cur = j < count ? &bc->current[j] : NULL;
+
+        if (cur == NULL || (old != NULL && old->id < cur->id)) {
+            buffer_put_u8(rec, SPECTATE_OP_REMOVE);
+            buffer_put_varint(rec, old->id);
+            i++;
+        } else if (old == NULL || cur->id < old->id) {
+            put_spawn(rec, cur);
+            j++;
+        } else {
+            put_changes(rec, old, cur);
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * broadcast_begin - Starts broadcasting a live game
+ * @game: Main game struct
+ *
+ * The ring is created the first time a game is broadcast and kept for the
+ * life of the process; it is the only one this process ever unlinks. Does
+ * nothing unless broadcasting was enabled.
+ *
+ * RETURNS
+ * Void.
+ */
+void broadcast_begin(Game* game) {
+    Broadcast* bc = &game->broadcast;
+    if (!bc->enabled) {
+        return;
+    }
+    if (bc->ring == NULL) {
+        bc->ring = create_ring(bc);
+        if (bc->ring == NULL) {
+            bc->enabled = 0;
+            return;
+        }
+    }
+    memset(bc->ring->username, 0, sizeof(bc->ring->username));
+    if (game->username) {
+        strncpy(bc->ring->username, game->username, MAX_USERNAME_LENGTH - 1);
+    }
+    bc->record.tag = MEM_BROADCAST;
+    bc->ticks = 0;
+    bc->shadow_count = 0;
+    atomic_store_explicit(&bc->ring->live, 1, memory_order_release);
+}
+
+/**
+ * broadcast_tick - Publishes what changed during the last tick
+ * @game: Main game struct
+ *
+ * RETURNS
+ * Void.
+ */
+void broadcast_tick(Game* game) {
+    Broadcast* bc = &game->broadcast;
+    if (bc->ring == NULL) {
+        return;
+    }
+
+    const int keyframe = bc->ticks % SPECTATE_KEYFRAME_TICKS == 0;
+    const int count = collect_entities(game, bc);
+    ByteBuffer* rec = &bc->record;
+
+    rec->len = 0;
+    if (keyframe) {
+        put_reset(rec, game);
+        bc->shadow_count = 0;
+    }
+    put_status(rec, bc, game, keyframe);
+    diff_entities(rec, bc, count);
+    buffer_put_u8(rec, SPECTATE_OP_END);
+    ring_write(bc->ring, rec, keyframe);
+
+    BroadcastEntity* shadow = bc->shadow;
+    bc->shadow = bc->current;
+    bc->current = shadow;
+    bc->shadow_count = count;
+    bc->ticks++;
+}
+
+void broadcast_end(Game* game) {
+    if (game->broadcast.ring) {
+        atomic_store_explicit(&game->broadcast.ring->live, 0, memory_order_release);
+    }
+}
+
+void broadcast_close(Broadcast* bc) {
+    if (bc->ring) {
+        munmap(bc->ring, sizeof(SpectateRing));
+        shm_unlink(bc->shm_name);
+        bc->ring = NULL;
+    }
+    mem_free(bc->shadow);
+    mem_free(bc->current);
+    bc->shadow = NULL;
+    bc->current = NULL;
+    bc->shadow_count = 0;
+    bc->capacity = 0;
+    buffer_free(&bc->record);
+}
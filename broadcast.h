@@ -0,0 +1,11 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+
+#include "types.h"
+
+void broadcast_begin(Game* game);
+void broadcast_tick(Game* game);
+void broadcast_end(Game* game);
+void broadcast_close(Broadcast* bc);
+
+#endif  // BROADCAST_H
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "mem.h"
+#include "types.h"
+
+/*
+ * Growable byte buffers and a bounds-checked reader for the binary formats
+ * (replays, snapshots). Integers are written as unsigned LEB128 varints,
+ * signed ones zigzag-encoded first, and fixed 64-bit values little endian.
+ * Reading past the end sets reader->error and returns zeroes, so decoders can
+ * check for truncation once at the end instead of after every field.
+ * Buffer storage is a tracked allocation charged to buf->tag.
+ */
+
+void buffer_reserve(ByteBuffer* buf, const size_t extra) {
+    if (buf->len + extra <= buf->cap) {
+        return;
+    }
+
+    size_t new_cap = buf->cap ? buf->cap : BUFFER_INITIAL_CAPACITY;
+    while (new_cap < buf->len + extra) {
+        new_cap *= 2;
+    }
+
+    unsigned char* new_ptr = (unsigned char*)mem_realloc(buf->tag, buf->data, new_cap);
+    if (new_ptr == NULL) {
+        exit(1);
+    }
+    buf->data = new_ptr;
+    buf->cap = new_cap;
+}
+
+void buffer_put_u8(ByteBuffer* buf, const unsigned int value) {
+    buffer_reserve(buf, 1);
+    buf->data[buf->len++] = (unsigned char)value;
+}
+
+void buffer_put_varint(ByteBuffer* buf, uint64_t value) {
+    buffer_reserve(buf, MAX_VARINT_BYTES);
+    while (value >= 0x80) {
+        buf->data[buf->len++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    buf->data[buf->len++] = (unsigned char)value;
+}
+
+void buffer_put_svarint(ByteBuffer* buf, const int64_t value) {
+    buffer_put_varint(buf, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+void buffer_put_u64(ByteBuffer* buf, const uint64_t value) {
+    buffer_reserve(buf, sizeof(value));
+    for (size_t i = 0; i < sizeof(value); i++) {
+        buf->data[buf->len++] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+void buffer_put_bytes(ByteBuffer* buf, const void* data, const size_t size) {
+    buffer_reserve(buf, size);
+    memcpy(buf->data + buf->len, data, size);
+    buf->len += size;
+}
+
+void buffer_free(ByteBuffer* buf) {
+    mem_free(buf->data);
+    buf->data = NULL;
+    buf->len = 0;
+    buf->cap = 0;
+}
+
+unsigned int reader_get_u8(ByteReader* reader) {
+    if (reader->pos >= reader->len) {
+        reader->error = 1;
+        return 0;
+    }
+    return reader->data[reader->pos++];
+}
+
+uint64_t reader_get_varint(ByteReader* reader) {
+    uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (reader->pos >= reader->len) {
+            break;
+        }
+        const unsigned char byte = reader->data[reader->pos++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    reader->error = 1;
+    return 0;
+}
+
+int64_t reader_get_svarint(ByteReader* reader) {
+    const uint64_t value = reader_get_varint(reader);
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+uint64_t reader_get_u64(ByteReader* reader) {
+    const unsigned char* bytes = reader_get_bytes(reader, sizeof(uint64_t));
+    uint64_t value = 0;
+    if (bytes == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(value); i++) {
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+const unsigned char* reader_get_bytes(ByteReader* reader, const size_t size) {
+    if (reader->pos > reader->len || size > reader->len - reader->pos) {
+        reader->error = 1;
+        return NULL;
+    }
+    const unsigned char* bytes = reader->data + reader->pos;
+    reader->pos += size;
+    return bytes;
+}
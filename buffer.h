@@ -0,0 +1,20 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include "types.h"
+
+void buffer_reserve(ByteBuffer* buf, size_t extra);
+void buffer_put_u8(ByteBuffer* buf, unsigned int value);
+void buffer_put_varint(ByteBuffer* buf, uint64_t value);
+void buffer_put_svarint(ByteBuffer* buf, int64_t value);
+void buffer_put_u64(ByteBuffer* buf, uint64_t value);
+void buffer_put_bytes(ByteBuffer* buf, const void* data, size_t size);
+void buffer_free(ByteBuffer* buf);
+
+unsigned int reader_get_u8(ByteReader* reader);
+uint64_t reader_get_varint(ByteReader* reader);
+int64_t reader_get_svarint(ByteReader* reader);
+uint64_t reader_get_u64(ByteReader* reader);
+const unsigned char* reader_get_bytes(ByteReader* reader, size_t size);
+
+#endif  // BUFFER_H
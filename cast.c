@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "cast.h"
+#include "drawlist.h"
+#include "game.h"
+#include "headless.h"
+#include "mem.h"
+#include "render.h"
+#include "replay.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * Replays are exported to asciicast v2 recordings without a terminal. The
+ * replay is played back headless on a virtual clock that advances by one
+ * tick duration per tick; frames are taken at the game's render rate, drawn
+ * into a cell grid the way draw_frame() lays them out, and only the cells
+ * that changed since the previous frame are written, stamped with the
+ * virtual time. Nothing sleeps, so an export runs at simulation speed.
+ */
+
+enum {
+    BOX_HORIZONTAL = 0x2500,
+    BOX_VERTICAL = 0x2502,
+    BOX_TOP_LEFT = 0x250C,
+    BOX_TOP_RIGHT = 0x2510,
+    BOX_BOTTOM_LEFT = 0x2514,
+    BOX_BOTTOM_RIGHT = 0x2518
+};
+
+static void put_text(ByteBuffer* out, const char* text) {
+    buffer_put_bytes(out, text, strlen(text));
+}
+
+static void put_utf8(ByteBuffer* out, const unsigned int ch) {
+    if (ch < 0x80) {
+        buffer_put_u8(out, ch);
+    } else if (ch < 0x800) {
+        buffer_put_u8(out, 0xC0 | (ch >> 6));
+        buffer_put_u8(out, 0x80 | (ch & 0x3F));
+    } else {
+        buffer_put_u8(out, 0xE0 | (ch >> 12));
+        buffer_put_u8(out, 0x80 | ((ch >> 6) & 0x3F));
+        buffer_put_u8(out, 0x80 | (ch & 0x3F));
+    }
+}
+
+static void write_json_string(FILE* file, const unsigned char* data, const size_t len) {
+    fputc('"', file);
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '"' || data[i] == '\\') {
+            fputc('\\', file);
+            fputc(data[i], file);
+        } else if (data[i] < 0x20) {
+            fprintf(file, "\\u%04x", data[i]);
+        } else {
+            fputc(data[i], file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void set_cell(CastWriter* w, const int row, const int col, const unsigned int ch,
+                     const int color, const int bold) {
+    if (row < 0 || row >= w->rows || col < 0 || col >= w->cols) {
+        return;
+    }
+    CastCell* cell = &w->cells[(row * w->cols) + col];
+    cell->ch = (uint16_t)ch;
+    cell->color = ch == ' ' ? 0 : (uint8_t)color;
+    cell->bold = ch == ' ' ? 0 : (uint8_t)bold;
+}
+
+static void put_box(CastWriter* w, const WIN* area) {
+    const int bottom = area->y + area->rows - 1;
+    const int right = area->x + area->cols - 1;
+    for (int x = area->x + 1; x < right; x++) {
+        set_cell(w, area->y, x, BOX_HORIZONTAL, C_GREY_1, 0);
+        set_cell(w, bottom, x, BOX_HORIZONTAL, C_GREY_1, 0);
+    }
+    for (int y = area->y + 1; y < bottom; y++) {
+        set_cell(w, y, area->x, BOX_VERTICAL, C_GREY_1, 0);
+        set_cell(w, y, right, BOX_VERTICAL, C_GREY_1, 0);
+    }
+    set_cell(w, area->y, area->x, BOX_TOP_LEFT, C_GREY_1, 0);
+    set_cell(w, area->y, right, BOX_TOP_RIGHT, C_GREY_1, 0);
+    set_cell(w, bottom, area->x, BOX_BOTTOM_LEFT, C_GREY_1, 0);
+    set_cell(w, bottom, right, BOX_BOTTOM_RIGHT, C_GREY_1, 0);
+}
+
+static void put_line(CastWriter* w, const WIN* area, const int line, const char* text) {
+    for (int i = 0; text[i] && CAST_STATUS_COL + i < area->cols - 1; i++) {
+        set_cell(w, area->y + line, area->x + CAST_STATUS_COL + i, (unsigned char)text[i], 0, 1);
+    }
+}
+
+/**
+ * put_status - Draws the status window of a frame
+ * @w: export state
+ * @area: status window
+ * @f: the frame
+ *
+ * Mirrors the lines draw_status() shows while playing; the playback,
+ * practice and bandwidth notes of the live view do not apply to a recording.
+ *
+ * RETURNS
+ * Void.
+ */
+static void put_status(CastWriter* w, const WIN* area, const Frame* f) {
+    char text[MAX_LINE_LENGTH];
+
+    put_box(w, area);
+    snprintf(text, sizeof(text), "Player: %s | Level %-2d | Life-force: %-3d", f->username,
+             f->level_nr, f->hp);
+    put_line(w, area, 1, text);
+    snprintf(text, sizeof(text), "Stars collected: %-3d | Star Quota: %-3d | Time left: %.1f ",
+             f->stars_collected, f->star_quota, f->time_left);
+    put_line(w, area, 2, text);
+    snprintf(text, sizeof(text), "Game speed: %-3d", f->game_speed);
+    put_line(w, area, 3, text);
+    snprintf(text, sizeof(text), "Taxi cooldown: %-4.1f", f->albatross_cooldown);
+    put_line(w, area, 4, text);
+    snprintf(text, sizeof(text), "Score: %-10d", f->score);
+    put_line(w, area, 5, text);
+}
+
+static void build_screen(CastWriter* w, const Game* game) {
+    for (int i = 0; i < w->rows * w->cols; i++) {
+        w->cells[i] = (CastCell){' ', 0, 0};
+    }
+    render_capture(game, &w->frame);
+    put_box(w, &game->main_win);
+    draw_list_build(&w->list, &game->main_win, &w->frame);
+    for (int i = 0; i < w->list.count; i++) {
+        const DrawSpan* span = &w->list.spans[i];
+        for (int c = 0; c < span->len; c++) {
+            set_cell(w, game->main_win.y + span->row, game->main_win.x + span->col + c,
+                     (unsigned char)span->text[c], span->color, 0);
+        }
+    }
+    put_status(w, &game->status_win, &w->frame);
+}
+
+static void put_pen(CastWriter* w, const CastCell* cell) {
+    const int pen = (cell->bold << 8) | cell->color;
+    if (pen == w->pen) {
+        return;
+    }
+    char sgr[32];
+    if (cell->color) {
+        snprintf(sgr, sizeof(sgr), "\x1b[0%s;38;5;%dm", cell->bold ? ";1" : "",
+                 pair_color((ColorPair)cell->color));
+    } else {
+        snprintf(sgr, sizeof(sgr), "\x1b[0%sm", cell->bold ? ";1" : "");
+    }
+    put_text(&w->out, sgr);
+    w->pen = pen;
+}
+
+/**
+ * diff_screen - Appends the output that turns the shown screen into the new one
+ * @w: export state
+ *
+ * Runs of changed cells are written with a single cursor move.
+ *
+ * RETURNS
+ * Void.
+ */
+static void diff_screen(CastWriter* w) {
+    int cursor = -1;
+    for (int i = 0; i < w->rows * w->cols; i++) {
+        const CastCell* cell = &w->cells[i];
+        if (memcmp(cell, &w->shown[i], sizeof(*cell)) == 0) {
+            continue;
+        }
+        if (i != cursor) {
+            char move[32];
+            snprintf(move, sizeof(move), "\x1b[%d;%dH", (i / w->cols) + 1, (i % w->cols) + 1);
+            put_text(&w->out, move);
+        }
+        put_pen(w, cell);
+        put_utf8(&w->out, cell->ch);
+        w->shown[i] = *cell;
+        // The cursor stays put after the last column, so a row change needs a move.
+        cursor = (i + 1) % w->cols ? i + 1 : -1;
+    }
+}
+
+static void write_event(CastWriter* w, const uint64_t time_us) {
+    if (w->out.len == 0) {
+        return;
+    }
+    fprintf(w->file, "[%llu.%06llu, \"o\", ", (unsigned long long)(time_us / 1000000),
+            (unsigned long long)(time_us % 1000000));
+    write_json_string(w->file, w->out.data, w->out.len);
+    fputs("]\n", w->file);
+    w->out.len = 0;
+}
+
+static void cast_begin(CastWriter* w, const Game* game, FILE* file) {
+    memset(w, 0, sizeof(*w));
+    w->file = file;
+    w->out.tag = MEM_RENDER;
+    w->rows = game->status_win.y + game->status_win.rows;
+    w->cols = game->main_win.cols;
+    w->cells = (CastCell*)calloc((size_t)w->rows * (size_t)w->cols, sizeof(CastCell));
+    w->shown = (CastCell*)calloc((size_t)w->rows * (size_t)w->cols, sizeof(CastCell));
+    if (!w->cells || !w->shown) {
+        exit(1);
+    }
+    for (int i = 0; i < w->rows * w->cols; i++) {
+        w->shown[i] = (CastCell){' ', 0, 0};
+    }
+
+    const ReplayFileHeader* header = &game->replay.header;
+    char title[MAX_LINE_LENGTH];
+    snprintf(title, sizeof(title), "Swallow level %d - %s", header->level_nr, header->username);
+    fprintf(file, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld, ",
+            w->cols, w->rows, (long long)header->timestamp);
+    fputs("\"env\": {\"TERM\": \"xterm-256color\"}, \"title\": ", file);
+    write_json_string(file, (const unsigned char*)title, strlen(title));
+    fputs("}\n", file);
+    put_text(&w->out, "\x1b[?25l\x1b[0m\x1b[2J\x1b[H");
+}
+
+static void cast_end(CastWriter* w, const uint64_t time_us) {
+    put_text(&w->out, "\x1b[0m\x1b[?25h");
+    w->pen = 0;
+    write_event(w, time_us);
+    free(w->cells);
+    free(w->shown);
+    mem_free(w->frame.sprites);
+    draw_list_free(&w->list);
+    buffer_free(&w->out);
+}
+
+/**
+ * export_game - Plays an opened replay back into a recording
+ * @game: game whose replay is open and whose playback has started
+ * @file: recording to write
+ *
+ * Like the live game a frame is taken when at least 1/render_fps seconds
+ * passed since the last one, plus the first and the final tick.
+ *
+ * RETURNS
+ * Void.
+ */
+static void export_game(Game* game, FILE* file) {
+    const int fps = game->config.render_fps > 0 ? game->config.render_fps : DEFAULT_RENDER_FPS;
+    const uint64_t frame_us = 1000000U / (unsigned int)fps;
+    CastWriter w;
+    uint64_t now = 0;
+    uint64_t last_frame = 0;
+
+    game->username = game->replay.header.username;
+    cast_begin(&w, game, file);
+    while (game->running) {
+        simulate_tick(game);
+        follow_camera(game);
+        if (now == 0 || now - last_frame >= frame_us || !game->running) {
+            build_screen(&w, game);
+            diff_screen(&w);
+            write_event(&w, now);
+            last_frame = now;
+        }
+        now += tick_duration_us(game);
+    }
+    cast_end(&w, now);
+    game->username = NULL;
+}
+
+/**
+ * cast_export - Exports a replay to an asciicast v2 recording
+ * @replay_path: replay to export
+ * @cast_path: recording to write
+ *
+ * RETURNS
+ * 0 on success, -1 if the replay cannot be read, desyncs, or the recording
+ * cannot be written.
+ */
+int cast_export(const char* replay_path, const char* cast_path) {
+    Game game = {0};
+    game.replay.fd = -1;
+    game.replay.replay_state = REPLAY_OFF;
+    if (replay_open(&game.replay, replay_path) != 0) {
+        return -1;
+    }
+    FILE* file = fopen(cast_path, "w");
+    if (!file) {
+        replay_free(&game.replay);
+        return -1;
+    }
+
+    headless_playback_start(&game);
+    export_game(&game, file);
+    const int desynced = game.replay.desynced;
+    headless_playback_finish(&game);
+    replay_free(&game.replay);
+
+    if (fclose(file) != 0 || desynced) {
+        remove(cast_path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * run_cast_export - Exports replays and replay directories to casts/
+ * @args: replay files and directories of replays; none for the replay library
+ * @count: number of entries in @args
+ * @threads: threads to export on, 0 for one per core
+ *
+ * RETURNS
+ * The process exit status: 0 if every replay was exported, 1 otherwise.
+ */
+int run_cast_export(const char** args, const int count, const int threads) {
+    return run_replay_export(args, count, threads, CAST_DIR, ".cast", cast_export);
+}
@@ -0,0 +1,9 @@
+#ifndef CAST_H
+#define CAST_H
+
+#include "types.h"
+
+int cast_export(const char* replay_path, const char* cast_path);
+int run_cast_export(const char** args, int count, int threads);
+
+#endif  // CAST_H
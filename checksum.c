@@ -0,0 +1,71 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "checksum.h"
+#include "types.h"
+
+/*
+ * The simulation hash is the XOR of one contribution per live entity. Every
+ * entity caches its current contribution in ent->hash, so moving, spawning or
+ * removing an entity costs two XORs and one mix instead of a walk over the
+ * whole world. Scalar counters are folded in only when a checksum is taken.
+ */
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static uint64_t float_bits(const float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void checksum_update_entity(Game* game, entity_t* ent, const collision_t kind) {
+    const uint64_t position = ((uint64_t)(uint32_t)ent->x << 32) | (uint32_t)ent->y;
+    const uint64_t motion = ((uint64_t)kind << 48) | ((uint64_t)ent->direction << 32) |
+                            ((uint64_t)(uint16_t)ent->dx << 16) | (uint16_t)ent->dy;
+
+    game->state_hash ^= ent->hash;
+    ent->hash = mix64(position ^ mix64(motion));
+    game->state_hash ^= ent->hash;
+}
+
+void checksum_remove_entity(Game* game, entity_t* ent) {
+    game->state_hash ^= ent->hash;
+    ent->hash = 0;
+}
+
+/**
+ * checksum_state - 64-bit fingerprint of the simulation state
+ * @game: Main game struct
+ *
+ * Combines the incrementally maintained entity hash with the counters that
+ * decide the outcome of the game and the RNG state, so a divergence in
+ * random draws is caught before it shows up in the world. Constant time.
+ *
+ * RETURNS
+ * The state hash.
+ */
+uint64_t checksum_state(const Game* game) {
+    uint64_t hash = game->state_hash;
+
+    hash = mix64(hash ^ (uint64_t)(uint32_t)game->entities.swallow->hp);
+    hash = mix64(hash ^ ((uint64_t)(uint32_t)game->stars_collected << 32) ^
+                 (uint64_t)(uint32_t)game->game_speed);
+    hash = mix64(hash ^ (float_bits(game->time_left) << 32) ^
+                 float_bits(game->albatross_cooldown));
+    hash = mix64(hash ^ ((uint64_t)(uint32_t)game->hunter_spawn_tick << 32) ^
+                 (uint64_t)(uint32_t)game->star_spawn_tick);
+    hash = mix64(hash ^ ((uint64_t)(uint32_t)game->taxi.frame << 32) ^
+                 (uint64_t)(unsigned char)game->taxi.active);
+    hash = mix64(hash ^ ((uint64_t)(uint32_t)game->taxi.to_x << 32) ^
+                 (uint64_t)(uint32_t)game->taxi.to_y);
+    hash = mix64(hash ^ game->rng_state);
+    return mix64(hash ^ (uint64_t)(uint32_t)game->score);
+}
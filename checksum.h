@@ -0,0 +1,10 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "types.h"
+
+void checksum_update_entity(Game* game, entity_t* ent, collision_t kind);
+void checksum_remove_entity(Game* game, entity_t* ent);
+uint64_t checksum_state(const Game* game);
+
+#endif  // CHECKSUM_H
@@ -5,6 +5,7 @@
 #include <string.h>
 
 #include "conf.h"
+#include "mem.h"
 #include "types.h"
 #include "utils.h"
 
@@ -41,6 +42,8 @@ static const ConfigMapEntry* get_global_key_map(int* count) {
             {"level_nr", offsetof(conf_t, level_nr), TYPE_INT},
             {"window_height", offsetof(conf_t, window_height), TYPE_INT},
             {"window_width", offsetof(conf_t, window_width), TYPE_INT},
+            {"arena_width", offsetof(conf_t, arena_width), TYPE_INT},
+            {"arena_height", offsetof(conf_t, arena_height), TYPE_INT},
             {"star_quota", offsetof(conf_t, star_quota), TYPE_INT},
             {"timer", offsetof(conf_t, timer), TYPE_FLOAT},
             {"star_spawn", offsetof(conf_t, star_spawn), TYPE_FLOAT},
@@ -48,12 +51,16 @@ static const ConfigMapEntry* get_global_key_map(int* count) {
             {"min_speed", offsetof(conf_t, min_speed), TYPE_INT},
             {"max_speed", offsetof(conf_t, max_speed), TYPE_INT},
             {"seed", offsetof(conf_t, seed), TYPE_INT},
+            {"render_fps", offsetof(conf_t, render_fps), TYPE_INT},
             {"score_time_weight", offsetof(conf_t, score_time_weight), TYPE_FLOAT},
             {"score_stars_weight", offsetof(conf_t, score_stars_weight), TYPE_FLOAT},
             {"score_life_weight", offsetof(conf_t, score_life_weight), TYPE_FLOAT},
             {"albatross_cooldown", offsetof(conf_t, albatross_cooldown), TYPE_FLOAT},
             {"hunter_spawn_esc", offsetof(conf_t, hunter_spawn_esc), TYPE_FLOAT},
-            {"hunter_bounce_esc", offsetof(conf_t, hunter_bounce_esc), TYPE_FLOAT}};
+            {"hunter_bounce_esc", offsetof(conf_t, hunter_bounce_esc), TYPE_FLOAT},
+            // Spelled out in the level files.
+            {"hunter_spawn_escalation", offsetof(conf_t, hunter_spawn_esc), TYPE_FLOAT},
+            {"hunter_bounce_escalation", offsetof(conf_t, hunter_bounce_esc), TYPE_FLOAT}};
     *count = sizeof(map) / sizeof(map[0]);
     return map;
 }
@@ -71,6 +78,17 @@ static const ConfigMapEntry* get_hunter_key_map(int* count) {
     return map;
 }
 
+int is_config_key(const char* key) {
+    int count = 0;
+    const ConfigMapEntry* map = get_global_key_map(&count);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(key, map[i].key_name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /**
  * parse_sprite - parses and assigns sprite data to a hunter template
  * @config: pointer to the main config struct
@@ -97,7 +115,7 @@ static void parse_sprite(conf_t* config, const int hunter_idx, const char* key,
     const size_t size = (hunter->width * hunter->height) + 1;
     if (hunter->sprites[0] == NULL) {
         for (int i = 0; i < NUM_DIRECTIONS; i++) {
-            hunter->sprites[i] = (char*)malloc(size);
+            hunter->sprites[i] = (char*)mem_alloc(MEM_CONFIG, size);
         }
     }
 
@@ -193,6 +211,19 @@ static void parse_values(conf_t* config, const int hunter_idx, const char* key,
     }
 }
 
+/**
+ * set_config_value - Sets one global key as if it were a line of a level file
+ * @config: configuration to change
+ * @key: global key name
+ * @value: value as it would be written in the file
+ *
+ * RETURNS
+ * Void.
+ */
+void set_config_value(conf_t* config, const char* key, const char* value) {
+    parse_values(config, -1, key, value);
+}
+
 /**
  * proccess_config_line - splits config line into key/value pairs
  * @line: entire line read from the config file
@@ -203,12 +234,13 @@ static void parse_values(conf_t* config, const int hunter_idx, const char* key,
  * Void.
  */
 static void process_config_line(char* line, conf_t* config, int* hunter_idx) {
-    const char* key = strtok(line, " \t");
+    char* rest = NULL;
+    const char* key = strtok_r(line, " \t", &rest);
     if (!key || key[0] == '#' || key[0] == '\0') {
         return;
     }
 
-    const char* value = strtok(NULL, "");
+    const char* value = strtok_r(NULL, "", &rest);
     if (value) {
         while (*value && isspace((unsigned char)*value)) {
             value++;
@@ -221,8 +253,9 @@ static void process_config_line(char* line, conf_t* config, int* hunter_idx) {
         (*hunter_idx)++;
         config->hunter_templates_amount = (*hunter_idx) + 1;
 
-        HunterTypes* const temp = (HunterTypes*)realloc(
-                config->hunter_templates, config->hunter_templates_amount * sizeof(HunterTypes));
+        HunterTypes* const temp = (HunterTypes*)mem_realloc(
+                MEM_CONFIG, config->hunter_templates,
+                config->hunter_templates_amount * sizeof(HunterTypes));
         if (!temp) {
             exit(1);
         }
@@ -238,6 +271,9 @@ static void init_default_conf(conf_t* config) {
     config->level_nr = 1;
     config->window_height = 40;
     config->window_width = 80;
+    // 0 means the arena is the size of the window.
+    config->arena_width = 0;
+    config->arena_height = 0;
     config->star_quota = 10;
     config->timer = 50.0F;
     config->star_quota = 3;
@@ -246,6 +282,7 @@ static void init_default_conf(conf_t* config) {
     config->min_speed = 1;
     config->max_speed = 5;
     config->seed = 2137;
+    config->render_fps = DEFAULT_RENDER_FPS;
     config->score_time_weight = 20.0F;
     config->score_stars_weight = 200.0F;
     config->score_life_weight = 5.0F;
@@ -254,6 +291,20 @@ static void init_default_conf(conf_t* config) {
     config->hunter_bounce_esc = 5.0F;
 }
 
+static void parse_config_stream(FILE* file, conf_t* config) {
+    // Hunter template initially is -1.
+    // When a `hunter_template` is detected we stop looking
+    // for global keys and we parse only hunter templates.
+    int hunter_index = -1;
+    char line[MAX_LINE_LENGTH] = {0};
+
+    while (fgets(line, sizeof(line), file)) {
+        strip_newline(line);
+
+        process_config_line(line, config, &hunter_index);
+    }
+}
+
 conf_t read_config(const char* filename) {
     conf_t config = {0};
     init_default_conf(&config);
@@ -263,17 +314,35 @@ conf_t read_config(const char* filename) {
         return config;
     }
 
-    // Hunter template initially is -1.
-    // When a `hunter_template` is detected we stop looking
-    // for global keys and we parse only hunter templates.
-    int hunter_index = -1;
-    char line[MAX_LINE_LENGTH] = {0};
+    parse_config_stream(file, &config);
+    fclose(file);
+    return config;
+}
 
-    while (fgets(line, sizeof(line), file)) {
-        strip_newline(line);
+/**
+ * read_config_data - parses a configuration held in memory
+ * @data: contents of a level file
+ * @size: number of bytes in @data
+ *
+ * Used for levels embedded in replay files, so playback does not depend on
+ * the level file still existing (or being unchanged) on disk.
+ *
+ * RETURNS
+ * The parsed configuration, or the defaults if @data is empty.
+ */
+conf_t read_config_data(const char* data, const size_t size) {
+    conf_t config = {0};
+    init_default_conf(&config);
+    if (size == 0) {
+        return config;
+    }
 
-        process_config_line(line, &config, &hunter_index);
+    FILE* file = fmemopen((void*)data, size, "r");
+    if (!file) {
+        return config;
     }
+
+    parse_config_stream(file, &config);
     fclose(file);
     return config;
 }
@@ -286,11 +355,11 @@ void free_config(conf_t* config) {
     for (int i = 0; i < config->hunter_templates_amount; i++) {
         for (int j = 0; j < NUM_DIRECTIONS; j++) {
             if (config->hunter_templates[i].sprites[j]) {
-                free(config->hunter_templates[i].sprites[j]);
+                mem_free(config->hunter_templates[i].sprites[j]);
                 config->hunter_templates[i].sprites[j] = NULL;
             }
         }
     }
-    free(config->hunter_templates);
+    mem_free(config->hunter_templates);
     config->hunter_templates = NULL;
 }
@@ -4,6 +4,9 @@
 #include "types.h"
 
 conf_t read_config(const char* filename);
+conf_t read_config_data(const char* data, size_t size);
 void free_config(conf_t* config);
+int is_config_key(const char* key);
+void set_config_value(conf_t* config, const char* key, const char* value);
 
 #endif  // CONF_H
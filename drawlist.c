@@ -0,0 +1,116 @@
+#include <ncurses.h>
+#include <stdlib.h>
+
+#include "drawlist.h"
+#include "mem.h"
+#include "types.h"
+
+/*
+ * Frames are drawn from a list of spans rather than sprite by sprite. Every
+ * sprite row is cut into runs of visible characters, the runs are sorted by
+ * layer, colour pair, row and column, and submitted in that order: one
+ * attribute change per colour in the frame and one cursor move per span,
+ * instead of an attribute on/off pair per sprite and a move per character.
+ */
+
+static void add_span(DrawList* list, const DrawSpan* span) {
+    if (list->count == list->capacity) {
+        const int capacity = list->capacity ? list->capacity * 2 : DRAW_LIST_INITIAL_SPANS;
+        DrawSpan* spans = mem_realloc(MEM_RENDER, list->spans, sizeof(DrawSpan) * (size_t)capacity);
+        if (!spans) {
+            exit(1);
+        }
+        list->spans = spans;
+        list->capacity = capacity;
+    }
+    list->spans[list->count++] = *span;
+}
+
+static void add_sprite_spans(DrawList* list, const WIN* area, const FrameSprite* sprite) {
+    DrawSpan span = {sprite->layer, sprite->color, 0, 0, 0, NULL};
+
+    for (int sprite_y = 0; sprite_y < sprite->height; sprite_y++) {
+        span.row = sprite->y + sprite_y;
+        if (span.row < 0 || span.row >= area->rows) {
+            continue;
+        }
+        const char* line = sprite->sprite + (sprite_y * sprite->width);
+
+        int x = 0;
+        while (x < sprite->width) {
+            while (x < sprite->width && (line[x] == ' ' || sprite->x + x < 0)) {
+                x++;
+            }
+            const int start = x;
+            while (x < sprite->width && line[x] != ' ' && sprite->x + x < area->cols) {
+                x++;
+            }
+            if (x > start) {
+                span.col = sprite->x + start;
+                span.len = x - start;
+                span.text = line + start;
+                add_span(list, &span);
+            }
+            if (sprite->x + x >= area->cols) {
+                break;
+            }
+        }
+    }
+}
+
+static int compare_spans(const void* a, const void* b) {
+    const DrawSpan* x = (const DrawSpan*)a;
+    const DrawSpan* y = (const DrawSpan*)b;
+
+    if (x->layer != y->layer) {
+        return x->layer - y->layer;
+    }
+    if (x->color != y->color) {
+        return (int)x->color - (int)y->color;
+    }
+    if (x->row != y->row) {
+        return x->row - y->row;
+    }
+    return x->col - y->col;
+}
+
+/**
+ * draw_list_build - Collects and orders the spans of a frame
+ * @list: draw list, reused between frames
+ * @area: window the frame is drawn into (for clipping)
+ * @frame: the frame to draw
+ *
+ * Sorting by layer first keeps the player above everything else, as with
+ * the old back-to-front drawing.
+ *
+ * RETURNS
+ * Void.
+ */
+void draw_list_build(DrawList* list, const WIN* area, const Frame* frame) {
+    list->count = 0;
+    for (int i = 0; i < frame->sprite_count; i++) {
+        add_sprite_spans(list, area, &frame->sprites[i]);
+    }
+    qsort(list->spans, (size_t)list->count, sizeof(DrawSpan), compare_spans);
+}
+
+void draw_list_submit(const DrawList* list, WINDOW* win) {
+    int color = -1;
+
+    for (int i = 0; i < list->count; i++) {
+        const DrawSpan* span = &list->spans[i];
+        if ((int)span->color != color) {
+            color = (int)span->color;
+            wattrset(win, span->color ? COLOR_PAIR(span->color) : A_NORMAL);
+        }
+        mvwaddnstr(win, span->row, span->col, span->text, span->len);
+    }
+    wattrset(win, A_NORMAL);
+}
+
+void draw_list_free(DrawList* list) {
+    mem_free(list->spans);
+    list->spans = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
@@ -0,0 +1,10 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include "types.h"
+
+void draw_list_build(DrawList* list, const WIN* area, const Frame* frame);
+void draw_list_submit(const DrawList* list, WINDOW* win);
+void draw_list_free(DrawList* list);
+
+#endif  // DRAWLIST_H
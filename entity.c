@@ -2,8 +2,9 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include "checksum.h"
 #include "entity.h"
-#include "graphics.h"
+#include "mem.h"
 #include "physics.h"
 #include "types.h"
 
@@ -81,15 +82,14 @@ int check_intercept_course(const entity_t* h, const entity_t* s) {
 collision_t process_entity_tick(Game* game, entity_t* ent, const collision_t representation) {
     remove_entity(game, ent);
     const collision_t ret = attempt_move_entity(game, ent);
-    update_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols, ent,
-                         representation);
-    draw_sprite(game, ent);
+    update_occupancy_map(&game->occupancy_map, ent, representation);
+    checksum_update_entity(game, ent, representation);
     return ret;
 }
 
 void remove_entity(Game* game, entity_t* ent) {
-    remove_sprite(game, ent);
-    update_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols, ent, EMPTY);
+    checksum_remove_entity(game, ent);
+    update_occupancy_map(&game->occupancy_map, ent, EMPTY);
 }
 
 void* remove_generic_node(Game* game, void** head_ref, void* current, void* prev,
@@ -111,7 +111,7 @@ void* remove_generic_node(Game* game, void** head_ref, void* current, void* prev
         *prev_next_ptr = next_node;
     }
 
-    free(current);
+    mem_free(current);
 
     return next_node;
 }
@@ -126,7 +126,7 @@ void free_generic_list(Game* game, void* head, const size_t next_offset, const s
         void* const* next_ptr = (void**)((char*)current + next_offset);
         void* next_node = *next_ptr;
 
-        free(current);
+        mem_free(current);
 
         current = next_node;
     }
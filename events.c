@@ -0,0 +1,197 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include "events.h"
+#include "output.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * One poll() covers everything the menu and the game wait for: keys on
+ * stdin, the tick timer and SIGWINCH. The signal handler only writes a byte
+ * to a self-pipe, so a resize wakes poll() like any other event and is
+ * handled outside signal context. Nothing sleeps for a fixed time, so an
+ * idle loop stays blocked until there is something to do and a key wakes
+ * it at once.
+ */
+
+static int resize_pipe[2] = {-1, -1};
+static struct sigaction previous_winch;
+
+static void on_winch(const int sig) {
+    (void)sig;
+    const int saved = errno;
+    const char byte = 1;
+    // A full pipe already holds a pending resize, so a failed write is fine.
+    const ssize_t written = write(resize_pipe[1], &byte, 1);
+    (void)written;
+    errno = saved;
+}
+
+static void set_nonblocking(const int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+/**
+ * events_open - Sets up the tick timer and the resize notification
+ * @loop: event loop
+ *
+ * Replaces the SIGWINCH handler until events_close().
+ *
+ * RETURNS
+ * Void.
+ */
+void events_open(EventLoop* loop) {
+    loop->timer_fd = -1;
+    loop->interval_us = 0;
+    loop->deadline_us = 0;
+#ifdef __linux__
+    loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#endif
+    if (pipe(resize_pipe) != 0) {
+        exit(1);
+    }
+    set_nonblocking(resize_pipe[0]);
+    set_nonblocking(resize_pipe[1]);
+
+    struct sigaction action = {0};
+    action.sa_handler = on_winch;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGWINCH, &action, &previous_winch);
+}
+
+void events_close(EventLoop* loop) {
+    sigaction(SIGWINCH, &previous_winch, NULL);
+    for (int i = 0; i < 2; i++) {
+        close(resize_pipe[i]);
+        resize_pipe[i] = -1;
+    }
+    if (loop->timer_fd >= 0) {
+        close(loop->timer_fd);
+        loop->timer_fd = -1;
+    }
+}
+
+/**
+ * events_timer - Sets the period of the tick timer
+ * @loop: event loop
+ * @interval_us: period in microseconds, 0 to stop the timer
+ *
+ * The first tick comes one period from now. Setting the period the timer
+ * already runs at does nothing, so callers may set it every tick.
+ *
+ * RETURNS
+ * Void.
+ */
+void events_timer(EventLoop* loop, const unsigned int interval_us) {
+    if (interval_us == loop->interval_us) {
+        return;
+    }
+    loop->interval_us = interval_us;
+    loop->deadline_us = monotonic_us() + interval_us;
+#ifdef __linux__
+    const struct timespec period = {interval_us / 1000000, (long)(interval_us % 1000000) * 1000};
+    const struct itimerspec spec = {period, period};
+    timerfd_settime(loop->timer_fd, 0, &spec, NULL);
+#endif
+}
+
+static void drain(const int fd) {
+    char bytes[64];
+    while (read(fd, bytes, sizeof(bytes)) > 0) {
+    }
+}
+
+static int timer_timeout_ms(const EventLoop* loop, const int mask) {
+    if (!(mask & EVENT_TICK) || loop->interval_us == 0 || loop->timer_fd >= 0) {
+        return -1;
+    }
+    const uint64_t now = monotonic_us();
+    return loop->deadline_us > now ? (int)((loop->deadline_us - now + 999) / 1000) : 0;
+}
+
+static int timer_expired(EventLoop* loop, const struct pollfd* timer_pfd) {
+    if (loop->timer_fd >= 0) {
+        if (!(timer_pfd->revents & POLLIN)) {
+            return 0;
+        }
+        drain(loop->timer_fd);
+        return 1;
+    }
+    const uint64_t now = monotonic_us();
+    if (now < loop->deadline_us) {
+        return 0;
+    }
+    // Missed ticks are not made up for, as with the timerfd.
+    loop->deadline_us += loop->interval_us;
+    if (loop->deadline_us <= now) {
+        loop->deadline_us = now + loop->interval_us;
+    }
+    return 1;
+}
+
+/**
+ * events_wait - Blocks until one of the given events happens
+ * @loop: event loop
+ * @mask: EventMask bits to wait for
+ *
+ * Input is only reported, never read. Resizes are coalesced, so any number
+ * of SIGWINCH since the last call count as one.
+ *
+ * RETURNS
+ * The EventMask bits that happened, always some of @mask; all of @mask if
+ * poll() itself fails.
+ */
+int events_wait(EventLoop* loop, const int mask) {
+    const int ticking = (mask & EVENT_TICK) && loop->interval_us != 0;
+    int fired = 0;
+    while (fired == 0) {
+        struct pollfd pfds[3] = {
+                {(mask & EVENT_INPUT) ? STDIN_FILENO : -1, POLLIN, 0},
+                {(mask & EVENT_RESIZE) ? resize_pipe[0] : -1, POLLIN, 0},
+                {ticking ? loop->timer_fd : -1, POLLIN, 0},
+        };
+        if (poll(pfds, 3, timer_timeout_ms(loop, mask)) < 0 && errno != EINTR) {
+            return mask;
+        }
+        if (pfds[0].revents & (POLLIN | POLLHUP)) {
+            fired |= EVENT_INPUT;
+        }
+        if (pfds[1].revents & POLLIN) {
+            drain(resize_pipe[0]);
+            fired |= EVENT_RESIZE;
+        }
+        if (ticking && timer_expired(loop, &pfds[2])) {
+            fired |= EVENT_TICK;
+        }
+    }
+    return fired;
+}
+
+/**
+ * events_resize_terminal - Tells ncurses the terminal's new size
+ *
+ * Needed after an EVENT_RESIZE, as ncurses no longer sees SIGWINCH itself.
+ * The next refresh repaints the whole screen.
+ *
+ * RETURNS
+ * Void.
+ */
+void events_resize_terminal(void) {
+    struct winsize size;
+    if (ioctl(output_tty(), TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        resizeterm(size.ws_row, size.ws_col);
+    }
+    clearok(curscr, TRUE);
+}
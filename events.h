@@ -0,0 +1,12 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include "types.h"
+
+void events_open(EventLoop* loop);
+void events_close(EventLoop* loop);
+void events_timer(EventLoop* loop, unsigned int interval_us);
+int events_wait(EventLoop* loop, int mask);
+void events_resize_terminal(void);
+
+#endif  // EVENTS_H
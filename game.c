@@ -1,80 +1,153 @@
 #include <ctype.h>
 #include <ncurses.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "bot.h"
+#include "broadcast.h"
+#include "buffer.h"
+#include "checksum.h"
 #include "conf.h"
+#include "events.h"
 #include "graphics.h"
 #include "hunter.h"
+#include "latency.h"
+#include "mem.h"
 #include "menu.h"
+#include "perf.h"
 #include "physics.h"
 #include "ranking.h"
+#include "render.h"
+#include "replay.h"
+#include "rewind.h"
+#include "snapshot.h"
 #include "star.h"
 #include "swallow.h"
 #include "types.h"
 #include "utils.h"
+#include "verify.h"
 
-static void save_key(Game* game, char ch) {
-    size_t current_capacity = game->replay.replay_chunks * REPLAY_CHUNK;
+/**
+ * apply_game_key - Applies a single key press to the running game
+ * @game: Main game struct
+ * @swallow: The player's entity
+ * @ch: Lowercase key code
+ *
+ * RETURNS
+ * 1 if the key affects the game and belongs in the replay, 0 otherwise.
+ */
+static int apply_game_key(Game* game, entity_t* swallow, const int ch) {
+    switch (ch) {
+        case 'q':
+            game->running = 0;
+            break;
+        case 'w':
+            change_entity_direction(swallow, DIR_UP, swallow->speed);
+            break;
+        case 's':
+            change_entity_direction(swallow, DIR_DOWN, swallow->speed);
+            break;
+        case 'a':
+            change_entity_direction(swallow, DIR_LEFT, swallow->speed);
+            break;
+        case 'd':
+            change_entity_direction(swallow, DIR_RIGHT, swallow->speed);
+            break;
+        case 'o':
+            change_game_speed(game, DOWN);
+            break;
+        case 'p':
+            change_game_speed(game, UP);
+            break;
+        case 'e':
+            call_albatross_taxi(game);
+            break;
+        default:
+            return 0;
+    }
+    return 1;
+}
 
-    if (game->replay.replay_keys == NULL) {
-        game->replay.replay_keys = (char*)calloc(REPLAY_CHUNK, sizeof(char));
-        game->replay.replay_index = 0;
-        game->replay.replay_chunks = 1;
-    } else if (game->replay.replay_index + 1 >= current_capacity) {
-        game->replay.replay_chunks++;
-        size_t new_size = game->replay.replay_chunks * REPLAY_CHUNK;
+static int is_direction_key(const int ch) {
+    return ch == 'w' || ch == 'a' || ch == 's' || ch == 'd';
+}
 
-        char* new_ptr = (char*)realloc(game->replay.replay_keys, new_size);
-        if (new_ptr == NULL) {
-            exit(1);
-        }
+static void apply_live_key(Game* game, entity_t* swallow, const int ch, const uint64_t read_us) {
+    if (!apply_game_key(game, swallow, ch)) {
+        return;
+    }
+    game->tick_key = ch;
+    if (!game->bot) {
+        latency_key_read(game, read_us);
+    }
+    if (game->replay.replay_state == REPLAY_RECORDING) {
+        replay_record_key(&game->replay, ch);
+    }
+}
 
-        game->replay.replay_keys = new_ptr;
+static int read_tick_keys(Game* game, int* keys) {
+    if (game->bot) {
+        keys[0] = bot_next_key(game);
+        return keys[0] != ERR;
+    }
+    const int count = read_keys(keys, INPUT_DRAIN_MAX);
+    for (int i = 0; i < count; i++) {
+        keys[i] = tolower(keys[i]);
     }
-    game->replay.replay_keys[game->replay.replay_index] = ch;
-    game->replay.replay_index++;
+    return count;
+}
 
-    game->replay.replay_keys[game->replay.replay_index] = '\0';
+/**
+ * handle_live_input - Applies every key that arrived since the last tick
+ * @game: Main game struct
+ * @swallow: The player's entity
+ *
+ * Control keys take effect in the order they were typed; of the direction
+ * keys only the last one counts, applied after them. Keys are recorded in
+ * the order they are applied, which is the order playback applies them in.
+ * A rewind ends the tick's input, as what came before it is undone anyway.
+ *
+ * RETURNS
+ * Void.
+ */
+static void handle_live_input(Game* game, entity_t* swallow) {
+    int keys[INPUT_DRAIN_MAX];
+    const int count = read_tick_keys(game, keys);
+    const uint64_t read_us = count > 0 && !game->bot ? monotonic_us() : 0;
+    int direction = ERR;
+
+    for (int i = 0; i < count && game->running; i++) {
+        if (is_direction_key(keys[i])) {
+            direction = keys[i];
+        } else if (keys[i] == PERF_TOGGLE_KEY) {
+            game->perf.visible = !game->perf.visible;
+        } else if (keys[i] == 'r' && game->practice) {
+            game->replay.tick -= (unsigned int)rewind_step(game, REWIND_STEP_TICKS);
+            latency_key_read(game, read_us);
+            return;
+        } else {
+            apply_live_key(game, swallow, keys[i], read_us);
+        }
+    }
+    if (direction != ERR && game->running) {
+        apply_live_key(game, swallow, direction, read_us);
+    }
 }
 
-static void handle_game_input(Game* game, entity_t* swallow, char replay_char) {
-    int ch = ERR;
-    if (game->replay.replay_state == REPLAY_RECORDING) {
-        ch = tolower(getch());
-        save_key(game, (char)ch);
-    } else if (game->replay.replay_state == REPLAY_PLAYING) {
-        ch = replay_char;
-    }
-
-    if (ch != ERR) {
-        switch (ch) {
-            case 'q':
-                game->running = 0;
-                break;
-            case 'w':
-                change_entity_direction(swallow, DIR_UP, swallow->speed);
-                break;
-            case 's':
-                change_entity_direction(swallow, DIR_DOWN, swallow->speed);
-                break;
-            case 'a':
-                change_entity_direction(swallow, DIR_LEFT, swallow->speed);
-                break;
-            case 'd':
-                change_entity_direction(swallow, DIR_RIGHT, swallow->speed);
-                break;
-            case 'o':
-                change_game_speed(game, DOWN);
-                break;
-            case 'p':
-                change_game_speed(game, UP);
-                break;
-            case 'e':
-                call_albatross_taxi(game);
-                break;
+static void handle_game_input(Game* game, entity_t* swallow) {
+    game->tick_key = ERR;
+    if (game->replay.replay_state != REPLAY_PLAYING) {
+        handle_live_input(game, swallow);
+        return;
+    }
+    int ch = replay_next_key(&game->replay);
+    while (ch != ERR) {
+        if (apply_game_key(game, swallow, ch)) {
+            game->tick_key = ch;
         }
+        ch = replay_next_key(&game->replay);
     }
 }
 
@@ -185,8 +258,10 @@ static void reset_game_state(Game* game) {
     game->star_flicker_tick = 0;
     game->stars_collected = 0;
     game->albatross_cooldown = 0;
+    game->taxi = (AlbatrossTaxi){0};
     game->result = UNKNOWN;
-    srand(game->config.seed);
+    game->next_entity_id = 0;
+    seed_game_rand(game, game->config.seed);
 
     if (game->entities.hunters != NULL) {
         free_hunters(game);
@@ -194,25 +269,51 @@ static void reset_game_state(Game* game) {
     if (game->entities.stars != NULL) {
         free_stars(game);
     }
+    game->state_hash = 0;
 }
 
-void game_loop(Game* game) {
+unsigned int tick_duration_us(const Game* game) {
+    return TICK_BASE_US / game->game_speed;
+}
+
+static void capture_keyframe(Game* game) {
+    if (game->replay.replay_state != REPLAY_RECORDING ||
+        game->replay.tick % REPLAY_KEYFRAME_TICKS != 0 || !game->running) {
+        return;
+    }
+
+    ByteBuffer snapshot = {.tag = MEM_REPLAY};
+    snapshot_write(game, &snapshot);
+    replay_record_keyframe(&game->replay, &snapshot);
+    buffer_free(&snapshot);
+}
+
+/**
+ * simulate_tick - Advances the game by one tick
+ * @game: Main game struct
+ *
+ * Reads the tick's input (terminal, bot or replay) and updates the world. No
+ * ncurses calls are made, so headless games can call this directly.
+ *
+ * RETURNS
+ * Void.
+ */
+void simulate_tick(Game* game) {
     if (game->time_left == game->config.timer) {
         reset_game_state(game);
+        if (game->practice) {
+            rewind_reset(game);
+        }
     }
-    const unsigned int sleep_us = 66666 / game->game_speed;
-    const float delta_seconds = (float)sleep_us / 1000000.0F;
+    const float delta_seconds = (float)tick_duration_us(game) / 1000000.0F;
 
-    Swallow* swallow = game->entities.swallow;
-    if (game->replay.replay_state == REPLAY_RECORDING) {
-        handle_game_input(game, &swallow->ent, ERR);
-    } else if (game->replay.replay_state == REPLAY_PLAYING) {
-        handle_game_input(game, &swallow->ent,
-                          game->replay.replay_keys[game->replay.playback_index]);
-        game->replay.playback_index++;
-    }
+    handle_game_input(game, &game->entities.swallow->ent);
 
-    process_swallow(game);
+    if (game->taxi.active) {
+        process_albatross_taxi(game);
+    } else {
+        process_swallow(game);
+    }
     process_hunters(game);
     collect_stars(game);
     handle_star_movement(game);
@@ -227,79 +328,379 @@ void game_loop(Game* game) {
     }
     game->time_left -= delta_seconds;
     check_game_over(game);
+    replay_checkpoint(&game->replay, checksum_state(game), !game->running);
+    capture_keyframe(game);
+    if (game->practice && game->running) {
+        rewind_capture(game);
+    }
+    replay_end_tick(&game->replay);
+}
+
+/**
+ * render_due - Decides whether a frame should be presented now
+ * @game: Main game struct
+ * @now: current monotonic time in microseconds
+ *
+ * Frames are capped at config.render_fps regardless of the tick rate; the
+ * final state of a game is always presented.
+ *
+ * RETURNS
+ * 1 if a frame should be rendered, 0 otherwise.
+ */
+static int render_due(Game* game, const uint64_t now) {
+    const int fps = game->config.render_fps > 0 ? game->config.render_fps : DEFAULT_RENDER_FPS;
+    if (now - game->last_render_us < 1000000U / (unsigned int)fps && game->running) {
+        return 0;
+    }
+    game->last_render_us = now;
+    return 1;
+}
+
+static int follow_axis(int camera, const int pos, const int size, const int view,
+                       const int arena) {
+    const int margin = view / CAMERA_MARGIN_DIVISOR;
+
+    if (pos < camera + margin) {
+        camera = pos - margin;
+    } else if (pos + size > camera + view - margin) {
+        camera = pos + size - view + margin;
+    }
+    if (camera > arena - view) {
+        camera = arena - view;
+    }
+    return camera < 0 ? 0 : camera;
+}
+
+/**
+ * follow_camera - Keeps the swallow (or the taxi carrying it) in view
+ * @game: Main game struct
+ *
+ * The camera only moves once the swallow gets within a quarter of the
+ * viewport from its edge, so most moves do not scroll the whole screen.
+ *
+ * RETURNS
+ * Void.
+ */
+void follow_camera(Game* game) {
+    const entity_t* focus = &game->entities.swallow->ent;
+    entity_t taxi;
+
+    if (game->taxi.active) {
+        albatross_taxi_entity(game, &taxi);
+        focus = &taxi;
+    }
+    game->camera_x = follow_axis(game->camera_x, focus->x, focus->width, game->main_win.cols,
+                                 game->arena_cols);
+    game->camera_y = follow_axis(game->camera_y, focus->y, focus->height, game->main_win.rows,
+                                 game->arena_rows);
+}
+
+/**
+ * seek_replay - Moves playback to an arbitrary tick
+ * @game: Main game struct
+ * @target: the tick that should be simulated next
+ *
+ * Restores the latest keyframe before @target, unless the current state is
+ * already closer, then simulates forward without rendering. Seeking
+ * therefore never costs more than REPLAY_KEYFRAME_TICKS simulated ticks.
+ *
+ * RETURNS
+ * Void.
+ */
+static void seek_replay(Game* game, unsigned int target) {
+    replay_t* replay = &game->replay;
+    if (target < 1) {
+        target = 1;
+    }
+
+    const ReplayKeyframe* keyframe = replay_find_keyframe(replay, target);
+    if (keyframe && (target < replay->tick || keyframe->tick >= replay->tick)) {
+        if (snapshot_restore(game, replay_keyframe_data(replay, keyframe),
+                             keyframe->payload_len) != 0) {
+            game->running = 0;
+            return;
+        }
+        replay_resume_after(replay, keyframe);
+    }
+
+    while (game->running && replay->tick < target) {
+        simulate_tick(game);
+    }
+}
+
+static void handle_playback_input(Game* game) {
+    static const int multipliers[] = {1, 2, 8, REPLAY_SPEED_MAX};
+    const int count = sizeof(multipliers) / sizeof(multipliers[0]);
+    const int ch = tolower(read_key());
+    const unsigned int tick = game->replay.tick;
+
+    if (ch == 'q') {
+        game->running = 0;
+    } else if (ch == 'j') {
+        seek_replay(game, tick > REPLAY_SEEK_TICKS ? tick - REPLAY_SEEK_TICKS : 0);
+    } else if (ch == 'l') {
+        seek_replay(game, tick + REPLAY_SEEK_TICKS);
+    } else if (ch == PERF_TOGGLE_KEY) {
+        game->perf.visible = !game->perf.visible;
+    } else if (ch == 'f') {
+        int i = 0;
+        while (i < count - 1 && multipliers[i] != game->playback_multiplier) {
+            i++;
+        }
+        game->playback_multiplier = multipliers[(i + 1) % count];
+    }
+}
+
+/**
+ * wait_for_tick - Sleeps until the tick timer fires
+ * @game: Main game struct
+ * @interval_us: tick period
+ * @mask: EVENT_INPUT to handle playback controls as soon as they arrive
+ *
+ * Live games keep reading their keys at tick boundaries, which is what the
+ * replays record; only resizes and playback controls are handled between
+ * ticks.
+ *
+ * RETURNS
+ * Void.
+ */
+static void wait_for_tick(Game* game, const unsigned int interval_us, const int mask) {
+    int events = 0;
+
+    events_timer(&game->events, interval_us);
+    while (game->running && !(events & EVENT_TICK)) {
+        events = events_wait(&game->events, mask | EVENT_TICK | EVENT_RESIZE);
+        if (events & EVENT_RESIZE) {
+            render_repaint(game);
+        }
+        if (events & EVENT_INPUT) {
+            handle_playback_input(game);
+        }
+    }
+}
 
-    draw_status(game);
-    draw_main(game);
-    doupdate();
+void game_loop(Game* game) {
+    const unsigned int sleep_us = tick_duration_us(game);
+    const uint64_t start_ns = monotonic_ns();
+
+    simulate_tick(game);
+    perf_record_tick(game, start_ns, sleep_us);
+    latency_poll(game);
+    follow_camera(game);
+    broadcast_tick(game);
+    if (render_due(game, monotonic_us())) {
+        render_publish(game);
+    }
 
-    usleep(sleep_us);
+    wait_for_tick(game, sleep_us, 0);
+}
+
+/**
+ * playback_loop - Runs a replay at the selected speed multiplier
+ * @game: Main game struct
+ *
+ * The simulation is paced at tick_duration / multiplier, or not at all at
+ * REPLAY_SPEED_MAX. Frames are presented at most config.render_fps times a
+ * second, so fast playback is bound by the simulation rather than the
+ * terminal. Paced playback handles its controls the moment a key arrives;
+ * unpaced playback polls them with every frame.
+ *
+ * RETURNS
+ * Void.
+ */
+static void playback_loop(Game* game) {
+    while (game->running) {
+        const unsigned int sleep_us = tick_duration_us(game);
+        const uint64_t start_ns = monotonic_ns();
+        simulate_tick(game);
+        perf_record_tick(game, start_ns,
+                         game->playback_multiplier == REPLAY_SPEED_MAX
+                                 ? 0
+                                 : sleep_us / (unsigned int)game->playback_multiplier);
+        follow_camera(game);
+
+        if (render_due(game, monotonic_us())) {
+            render_publish(game);
+            if (game->playback_multiplier == REPLAY_SPEED_MAX) {
+                handle_playback_input(game);
+            }
+        }
+
+        if (game->playback_multiplier != REPLAY_SPEED_MAX) {
+            wait_for_tick(game, sleep_us / (unsigned int)game->playback_multiplier, EVENT_INPUT);
+        }
+    }
 }
 
 static void setup_game_normal(Game* game) {
     char* level_path = select_level(game);
-    free_config(&game->config);
-    game->config = read_config(level_path);
-
-    if (game->replay.replay_keys != NULL) {
-        free(game->replay.replay_level_name);
-        free(game->replay.replay_keys);
+    size_t level_size = 0;
+    char* level_data = read_file_contents(level_path, &level_size);
+    if (level_data == NULL) {
+        perror("Error opening config file");
+        level_data = strdup("");
     }
-    game->replay.replay_level_name = strdup(level_path);
-    game->replay.replay_keys = NULL;
 
-    free(level_path);
+    free_config(&game->config);
+    game->config = read_config_data(level_data, level_size);
+    replay_start_recording(&game->replay, level_data, level_size, &game->config, game->username);
+
+    free(level_data);
+    mem_free(level_path);
 }
 
 static void setup_game_replay(Game* game) {
     free_config(&game->config);
-    game->config = read_config(game->replay.replay_level_name);
-    game->replay.playback_index = 0;
+    game->config = read_config_data(replay_level_data(&game->replay),
+                                    game->replay.header.level_size);
+    game->config.seed = game->replay.header.seed;
+    replay_start_playback(&game->replay);
 }
 
-void start_game(Game* game) {
-    if (game->replay.replay_state == REPLAY_RECORDING) {
-        setup_game_normal(game);
-    } else if (game->replay.replay_state == REPLAY_PLAYING) {
-        setup_game_replay(game);
-    }
+static void setup_game_practice(Game* game) {
+    char* level_path = select_level(game);
+    free_config(&game->config);
+    game->config = read_config(level_path);
+    game->replay.tick = 0;
+    mem_free(level_path);
+}
 
-    delwin(game->main_win.window);
-    delwin(game->status_win.window);
-    setup_windows(&game->main_win, &game->status_win, &game->config);
+/**
+ * run_game - Runs the simulation until the game ends
+ * @game: Main game struct
+ *
+ * A render thread draws the published frames meanwhile, so this thread must
+ * not call ncurses until it returns.
+ *
+ * RETURNS
+ * Void.
+ */
+static void run_game(Game* game) {
+    perf_begin(&game->perf);
+    events_timer(&game->events, 0);
+    render_start(game);
+    if (game->replay.replay_state == REPLAY_PLAYING) {
+        game->playback_multiplier = 1;
+        playback_loop(game);
+    } else {
+        latency_begin(&game->latency);
+        broadcast_begin(game);
+        while (game->running) {
+            game_loop(game);
+        }
+        broadcast_end(game);
+    }
+    render_stop(game);
+    events_timer(&game->events, 0);
+    if (game->replay.replay_state != REPLAY_PLAYING) {
+        latency_end(game);
+    }
+}
 
-    srand(game->config.seed);
+/**
+ * setup_arena - Sizes the arena and its occupancy map for the loaded level
+ * @game: Main game struct (windows must be set up)
+ *
+ * The arena is never smaller than the window showing it. The camera starts
+ * centred, which is where the swallow starts.
+ *
+ * RETURNS
+ * Void.
+ */
+static void setup_arena(Game* game) {
+    game->arena_cols = game->config.arena_width > game->main_win.cols ? game->config.arena_width
+                                                                      : game->main_win.cols;
+    game->arena_rows = game->config.arena_height > game->main_win.rows ? game->config.arena_height
+                                                                       : game->main_win.rows;
+    game->camera_x = (game->arena_cols - game->main_win.cols) / 2;
+    game->camera_y = (game->arena_rows - game->main_win.rows) / 2;
     init_occupancy_map(game);
+}
+
+/**
+ * prepare_game - Puts a freshly configured game at its first tick
+ * @game: Main game struct (config loaded, window sizes known)
+ *
+ * RETURNS
+ * Void.
+ */
+void prepare_game(Game* game) {
+    setup_arena(game);
+    reset_game_state(game);
 
     game->running = 1;
     game->game_speed = game->config.min_speed;
     game->time_left = game->config.timer;
     game->score = 0;
+    game->last_render_us = 0;
 
     if (game->entities.swallow == NULL) {
-        game->entities.swallow = (Swallow*)malloc(sizeof(Swallow));
+        game->entities.swallow = (Swallow*)mem_alloc(MEM_ENTITIES, sizeof(Swallow));
         if (!game->entities.swallow) {
             exit(1);
         }
     }
     init_swallow(game, game->entities.swallow);
+}
 
-    while (game->running) {
-        game_loop(game);
+void release_game(Game* game) {
+    free_hunters(game);
+    free_stars(game);
+    free_occupancy_map(game);
+}
+
+void start_game(Game* game) {
+    if (game->practice) {
+        setup_game_practice(game);
+    } else if (game->replay.replay_state == REPLAY_RECORDING) {
+        setup_game_normal(game);
+    } else if (game->replay.replay_state == REPLAY_PLAYING) {
+        setup_game_replay(game);
     }
 
-    if (game->replay.replay_state != REPLAY_PLAYING) {
-        save_ranking(game);
+    delwin(game->main_win.window);
+    delwin(game->status_win.window);
+    setup_windows(&game->main_win, &game->status_win, &game->config);
+
+    prepare_game(game);
+    run_game(game);
+
+    game->ranking_status = VERIFY_OK;
+    if (game->replay.replay_state == REPLAY_RECORDING) {
+        replay_finish_recording(&game->replay, game->score, game->result);
+        game->ranking_status = submit_ranking(game->username, game->score, game->replay.id);
     }
 
-    free_hunters(game);
-    free_stars(game);
-    free_occupancy_map(game);
+    release_game(game);
+}
+
+/**
+ * draw_ranking_status - Tells the player why their score was not ranked
+ * @game: Main game struct
+ *
+ * Drawn between the game over art and the high scores.
+ *
+ * RETURNS
+ * Void.
+ */
+static void draw_ranking_status(Game* game) {
+    if (game->ranking_status == VERIFY_OK) {
+        return;
+    }
+    char message[MAX_LINE_LENGTH];
+    snprintf(message, sizeof(message), "Score not ranked: %s",
+             verify_status_name(game->ranking_status));
+    wattron(game->main_win.window, COLOR_PAIR(C_RED_5) | A_BOLD);
+    mvwprintw(game->main_win.window, GAME_OVER_HIGH_SCORE_Y_OFFSET - 1,
+              (game->main_win.cols - (int)strlen(message)) / 2, "%s", message);
+    wattroff(game->main_win.window, COLOR_PAIR(C_RED_5) | A_BOLD);
 }
 
 void end_game(Game* game) {
     setup_menu_window(&game->main_win);
     nodelay(game->main_win.window, FALSE);
     draw_game_over(game, game->main_win.cols / 2, 1);
+    draw_ranking_status(game);
     show_high_scores(game, GAME_OVER_HIGH_SCORE_Y_OFFSET);
     flushinp();
     usleep(GAME_OVER_INPUT_BLOCK);
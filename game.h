@@ -3,6 +3,11 @@
 
 #include "types.h"
 
+void simulate_tick(Game* game);
+unsigned int tick_duration_us(const Game* game);
+void follow_camera(Game* game);
+void prepare_game(Game* game);
+void release_game(Game* game);
 void start_game(Game* game);
 void end_game(Game* game);
 
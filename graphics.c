@@ -3,43 +3,65 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "drawlist.h"
 #include "types.h"
 
-void draw_sprite(Game* game, entity_t* entity) {
-    char const* sprite_grid = NULL;
+/**
+ * frame_sprite - Describes how an entity looks right now
+ * @entity: the entity to describe
+ *
+ * RETURNS
+ * The position, size, colour and current sprite grid of @entity.
+ */
+FrameSprite frame_sprite(const entity_t* entity) {
+    FrameSprite sprite = {entity->x, entity->y, entity->width, entity->height, NULL, entity->color,
+                          0};
     if (entity->anim_frame == 1 && entity->anim_sprites[entity->direction] != NULL) {
-        sprite_grid = entity->anim_sprites[entity->direction];
+        sprite.sprite = entity->anim_sprites[entity->direction];
     } else {
-        sprite_grid = entity->sprites[entity->direction];
+        sprite.sprite = entity->sprites[entity->direction];
     }
+    return sprite;
+}
 
-    WINDOW* win = game->main_win.window;
+int sprite_visible(const FrameSprite* sprite, const WIN* area) {
+    return sprite->x < area->cols && sprite->y < area->rows && sprite->x + sprite->width > 0 &&
+           sprite->y + sprite->height > 0;
+}
+
+static void draw_frame_sprite(const WIN* area, const FrameSprite* sprite) {
+    WINDOW* win = area->window;
 
-    if (entity->color) {
-        wattron(win, COLOR_PAIR(entity->color));
+    if (sprite->color) {
+        wattron(win, COLOR_PAIR(sprite->color));
     }
 
-    for (int sprite_y = 0; sprite_y < entity->height; sprite_y++) {
-        for (int sprite_x = 0; sprite_x < entity->width; sprite_x++) {
-            const int screen_y = entity->y + sprite_y;
-            const int screen_x = entity->x + sprite_x;
+    for (int sprite_y = 0; sprite_y < sprite->height; sprite_y++) {
+        for (int sprite_x = 0; sprite_x < sprite->width; sprite_x++) {
+            const int screen_y = sprite->y + sprite_y;
+            const int screen_x = sprite->x + sprite_x;
 
-            if (screen_y < 0 || screen_y >= game->main_win.rows || screen_x < 0 ||
-                screen_x >= game->main_win.cols) {
+            if (screen_y < 0 || screen_y >= area->rows || screen_x < 0 ||
+                screen_x >= area->cols) {
                 continue;
             }
 
-            const char sprite_char = sprite_grid[(sprite_y * entity->width) + sprite_x];
+            const char sprite_char = sprite->sprite[(sprite_y * sprite->width) + sprite_x];
 
             if (sprite_char != ' ') {
                 mvwaddch(win, screen_y, screen_x, sprite_char);
             }
         }
     }
-    if (entity->color) {
-        wattroff(win, COLOR_PAIR(entity->color));
+    if (sprite->color) {
+        wattroff(win, COLOR_PAIR(sprite->color));
     }
-    wnoutrefresh(win);
+}
+
+void draw_sprite(Game* game, entity_t* entity) {
+    const FrameSprite sprite = frame_sprite(entity);
+    draw_frame_sprite(&game->main_win, &sprite);
+    wnoutrefresh(game->main_win.window);
 }
 
 void remove_sprite(Game* game, entity_t* entity) {
@@ -56,31 +78,119 @@ void remove_sprite(Game* game, entity_t* entity) {
     wnoutrefresh(win);
 }
 
-void draw_status(Game* game) {
-    WINDOW* win = game->status_win.window;
+static void draw_game_details(WINDOW* win, const Frame* frame) {
+    mvwprintw(win, 3, 2, "Game speed: %-3d", frame->game_speed);
+    if (frame->playing) {
+        if (frame->playback_multiplier == REPLAY_SPEED_MAX) {
+            wprintw(win, "| Replay: max [f] faster [j/l] seek [q] stop");
+        } else {
+            wprintw(win, "| Replay: %dx  [f] faster [j/l] seek [q] stop",
+                    frame->playback_multiplier);
+        }
+    }
+    if (frame->practice) {
+        wprintw(win, "| Practice: [r] rewind (%4.1fs kept)", frame->rewind_seconds);
+    }
+    mvwprintw(win, 4, 2, "Taxi cooldown: %-4.1f | Output: %5d B/frame", frame->albatross_cooldown,
+              frame->bytes_per_frame);
+    if (frame->low_bandwidth) {
+        wprintw(win, " (low bandwidth, %u dropped)", frame->dropped_frames);
+    }
+}
+
+/**
+ * draw_perf - Draws the performance overlay in place of the game details
+ * @win: status window
+ * @frame: the frame being drawn
+ *
+ * Tick time is simulation cost, draw time is ncurses composing the frame
+ * and flush time is doupdate() waiting for the terminal; drift is how far
+ * wall time has run ahead of simulated time. Memory figures are the tracked
+ * allocations of every subsystem; a desync note takes their place.
+ *
+ * RETURNS
+ * Void.
+ */
+static void draw_perf(WINDOW* win, const Frame* frame) {
+    wattron(win, COLOR_PAIR(C_CYAN_5));
+    mvwprintw(win, 3, 2,
+              "Tick avg/p%d %5.1f/%5.1f us | Draw %4.0f | Flush %5.0f us | Drift %+6.0f ms",
+              PERF_PERCENTILE, frame->tick_avg_us, frame->tick_p99_us, frame->render_us,
+              frame->flush_us, frame->drift_ms);
+    mvwprintw(win, 4, 2, "Hunters %-3d | Stars %-3d | Cells/tick %5.1f | Out %5d B/frame %6llu kB",
+              frame->hunter_count, frame->star_count, frame->cells_per_tick,
+              frame->bytes_per_frame, (unsigned long long)(frame->output_total / 1024));
+    if (!frame->desynced) {
+        mvwprintw(win, 5, 20, "| Allocs/tick %5.1f | Live %6llu kB | Peak %6llu kB",
+                  frame->allocs_per_tick, (unsigned long long)(frame->mem_live / 1024),
+                  (unsigned long long)(frame->mem_peak / 1024));
+    }
+    wattroff(win, COLOR_PAIR(C_CYAN_5));
+}
+
+static void draw_status(WINDOW* win, const Frame* frame) {
     wattron(win, COLOR_PAIR(C_GREY_1));
     box(win, 0, 0);
     wattroff(win, COLOR_PAIR(C_GREY_1));
     wattron(win, A_BOLD);
-    mvwprintw(win, 1, 2, "Player: %s | Level %-2d | Life-force: %-3d", game->username,
-              game->config.level_nr, game->entities.swallow->hp);
+    mvwprintw(win, 1, 2, "Player: %s | Level %-2d | Life-force: %-3d", frame->username,
+              frame->level_nr, frame->hp);
     mvwprintw(win, 2, 2, "Stars collected: %-3d | Star Quota: %-3d | Time left: %.1f ",
-              game->stars_collected, game->config.star_quota, game->time_left);
-    mvwprintw(win, 3, 2, "Game speed: %-3d", game->game_speed);
-    mvwprintw(win, 4, 2, "Taxi cooldown: %.1f ", game->albatross_cooldown);
-    mvwprintw(win, 5, 2, "Score: %-10d", game->score);
+              frame->stars_collected, frame->star_quota, frame->time_left);
+    if (frame->perf_visible) {
+        draw_perf(win, frame);
+    } else {
+        draw_game_details(win, frame);
+    }
+    if (frame->playing && frame->desynced) {
+        wattron(win, COLOR_PAIR(C_RED_5));
+        mvwprintw(win, 5, 20, "| REPLAY DESYNC at tick %u", frame->desync_tick);
+        wattroff(win, COLOR_PAIR(C_RED_5));
+    }
+    mvwprintw(win, 5, 2, "Score: %-10d", frame->score);
     wattroff(win, A_BOLD);
     wnoutrefresh(win);
 }
 
-void draw_main(Game* game) {
-    WINDOW* win = game->main_win.window;
+static void draw_border(WINDOW* win) {
     wattron(win, COLOR_PAIR(C_GREY_1));
     box(win, 0, 0);
     wattroff(win, COLOR_PAIR(C_GREY_1));
     wnoutrefresh(win);
 }
 
+void draw_main(Game* game) {
+    draw_border(game->main_win.window);
+}
+
+/**
+ * compose_frame - Draws a published frame into the virtual screen
+ * @main_win: arena window
+ * @status_win: status window
+ * @frame: the frame to draw
+ * @list: draw list used to batch the sprites
+ *
+ * Every frame repaints the arena from scratch; ncurses still only sends the
+ * cells that changed since the last doupdate().
+ *
+ * RETURNS
+ * Void.
+ */
+void compose_frame(const WIN* main_win, const WIN* status_win, const Frame* frame,
+                   DrawList* list) {
+    werase(main_win->window);
+    draw_border(main_win->window);
+    draw_list_build(list, main_win, frame);
+    draw_list_submit(list, main_win->window);
+    wnoutrefresh(main_win->window);
+    draw_status(status_win->window, frame);
+}
+
+void draw_frame(const WIN* main_win, const WIN* status_win, const Frame* frame, DrawList* list) {
+    compose_frame(main_win, status_win, frame, list);
+    doupdate();
+}
+
 void draw_ascii_art(Game* game, const int center_x, const int art_start_y, const char** ascii_art,
                     const int art_lines, const ColorPair color) {
     WINDOW* win = game->main_win.window;
@@ -95,7 +205,6 @@ void draw_ascii_art(Game* game, const int center_x, const int art_start_y, const
         mvwprintw(win, art_start_y + i, x, "%s", ascii_art[i]);
     }
     wattroff(win, COLOR_PAIR(color));
-    wrefresh(win);
 }
 
 void draw_logo(Game* game, const int center_x, const int art_start_y) {
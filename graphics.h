@@ -3,11 +3,14 @@
 
 #include "types.h"
 
+FrameSprite frame_sprite(const entity_t* entity);
+int sprite_visible(const FrameSprite* sprite, const WIN* area);
 void draw_sprite(Game* game, entity_t* entity);
 void remove_sprite(Game* game, entity_t* entity);
 
-void draw_status(Game* game);
 void draw_main(Game* game);
+void compose_frame(const WIN* main_win, const WIN* status_win, const Frame* frame, DrawList* list);
+void draw_frame(const WIN* main_win, const WIN* status_win, const Frame* frame, DrawList* list);
 void draw_ascii_art(Game* game, const int center_x, const int art_start_y, const char** ascii_art,
                     const int art_lines);
 void draw_logo(Game* game, const int center_x, const int art_start_y);
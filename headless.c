@@ -0,0 +1,186 @@
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "conf.h"
+#include "game.h"
+#include "headless.h"
+#include "mem.h"
+#include "pool.h"
+#include "replay.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * A headless game is the simulation alone: no windows, render thread,
+ * broadcast, replay recording or rewind capture, and no pacing between
+ * ticks. Nothing here touches global state, so any number of games can run
+ * in parallel, whether played by bots or played back from replays.
+ */
+
+/**
+ * headless_run - Plays one game with a bot as fast as it simulates
+ * @config: level configuration; only read, so it may be shared between games
+ * @seed: seed to play with instead of the level's own
+ * @bot: the bot playing
+ * @result: receives the outcome
+ *
+ * RETURNS
+ * Void.
+ */
+void headless_run(const conf_t* config, const int seed, const BotPlugin* bot,
+                  HeadlessResult* result) {
+    Game game = {0};
+    game.replay.fd = -1;
+    game.replay.replay_state = REPLAY_OFF;
+    game.config = *config;
+    game.config.seed = seed;
+    size_windows(&game.main_win, &game.status_win, &game.config);
+    game.bot = bot;
+    game.bot_state = bot->init ? bot->init(seed) : NULL;
+
+    prepare_game(&game);
+    while (game.running) {
+        simulate_tick(&game);
+    }
+
+    result->score = game.score;
+    result->result = game.result;
+    result->stars_collected = game.stars_collected;
+    result->hp = game.entities.swallow->hp;
+    result->ticks = game.replay.tick;
+    result->time_left = game.time_left;
+
+    if (bot->free) {
+        bot->free(game.bot_state);
+    }
+    release_game(&game);
+    mem_free(game.entities.swallow);
+}
+
+/**
+ * headless_playback_start - Prepares a headless playback of an opened replay
+ * @game: zeroed game whose replay has been opened with replay_open()
+ *
+ * The level and seed come from the replay; run simulate_tick() until the
+ * game stops and finish with headless_playback_finish().
+ *
+ * RETURNS
+ * Void.
+ */
+void headless_playback_start(Game* game) {
+    game->config = read_config_data(replay_level_data(&game->replay),
+                                    game->replay.header.level_size);
+    game->config.seed = game->replay.header.seed;
+    size_windows(&game->main_win, &game->status_win, &game->config);
+    game->replay.replay_state = REPLAY_PLAYING;
+    replay_start_playback(&game->replay);
+    prepare_game(game);
+}
+
+void headless_playback_finish(Game* game) {
+    release_game(game);
+    mem_free(game->entities.swallow);
+    game->entities.swallow = NULL;
+    free_config(&game->config);
+}
+
+static void export_path_for(const ReplayExportJob* job, const char* replay_path, char* buffer,
+                            const size_t size) {
+    char* copy = strdup(replay_path);
+    if (!copy) {
+        exit(1);
+    }
+    char* name = basename(copy);
+    char* dot = strrchr(name, '.');
+    if (dot) {
+        *dot = '\0';
+    }
+    snprintf(buffer, size, "%s/%s%s", job->dir, name, job->ext);
+    free(copy);
+}
+
+static void export_task(void* ctx, const int index) {
+    const ReplayExportJob* job = (const ReplayExportJob*)ctx;
+    char path[MAX_LINE_LENGTH];
+    export_path_for(job, job->replays[index], path, sizeof(path));
+    job->failed[index] = job->export_fn(job->replays[index], path) != 0;
+}
+
+static void add_replays(ReplayExportJob* job, const char* arg) {
+    struct stat st;
+    char** found = NULL;
+    int count = 0;
+
+    if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+        count = list_files(arg, ".swr", &found);
+    } else {
+        found = (char**)malloc(sizeof(char*));
+        if (!found || !(found[0] = strdup(arg))) {
+            exit(1);
+        }
+        count = 1;
+    }
+    char** tmp = (char**)realloc((void*)job->replays, sizeof(char*) * (size_t)(job->count + count));
+    if (!tmp && job->count + count > 0) {
+        exit(1);
+    }
+    job->replays = tmp;
+    memcpy((void*)(job->replays + job->count), (void*)found, sizeof(char*) * (size_t)count);
+    job->count += count;
+    free((void*)found);
+}
+
+/**
+ * run_replay_export - Exports replays and replay directories in parallel
+ * @args: replay files and directories of replays; none for the replay library
+ * @count: number of entries in @args
+ * @threads: threads to export on, 0 for one per core
+ * @dir: directory the exports are written to
+ * @ext: file name extension of the exports
+ * @export_fn: writes the export of one replay
+ *
+ * Each replay NAME.swr becomes DIR/NAME.EXT.
+ *
+ * RETURNS
+ * The process exit status: 0 if every replay was exported, 1 otherwise.
+ */
+int run_replay_export(const char** args, const int count, int threads, const char* dir,
+                      const char* ext, const ReplayExportFn export_fn) {
+    ReplayExportJob job = {NULL, 0, NULL, export_fn, dir, ext};
+    for (int i = 0; i < count; i++) {
+        add_replays(&job, args[i]);
+    }
+    if (count == 0) {
+        add_replays(&job, REPLAY_DIR);
+    }
+    job.failed = (int*)calloc((size_t)job.count + 1, sizeof(int));
+    if (!job.failed) {
+        exit(1);
+    }
+    mkdir(dir, 0755);
+    threads = threads > 0 ? threads : pool_default_threads();
+
+    Pool pool;
+    pool_start(&pool, threads);
+    const uint64_t start = monotonic_us();
+    pool_run(&pool, export_task, &job, job.count);
+    const uint64_t elapsed = monotonic_us() - start;
+    pool_stop(&pool);
+
+    int failed = 0;
+    for (int i = 0; i < job.count; i++) {
+        if (job.failed[i]) {
+            fprintf(stderr, "%s: cannot export\n", job.replays[i]);
+            failed++;
+        }
+        free(job.replays[i]);
+    }
+    fprintf(stderr, "%d of %d replays exported to %s/ in %.2f s on %d threads\n",
+            job.count - failed, job.count, dir, (double)elapsed / 1000000.0, threads);
+    free((void*)job.replays);
+    free(job.failed);
+    return failed > 0 || job.count == 0;
+}
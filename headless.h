@@ -0,0 +1,12 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "types.h"
+
+void headless_run(const conf_t* config, int seed, const BotPlugin* bot, HeadlessResult* result);
+void headless_playback_start(Game* game);
+void headless_playback_finish(Game* game);
+int run_replay_export(const char** args, int count, int threads, const char* dir, const char* ext,
+                      ReplayExportFn export_fn);
+
+#endif  // HEADLESS_H
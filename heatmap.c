@@ -0,0 +1,372 @@
+#include <ncurses.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "game.h"
+#include "headless.h"
+#include "heatmap.h"
+#include "pool.h"
+#include "replay.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * Every replay in a directory is played back headless on the worker pool.
+ * Each replay counts into its own partial heatmap, so workers never share
+ * counters; once the pool is done the partials are summed per level (keyed
+ * by the hash of the level file the replay embeds) and written out.
+ */
+
+static const char* const layer_names[HEAT_LAYERS] = {"swallow presence", "hp loss",
+                                                     "star pickups", "hunter occupancy"};
+static const ColorPair layer_ramps[HEAT_LAYERS] = {C_BLUE_1, C_RED_1, C_YELLOW_1, C_PURPLE_1};
+static const char ramp_glyphs[HEATMAP_RAMP_STEPS + 1] = " .:+#@";
+
+static uint32_t* heat_plane(const Heatmap* map, const HeatLayer layer) {
+    return map->cells + ((size_t)layer * (size_t)map->rows * (size_t)map->cols);
+}
+
+static void heat_add_rect(Heatmap* map, const HeatLayer layer, const entity_t* ent) {
+    uint32_t* plane = heat_plane(map, layer);
+    for (int y = ent->y; y < ent->y + ent->height; y++) {
+        for (int x = ent->x; x < ent->x + ent->width; x++) {
+            if (y >= 0 && y < map->rows && x >= 0 && x < map->cols) {
+                plane[(y * map->cols) + x]++;
+            }
+        }
+    }
+}
+
+static void heat_add_centre(Heatmap* map, const HeatLayer layer, const entity_t* ent,
+                            const int amount) {
+    const int y = ent->y + (ent->height / 2);
+    const int x = ent->x + (ent->width / 2);
+    if (y >= 0 && y < map->rows && x >= 0 && x < map->cols) {
+        heat_plane(map, layer)[(y * map->cols) + x] += (uint32_t)amount;
+    }
+}
+
+/**
+ * heat_sample - Counts the state at the end of a tick
+ * @map: partial heatmap of the replay
+ * @game: game being played back
+ * @hp_before: swallow hp at the end of the previous tick, -1 on the first tick
+ * @stars_before: stars collected at the end of the previous tick
+ *
+ * RETURNS
+ * Void.
+ */
+static void heat_sample(Heatmap* map, const Game* game, const int hp_before,
+                        const int stars_before) {
+    const Swallow* swallow = game->entities.swallow;
+    heat_add_rect(map, HEAT_PRESENCE, &swallow->ent);
+    for (const Hunter* hu = game->entities.hunters; hu; hu = hu->next) {
+        heat_add_rect(map, HEAT_HUNTERS, &hu->ent);
+    }
+    if (hp_before >= 0 && swallow->hp < hp_before) {
+        heat_add_centre(map, HEAT_HP_LOSS, &swallow->ent, 1);
+    }
+    if (game->stars_collected > stars_before) {
+        heat_add_centre(map, HEAT_STAR_PICKUP, &swallow->ent,
+                        game->stars_collected - stars_before);
+    }
+    map->ticks++;
+}
+
+static void alloc_heatmap(Heatmap* map, const int rows, const int cols) {
+    map->rows = rows;
+    map->cols = cols;
+    map->cells = (uint32_t*)calloc((size_t)HEAT_LAYERS * (size_t)rows * (size_t)cols,
+                                   sizeof(uint32_t));
+    if (!map->cells) {
+        exit(1);
+    }
+}
+
+/**
+ * heatmap_task - Plays one replay back and fills its partial heatmap
+ * @ctx: the HeatmapJob
+ * @index: replay to play
+ *
+ * Replays that cannot be opened or that desync leave their partial empty.
+ *
+ * RETURNS
+ * Void.
+ */
+static void heatmap_task(void* ctx, const int index) {
+    const HeatmapJob* job = (const HeatmapJob*)ctx;
+    Heatmap* map = &job->partials[index];
+    Game game = {0};
+    game.replay.fd = -1;
+    game.replay.replay_state = REPLAY_OFF;
+
+    if (replay_open(&game.replay, job->paths[index]) == 0) {
+        headless_playback_start(&game);
+        map->level_hash = game.replay.header.level_hash;
+        map->level_nr = game.replay.header.level_nr;
+        alloc_heatmap(map, game.arena_rows, game.arena_cols);
+
+        int hp = -1;
+        int stars = 0;
+        while (game.running) {
+            simulate_tick(&game);
+            heat_sample(map, &game, hp, stars);
+            hp = game.entities.swallow->hp;
+            stars = game.stars_collected;
+        }
+        map->replays = 1;
+        if (game.replay.desynced) {
+            free(map->cells);
+            memset(map, 0, sizeof(*map));
+        }
+        headless_playback_finish(&game);
+    }
+    replay_free(&game.replay);
+}
+
+/**
+ * merge_partials - Sums the partial heatmaps per level
+ * @job: finished job
+ * @levels: receives a heap array of one heatmap per level, in replay order
+ *
+ * A partial is only merged into a level heatmap of the same size; the
+ * partials' cells are freed as they are merged.
+ *
+ * RETURNS
+ * Number of levels.
+ */
+static int merge_partials(const HeatmapJob* job, Heatmap** levels) {
+    int count = 0;
+    *levels = NULL;
+
+    for (int i = 0; i < job->count; i++) {
+        Heatmap* part = &job->partials[i];
+        if (!part->cells) {
+            continue;
+        }
+        int l = 0;
+        while (l < count && ((*levels)[l].level_hash != part->level_hash ||
+                             (*levels)[l].rows != part->rows || (*levels)[l].cols != part->cols)) {
+            l++;
+        }
+        if (l == count) {
+            Heatmap* tmp = (Heatmap*)realloc(*levels, sizeof(Heatmap) * (size_t)(count + 1));
+            if (!tmp) {
+                exit(1);
+            }
+            *levels = tmp;
+            (*levels)[count++] = *part;
+            part->cells = NULL;
+            continue;
+        }
+        Heatmap* level = &(*levels)[l];
+        const size_t cells = (size_t)HEAT_LAYERS * (size_t)level->rows * (size_t)level->cols;
+        for (size_t c = 0; c < cells; c++) {
+            level->cells[c] += part->cells[c];
+        }
+        level->replays += part->replays;
+        level->ticks += part->ticks;
+        free(part->cells);
+        part->cells = NULL;
+    }
+    return count;
+}
+
+static int save_heatmap(const Heatmap* map, char* path, const size_t size) {
+    snprintf(path, size, "%s/level_%02d_%016llx.bin", HEATMAP_DIR, map->level_nr,
+             (unsigned long long)map->level_hash);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    HeatmapFileHeader header = {0};
+    memcpy(header.magic, HEATMAP_MAGIC, sizeof(header.magic));
+    header.version = HEATMAP_VERSION;
+    header.level_nr = (uint32_t)map->level_nr;
+    header.rows = (uint32_t)map->rows;
+    header.cols = (uint32_t)map->cols;
+    header.replays = (uint32_t)map->replays;
+    header.level_hash = map->level_hash;
+    header.ticks = map->ticks;
+
+    const size_t cells = (size_t)HEAT_LAYERS * (size_t)map->rows * (size_t)map->cols;
+    const int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(map->cells, sizeof(uint32_t), cells, file) == cells;
+    return fclose(file) == 0 && ok ? 0 : -1;
+}
+
+/**
+ * ramp_step - Picks the shade of a cell
+ * @value: cell count
+ * @max: largest count on screen
+ *
+ * Each step halves the count needed, so sparse events stay visible next to
+ * hot spots.
+ *
+ * RETURNS
+ * 0 for an empty cell, otherwise 1 to HEATMAP_RAMP_STEPS.
+ */
+static int ramp_step(const uint64_t value, const uint64_t max) {
+    if (value == 0) {
+        return 0;
+    }
+    int step = 1;
+    for (int i = 1; i < HEATMAP_RAMP_STEPS; i++) {
+        if (value << (HEATMAP_RAMP_STEPS - i) > max) {
+            step++;
+        }
+    }
+    return step;
+}
+
+/**
+ * bin_heatmap - Shrinks a heatmap plane to the screen
+ * @map: heatmap
+ * @layer: plane to shrink
+ * @bins: rows * cols sums, one per screen cell
+ * @rows: screen rows
+ * @cols: screen columns
+ *
+ * RETURNS
+ * The largest sum.
+ */
+static uint64_t bin_heatmap(const Heatmap* map, const HeatLayer layer, uint64_t* bins,
+                            const int rows, const int cols) {
+    const uint32_t* plane = heat_plane(map, layer);
+    uint64_t max = 0;
+
+    memset(bins, 0, sizeof(uint64_t) * (size_t)rows * (size_t)cols);
+    for (int y = 0; y < map->rows; y++) {
+        for (int x = 0; x < map->cols; x++) {
+            uint64_t* bin = &bins[(y * rows / map->rows * cols) + (x * cols / map->cols)];
+            *bin += plane[(y * map->cols) + x];
+            if (*bin > max) {
+                max = *bin;
+            }
+        }
+    }
+    return max;
+}
+
+static void draw_heatmap(const Heatmap* map, const HeatLayer layer) {
+    const int rows = LINES - 1 < map->rows ? LINES - 1 : map->rows;
+    const int cols = COLS < map->cols ? COLS : map->cols;
+    if (rows <= 0 || cols <= 0) {
+        return;
+    }
+    uint64_t* bins = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)rows * (size_t)cols);
+    if (!bins) {
+        exit(1);
+    }
+    const uint64_t max = bin_heatmap(map, layer, bins, rows, cols);
+
+    erase();
+    attron(A_BOLD);
+    mvprintw(0, 0, "Level %d: %s, %d replays, %llu ticks  [tab] layer [n] level [q] quit",
+             map->level_nr, layer_names[layer], map->replays, (unsigned long long)map->ticks);
+    attroff(A_BOLD);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            const int step = ramp_step(bins[(y * cols) + x], max);
+            if (step > 0) {
+                const ColorPair color = (ColorPair)(layer_ramps[layer] + step - 1);
+                attron(COLOR_PAIR(color));
+                mvaddch(y + 1, x, ramp_glyphs[step]);
+                attroff(COLOR_PAIR(color));
+            }
+        }
+    }
+    refresh();
+    free(bins);
+}
+
+static void preview_heatmaps(const Heatmap* levels, const int count) {
+    int level = 0;
+    HeatLayer layer = HEAT_PRESENCE;
+    int ch = 0;
+
+    init_curses();
+    nodelay(stdscr, FALSE);
+    while (ch != 'q') {
+        draw_heatmap(&levels[level], layer);
+        ch = getch();
+        if (ch == '\t') {
+            layer = (HeatLayer)((layer + 1) % HEAT_LAYERS);
+        } else if (ch == 'n') {
+            level = (level + 1) % count;
+        }
+    }
+    endwin();
+}
+
+static int write_heatmaps(const Heatmap* levels, const int count) {
+    int failed = 0;
+    mkdir(HEATMAP_DIR, 0755);
+    for (int i = 0; i < count; i++) {
+        char path[MAX_LINE_LENGTH];
+        if (save_heatmap(&levels[i], path, sizeof(path)) != 0) {
+            fprintf(stderr, "Cannot write %s\n", path);
+            failed = 1;
+            continue;
+        }
+        printf("level %-3d %4d replays %10llu ticks  %dx%d  %s\n", levels[i].level_nr,
+               levels[i].replays, (unsigned long long)levels[i].ticks, levels[i].cols,
+               levels[i].rows, path);
+    }
+    return failed;
+}
+
+/**
+ * run_heatmap - Aggregates a directory of replays into per-level heatmaps
+ * @dir: directory holding the .swr replays
+ * @threads: threads to replay on, 0 for one per core
+ * @preview: non-zero to browse the heatmaps in the terminal afterwards
+ *
+ * RETURNS
+ * The process exit status: 0 on success, 1 if nothing could be aggregated
+ * or a heatmap could not be written.
+ */
+int run_heatmap(const char* dir, int threads, const int preview) {
+    HeatmapJob job = {0};
+    job.count = list_files(dir, ".swr", &job.paths);
+    job.partials = (Heatmap*)calloc((size_t)job.count + 1, sizeof(Heatmap));
+    if (!job.partials) {
+        exit(1);
+    }
+    threads = threads > 0 ? threads : pool_default_threads();
+
+    Pool pool;
+    pool_start(&pool, threads);
+    const uint64_t start = monotonic_us();
+    pool_run(&pool, heatmap_task, &job, job.count);
+    const uint64_t elapsed = monotonic_us() - start;
+    pool_stop(&pool);
+
+    Heatmap* levels = NULL;
+    const int level_count = merge_partials(&job, &levels);
+    int replays = 0;
+    for (int i = 0; i < level_count; i++) {
+        replays += levels[i].replays;
+    }
+    fprintf(stderr, "%d of %d replays in %s aggregated in %.2f s on %d threads\n", replays,
+            job.count, dir, (double)elapsed / 1000000.0, threads);
+
+    const int failed = level_count == 0 || write_heatmaps(levels, level_count);
+    if (preview && level_count > 0) {
+        preview_heatmaps(levels, level_count);
+    }
+
+    for (int i = 0; i < level_count; i++) {
+        free(levels[i].cells);
+    }
+    for (int i = 0; i < job.count; i++) {
+        free(job.paths[i]);
+    }
+    free(levels);
+    free((void*)job.paths);
+    free(job.partials);
+    return failed;
+}
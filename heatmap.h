@@ -0,0 +1,8 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include "types.h"
+
+int run_heatmap(const char* dir, int threads, int preview);
+
+#endif  // HEATMAP_H
@@ -3,14 +3,16 @@
 
 #include "entity.h"
 #include "graphics.h"
+#include "mem.h"
 #include "physics.h"
 #include "types.h"
+#include "utils.h"
 
 static void get_spawn_coordinates(Game* game, entity_t* hunter_ent, const direction_t side) {
     const int w = hunter_ent->width;
     const int h = hunter_ent->height;
-    int max_r = game->main_win.rows - h - BORDER_WIDTH;
-    int max_c = game->main_win.cols - w - BORDER_WIDTH;
+    int max_r = game->arena_rows - h - BORDER_WIDTH;
+    int max_c = game->arena_cols - w - BORDER_WIDTH;
     if (max_r <= 0) {
         max_r = 1;
     }
@@ -24,18 +26,18 @@ static void get_spawn_coordinates(Game* game, entity_t* hunter_ent, const direct
     switch (side) {
         case DIR_RIGHT:
             x = BORDER_WIDTH;
-            y = BORDER_WIDTH + (rand() % max_r);
+            y = BORDER_WIDTH + (game_rand(game) % max_r);
             break;
         case DIR_LEFT:
             x = max_c;
-            y = BORDER_WIDTH + (rand() % max_r);
+            y = BORDER_WIDTH + (game_rand(game) % max_r);
             break;
         case DIR_DOWN:
-            x = BORDER_WIDTH + (rand() % max_c);
+            x = BORDER_WIDTH + (game_rand(game) % max_c);
             y = BORDER_WIDTH;
             break;
         case DIR_UP:
-            x = BORDER_WIDTH + (rand() % max_c);
+            x = BORDER_WIDTH + (game_rand(game) % max_c);
             y = max_r;
             break;
         default:
@@ -75,8 +77,8 @@ static void setup_hunter_physics(Hunter* hun, const int x, const int y, const di
  * RETRUNS
  * Pointer to the new Hunter, or NULL if malloc fails.
  */
-static Hunter* init_hunter_data(Game* game, const int template_idx) {
-    Hunter* hun = (Hunter*)malloc(sizeof(Hunter));
+Hunter* init_hunter_data(Game* game, const int template_idx) {
+    Hunter* hun = (Hunter*)mem_alloc(MEM_ENTITIES, sizeof(Hunter));
     if (!hun) {
         return NULL;
     }
@@ -98,12 +100,15 @@ static Hunter* init_hunter_data(Game* game, const int template_idx) {
     hun->state_timer = 0;
     hun->dash_cooldown = 0;
     hun->base_speed = t->speed;
+    hun->template_idx = template_idx;
 
     for (int i = 0; i < NUM_DIRECTIONS; i++) {
         hun->ent.anim_sprites[i] = NULL;
     }
     hun->ent.anim_frame = 0;
     hun->ent.anim_timer = 0;
+    hun->ent.hash = 0;
+    hun->ent.id = 0;
 
     hun->next = NULL;
 
@@ -111,8 +116,8 @@ static Hunter* init_hunter_data(Game* game, const int template_idx) {
 }
 
 void spawn_hunter(Game* game) {
-    const int t_idx = rand() % game->config.hunter_templates_amount;
-    const direction_t dir = (direction_t)(rand() % NUM_DIRECTIONS);
+    const int t_idx = game_rand(game) % game->config.hunter_templates_amount;
+    const direction_t dir = (direction_t)(game_rand(game) % NUM_DIRECTIONS);
 
     Hunter* new_hunter = init_hunter_data(game, t_idx);
     if (!new_hunter) {
@@ -130,6 +135,7 @@ void spawn_hunter(Game* game) {
 
     setup_hunter_physics(new_hunter, new_hunter->ent.x, new_hunter->ent.y, dir);
 
+    new_hunter->ent.id = ++game->next_entity_id;
     new_hunter->next = game->entities.hunters;
     game->entities.hunters = new_hunter;
 }
@@ -164,14 +170,12 @@ static int resolve_hunter_collision(Game* game, Hunter** curr, Hunter* prev,
         int hit_x = 0;
         int hit_y = 0;
 
-        if (check_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols,
-                                h->ent.x + h->ent.dx, h->ent.y, h->ent.width,
+        if (check_occupancy_map(&game->occupancy_map, h->ent.x + h->ent.dx, h->ent.y, h->ent.width,
                                 h->ent.height) != EMPTY) {
             hit_x = 1;
         }
 
-        if (check_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols,
-                                h->ent.x, h->ent.y + h->ent.dy, h->ent.width,
+        if (check_occupancy_map(&game->occupancy_map, h->ent.x, h->ent.y + h->ent.dy, h->ent.width,
                                 h->ent.height) != EMPTY) {
             hit_y = 1;
         }
@@ -263,8 +267,6 @@ void process_hunters(Game* game) {
 
     while (current != NULL) {
         if (handle_hunter_logic(current, game->entities.swallow)) {
-            draw_sprite(game, &current->ent);
-
             prev = current;
             current = current->next;
             continue;
@@ -5,6 +5,7 @@
 
 void process_hunters(Game* game);
 void spawn_hunter(Game* game);
+Hunter* init_hunter_data(Game* game, int template_idx);
 Hunter* remove_hunter(Game* game, Hunter* current, Hunter* prev);
 void free_hunters(Game* game);
 
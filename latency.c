@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "latency.h"
+#include "output.h"
+#include "types.h"
+
+/*
+ * Input-to-photon latency: every key the player presses is stamped when it
+ * is read from the terminal, together with the sequence number of the first
+ * frame that will show its effect. The output relay notes the sequence
+ * number and time of each frame once its last byte was written to the tty
+ * (see output.c), and the simulation settles the stamps of every frame
+ * shown so far. Dropped or replaced frames need no care: a later frame
+ * carries their changes, and its higher sequence number settles their keys.
+ */
+
+void latency_begin(LatencyStats* stats) {
+    stats->pending_count = 0;
+    stats->report.tag = MEM_UI;
+    memset(stats->buckets, 0, sizeof(stats->buckets));
+    stats->keys = 0;
+    stats->total_us = 0;
+    stats->max_us = 0;
+}
+
+/**
+ * latency_key_read - Stamps a key the player pressed
+ * @game: Main game struct
+ * @read_us: monotonic_us() when the key was read
+ *
+ * Its effect is first visible in the next frame published. Keys beyond
+ * LATENCY_PENDING_KEYS waiting at once are not measured.
+ *
+ * RETURNS
+ * Void.
+ */
+void latency_key_read(Game* game, const uint64_t read_us) {
+    LatencyStats* stats = &game->latency;
+    if (stats->pending_count < LATENCY_PENDING_KEYS) {
+        stats->pending[stats->pending_count++] =
+                (KeyStamp){game->renderer.published + 1, read_us};
+    }
+}
+
+static void record(LatencyStats* stats, const uint64_t latency_us) {
+    const uint64_t bucket = latency_us / LATENCY_BUCKET_US;
+    stats->buckets[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    stats->keys++;
+    stats->total_us += latency_us;
+    if (latency_us > stats->max_us) {
+        stats->max_us = latency_us;
+    }
+}
+
+static void settle(LatencyStats* stats, const uint32_t shown_seq, const uint64_t shown_us) {
+    int kept = 0;
+    for (int i = 0; i < stats->pending_count; i++) {
+        const KeyStamp* stamp = &stats->pending[i];
+        if ((int32_t)(stamp->seq - shown_seq) <= 0) {
+            record(stats, shown_us > stamp->read_us ? shown_us - stamp->read_us : 0);
+        } else {
+            stats->pending[kept++] = *stamp;
+        }
+    }
+    stats->pending_count = kept;
+}
+
+/**
+ * latency_poll - Settles the keys whose frame has reached the terminal
+ * @game: Main game struct
+ *
+ * Takes the output lock only while keys are pending.
+ *
+ * RETURNS
+ * Void.
+ */
+void latency_poll(Game* game) {
+    uint32_t shown_seq = 0;
+    uint64_t shown_us = 0;
+    if (game->latency.pending_count == 0) {
+        return;
+    }
+    output_frame_shown(&shown_seq, &shown_us);
+    settle(&game->latency, shown_seq, shown_us);
+}
+
+static int percentile_ms(const LatencyStats* stats, const int percent) {
+    const uint64_t rank = (((uint64_t)stats->keys * (uint64_t)percent) + 99) / 100;
+    uint64_t seen = 0;
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (seen += stats->buckets[bucket]) < rank) {
+        bucket++;
+    }
+    return (bucket + 1) * LATENCY_BUCKET_US / 1000;
+}
+
+static void put_line(ByteBuffer* out, const char* line) {
+    buffer_put_bytes(out, line, strlen(line));
+}
+
+/**
+ * put_histogram - Appends the distribution in power-of-two millisecond ranges
+ * @stats: the session's latencies
+ *
+ * RETURNS
+ * Void.
+ */
+static void put_histogram(LatencyStats* stats) {
+    char line[MAX_LINE_LENGTH];
+    int low = 0;
+    for (int high = 1; low < LATENCY_BUCKETS; high *= 2) {
+        uint32_t count = 0;
+        for (int b = low; b < high && b < LATENCY_BUCKETS; b++) {
+            count += stats->buckets[b];
+        }
+        if (count > 0) {
+            char bar[41] = {0};
+            memset(bar, '#', (size_t)(((uint64_t)count * 40 + stats->keys - 1) / stats->keys));
+            snprintf(line, sizeof(line), "  %4d-%-4d ms %7u %s\n", low, high, count, bar);
+            put_line(&stats->report, line);
+        }
+        low = high;
+    }
+}
+
+/**
+ * latency_end - Settles the last keys of a session and summarises it
+ * @game: Main game struct, after render_stop()
+ *
+ * Percentiles are upper bounds at LATENCY_BUCKET_US resolution. Keys whose
+ * frame never reached the screen are left out.
+ *
+ * RETURNS
+ * Void.
+ */
+void latency_end(Game* game) {
+    LatencyStats* stats = &game->latency;
+    char line[MAX_LINE_LENGTH];
+    uint32_t shown_seq = 0;
+    uint64_t shown_us = 0;
+
+    output_frame_shown(&shown_seq, &shown_us);
+    settle(stats, shown_seq, shown_us);
+    stats->sessions++;
+    if (stats->keys == 0) {
+        snprintf(line, sizeof(line), "session %d, level %d: no keys\n", stats->sessions,
+                 game->config.level_nr);
+        put_line(&stats->report, line);
+        return;
+    }
+    snprintf(line, sizeof(line),
+             "session %d, level %d: %u keys, mean %.1f ms, p50 %d ms, p90 %d ms, p99 %d ms, "
+             "max %.1f ms\n",
+             stats->sessions, game->config.level_nr, stats->keys,
+             (double)stats->total_us / stats->keys / 1000.0, percentile_ms(stats, 50),
+             percentile_ms(stats, 90), percentile_ms(stats, 99), (double)stats->max_us / 1000.0);
+    put_line(&stats->report, line);
+    put_histogram(stats);
+}
+
+void latency_free(LatencyStats* stats) {
+    buffer_free(&stats->report);
+}
@@ -0,0 +1,12 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "types.h"
+
+void latency_begin(LatencyStats* stats);
+void latency_key_read(Game* game, uint64_t read_us);
+void latency_poll(Game* game);
+void latency_end(Game* game);
+void latency_free(LatencyStats* stats);
+
+#endif  // LATENCY_H
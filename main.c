@@ -1,29 +1,197 @@
 #include <locale.h>
 #include <ncurses.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "broadcast.h"
+#include "cast.h"
 #include "conf.h"
+#include "events.h"
+#include "heatmap.h"
 #include "hunter.h"
+#include "latency.h"
+#include "mem.h"
 #include "menu.h"
+#include "output.h"
+#include "replay.h"
+#include "rewind.h"
+#include "spectator.h"
 #include "star.h"
+#include "sweep.h"
+#include "tournament.h"
+#include "trajectory.h"
 #include "types.h"
 #include "utils.h"
+#include "verify.h"
 
-int main() {
+static int is_headless_mode(const char* arg) {
+    return strcmp(arg, "--tournament") == 0 || strcmp(arg, "--sweep") == 0 ||
+           strcmp(arg, "--verify-rankings") == 0 || strcmp(arg, "--heatmap") == 0 ||
+           strcmp(arg, "--cast") == 0 || strcmp(arg, "--trajectory") == 0 ||
+           strcmp(arg, "--broadcasts") == 0;
+}
+
+static int run_headless_mode(const char* mode, const char** args, const int count,
+                             const HeadlessOptions* options) {
+    const int tournament = strcmp(mode, "--tournament") == 0;
+    const int sweep = strcmp(mode, "--sweep") == 0;
+
+    if ((tournament || sweep) && count == 0) {
+        fprintf(stderr, "usage: swallow --tournament BOT.so... [--seeds N] [--threads N]\n"
+                        "       swallow --sweep LEVEL KEY=LO:HI:STEP|KEY=V1,V2... "
+                        "[--policy random|idle|BOT.so] [--seeds N] [--threads N]\n");
+        return 1;
+    }
+    if (tournament) {
+        return run_tournament(args, count, options->seeds, options->threads);
+    }
+    if (sweep) {
+        return run_sweep(args[0], args + 1, count - 1, options->seeds, options->threads,
+                         options->policy);
+    }
+    if (strcmp(mode, "--cast") == 0) {
+        return run_cast_export(args, count, options->threads);
+    }
+    if (strcmp(mode, "--trajectory") == 0) {
+        return run_trajectory_export(args, count, options->threads);
+    }
+    if (strcmp(mode, "--broadcasts") == 0) {
+        return run_broadcast_list();
+    }
+    if (strcmp(mode, "--verify-rankings") == 0) {
+        return run_verify_rankings(options->threads);
+    }
+    return run_heatmap(count > 0 ? args[0] : REPLAY_DIR, options->threads, options->preview);
+}
+
+/**
+ * headless_main - Runs a headless mode if one was asked for
+ * @argc: argument count
+ * @argv: arguments; plain arguments are the bot plug-ins of --tournament,
+ *        the level and KEY=RANGE parameters of --sweep, the replay
+ *        directory of --heatmap, or the replays and directories of --cast
+ *        and --trajectory
+ *
+ * RETURNS
+ * The exit status of the run, or -1 if no headless mode was asked for.
+ */
+static int headless_main(const int argc, char** argv) {
+    const char** args = (const char**)calloc((size_t)argc, sizeof(char*));
+    const char* mode = NULL;
+    HeadlessOptions options = {NULL, 0, 0, isatty(STDOUT_FILENO)};
+    int count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (is_headless_mode(argv[i])) {
+            mode = argv[i];
+        } else if (strcmp(argv[i], "--no-preview") == 0) {
+            options.preview = 0;
+        } else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+            options.seeds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            options.policy = argv[++i];
+        } else if (argv[i][0] != '-') {
+            args[count++] = argv[i];
+        }
+    }
+
+    const int status = mode ? run_headless_mode(mode, args, count, &options) : -1;
+    free((void*)args);
+    return status;
+}
+
+static int has_flag(const int argc, char** argv, const char* flag) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * free_game - Releases the game and prints the reports asked for
+ * @game: Main game struct
+ * @argc: argument count
+ * @argv: arguments; --latency-report and --mem-report print to stderr
+ *
+ * The memory report comes last, so whatever it shows as live has leaked.
+ *
+ * RETURNS
+ * Void.
+ */
+static void free_game(Game* game, const int argc, char** argv) {
+    const ByteBuffer* latency = &game->latency.report;
+    if (has_flag(argc, argv, "--latency-report") && latency->len > 0) {
+        fwrite(latency->data, 1, latency->len, stderr);
+    }
+    if (game->username) {
+        mem_free(game->username);
+    }
+    free_config(&game->config);
+
+    replay_free(&game->replay);
+    rewind_free(&game->rewind);
+    broadcast_close(&game->broadcast);
+    latency_free(&game->latency);
+
+    if (has_flag(argc, argv, "--mem-report")) {
+        mem_report(stderr);
+    }
+}
+
+static void run_menu(Game* game) {
+    events_open(&game->events);
+    setup_menu_window(&game->main_win);
+
+    get_username(game);
+
+    game->menu_running = 1;
+    while (game->menu_running) {
+        setup_menu_window(&game->main_win);
+        const MenuOption choice = show_start_menu(game);
+        handle_menu_choice(game, choice);
+    }
+    events_close(&game->events);
+}
+
+int main(int argc, char** argv) {
     setlocale(LC_ALL, "");
-    Game game = {0};
+    const int headless = headless_main(argc, argv);
+    if (headless >= 0) {
+        if (has_flag(argc, argv, "--mem-report")) {
+            mem_report(stderr);
+        }
+        return headless;
+    }
 
-    init_curses();
+    Game game = {0};
+    game.replay.fd = -1;
+    int spectate = 0;
+    const char* spectate_filter = NULL;
 
-    setup_menu_window(&game.main_win);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--low-bandwidth") == 0) {
+            game.low_bandwidth = 1;
+        } else if (strcmp(argv[i], "--broadcast") == 0) {
+            game.broadcast.enabled = 1;
+        } else if (strcmp(argv[i], "--spectate") == 0) {
+            spectate = 1;
+            spectate_filter = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+        }
+    }
 
-    get_username(&game);
+    output_meter_start();
+    init_curses();
 
-    game.menu_running = 1;
-    while (game.menu_running) {
-        setup_menu_window(&game.main_win);
-        const MenuOption choice = show_start_menu(&game);
-        handle_menu_choice(&game, choice);
+    if (spectate) {
+        run_spectator(spectate_filter);
+    } else {
+        run_menu(&game);
     }
 
     if (game.entities.hunters) {
@@ -33,22 +201,14 @@ int main() {
         free_stars(&game);
     }
     if (game.entities.swallow) {
-        free(game.entities.swallow);
+        mem_free(game.entities.swallow);
     }
 
     delwin(game.main_win.window);
     delwin(game.status_win.window);
     endwin();
+    output_meter_stop();
 
-    if (game.username) {
-        free(game.username);
-    }
-    free_config(&game.config);
-
-    if (game.replay.replay_keys != NULL) {
-        free(game.replay.replay_level_name);
-        free(game.replay.replay_keys);
-    }
-
+    free_game(&game, argc, argv);
     return 0;
 }
@@ -0,0 +1,187 @@
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem.h"
+#include "types.h"
+
+/*
+ * Tracked allocations carry a small header with their size and subsystem,
+ * so freeing needs nothing but the pointer. Counters are atomic because
+ * the render thread and the worker pool allocate too; the last slot holds
+ * the totals over every tag. A tracked block must be released with
+ * mem_free() and never with free().
+ */
+
+static MemCounters counters[MEM_TAGS + 1];
+
+static const char* const tag_names[MEM_TAGS] = {
+        [MEM_ENTITIES] = "entities", [MEM_CONFIG] = "config", [MEM_REPLAY] = "replay",
+        [MEM_RANKING] = "ranking",   [MEM_RENDER] = "render", [MEM_UI] = "ui",
+        [MEM_REWIND] = "rewind",     [MEM_BROADCAST] = "broadcast",
+};
+
+static void raise_peak(MemCounters* c, const uint64_t live) {
+    uint64_t peak = atomic_load(&c->peak);
+    while (live > peak && !atomic_compare_exchange_weak(&c->peak, &peak, live)) {
+    }
+}
+
+static void count_alloc(const MemTag tag, const size_t size) {
+    MemCounters* const slots[2] = {&counters[tag], &counters[MEM_TAGS]};
+    for (int i = 0; i < 2; i++) {
+        atomic_fetch_add(&slots[i]->allocs, 1);
+        raise_peak(slots[i], atomic_fetch_add(&slots[i]->live, size) + size);
+    }
+}
+
+static void count_free(const MemTag tag, const size_t size) {
+    MemCounters* const slots[2] = {&counters[tag], &counters[MEM_TAGS]};
+    for (int i = 0; i < 2; i++) {
+        atomic_fetch_add(&slots[i]->frees, 1);
+        atomic_fetch_sub(&slots[i]->live, size);
+    }
+}
+
+/**
+ * mem_alloc - Allocates a block charged to a subsystem
+ * @tag: subsystem the block belongs to
+ * @size: payload size in bytes
+ *
+ * RETURNS
+ * Pointer to the payload, or NULL if malloc fails.
+ */
+void* mem_alloc(const MemTag tag, const size_t size) {
+    MemHeader* header = (MemHeader*)malloc(sizeof(MemHeader) + size);
+    if (!header) {
+        return NULL;
+    }
+    header->size = size;
+    header->tag = tag;
+    count_alloc(tag, size);
+    return header + 1;
+}
+
+void* mem_calloc(const MemTag tag, const size_t count, const size_t size) {
+    if (size != 0 && count > (SIZE_MAX - sizeof(MemHeader)) / size) {
+        return NULL;
+    }
+    void* ptr = mem_alloc(tag, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/**
+ * mem_realloc - Resizes a tracked block
+ * @tag: subsystem to charge when @ptr is NULL
+ * @ptr: block from mem_alloc() and friends, or NULL
+ * @size: new payload size in bytes
+ *
+ * A resize counts as freeing the old block and allocating the new one, so
+ * growing arrays show up as churn.
+ *
+ * RETURNS
+ * Pointer to the resized payload, or NULL with @ptr untouched if realloc
+ * fails.
+ */
+void* mem_realloc(const MemTag tag, void* ptr, const size_t size) {
+    if (!ptr) {
+        return mem_alloc(tag, size);
+    }
+    MemHeader* header = (MemHeader*)ptr - 1;
+    const MemHeader old = *header;
+    header = (MemHeader*)realloc(header, sizeof(MemHeader) + size);
+    if (!header) {
+        return NULL;
+    }
+    count_free(old.tag, old.size);
+    header->size = size;
+    count_alloc(old.tag, size);
+    return header + 1;
+}
+
+void mem_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    MemHeader* header = (MemHeader*)ptr - 1;
+    count_free(header->tag, header->size);
+    free(header);
+}
+
+char* mem_strdup(const MemTag tag, const char* str) {
+    const size_t size = strlen(str) + 1;
+    char* copy = (char*)mem_alloc(tag, size);
+    if (copy) {
+        memcpy(copy, str, size);
+    }
+    return copy;
+}
+
+/**
+ * mem_asprintf - Formats into a tracked string
+ * @tag: subsystem the string belongs to
+ * @format: printf format
+ *
+ * RETURNS
+ * The formatted string, or NULL if formatting or allocation fails.
+ */
+char* mem_asprintf(const MemTag tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    char* str = len >= 0 ? (char*)mem_alloc(tag, (size_t)len + 1) : NULL;
+    if (str) {
+        va_start(args, format);
+        vsnprintf(str, (size_t)len + 1, format, args);
+        va_end(args);
+    }
+    return str;
+}
+
+/**
+ * mem_stats - Reads the counters of a subsystem
+ * @tag: subsystem, or MEM_TAGS for the totals over all of them
+ * @stats: receives the counters
+ *
+ * RETURNS
+ * Void.
+ */
+void mem_stats(const MemTag tag, MemStats* stats) {
+    const MemCounters* c = &counters[tag];
+    stats->allocs = atomic_load(&c->allocs);
+    stats->frees = atomic_load(&c->frees);
+    stats->live = atomic_load(&c->live);
+    stats->peak = atomic_load(&c->peak);
+}
+
+uint64_t mem_total_allocs(void) {
+    return atomic_load(&counters[MEM_TAGS].allocs);
+}
+
+/**
+ * mem_report - Prints allocation counts, live bytes and high-water marks
+ * @file: stream to print to
+ *
+ * Blocks still live when this runs at exit are leaks.
+ *
+ * RETURNS
+ * Void.
+ */
+void mem_report(FILE* file) {
+    MemStats stats;
+    fprintf(file, "%-10s %12s %12s %12s %12s\n", "subsystem", "allocs", "frees", "live B",
+            "peak B");
+    for (int tag = 0; tag <= MEM_TAGS; tag++) {
+        mem_stats((MemTag)tag, &stats);
+        fprintf(file, "%-10s %12llu %12llu %12llu %12llu\n",
+                tag < MEM_TAGS ? tag_names[tag] : "total", (unsigned long long)stats.allocs,
+                (unsigned long long)stats.frees, (unsigned long long)stats.live,
+                (unsigned long long)stats.peak);
+    }
+}
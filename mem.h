@@ -0,0 +1,18 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stdio.h>
+
+#include "types.h"
+
+void* mem_alloc(MemTag tag, size_t size);
+void* mem_calloc(MemTag tag, size_t count, size_t size);
+void* mem_realloc(MemTag tag, void* ptr, size_t size);
+void mem_free(void* ptr);
+char* mem_strdup(MemTag tag, const char* str);
+char* mem_asprintf(MemTag tag, const char* format, ...);
+void mem_stats(MemTag tag, MemStats* stats);
+uint64_t mem_total_allocs(void);
+void mem_report(FILE* file);
+
+#endif  // MEM_H
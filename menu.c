@@ -3,11 +3,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "events.h"
 #include "game.h"
 #include "graphics.h"
+#include "mem.h"
 #include "ranking.h"
+#include "replay.h"
+#include "replay_index.h"
 #include "star.h"
 #include "types.h"
 #include "utils.h"
@@ -31,11 +36,11 @@ void show_high_scores(Game* game, const int row_start) {
     }
 
     while (current != NULL && row < game->main_win.rows - 1) {
-        char* buf = NULL;
-        asprintf(&buf, "%d) %d - %s", index, current->score, current->username);
+        char* buf = mem_asprintf(MEM_UI, "%d) %d - %s", index, current->score,
+                                 current->username);
         const int length = (int)strlen(buf);
         mvwprintw(win, row, center_x - (length / 2), "%s", buf);
-        free(buf);
+        mem_free(buf);
         row++;
         index++;
         current = current->next;
@@ -50,8 +55,28 @@ void show_high_scores(Game* game, const int row_start) {
     nodelay(win, TRUE);
 }
 
-static void draw_menu_stars(Game* game, WINDOW* win) {
-    if ((rand() % MENU_STAR_AMOUNT) == 0) {
+static const char* const menu_options[] = {"START GAME",  "PRACTICE",        "REPLAY LIBRARY",
+                                           "HIGH SCORES", "CHANGE USERNAME", "EXIT"};
+
+static int is_menu_background(WINDOW* background, const int y, const int x) {
+    return (mvwinch(background, y, x) & A_CHARTEXT) == ' ';
+}
+
+/**
+ * draw_menu_stars - Moves the falling stars one step
+ * @game: Main game struct
+ * @win: menu window
+ * @background: copy of the menu's static layers
+ *
+ * Stars pass behind the logo and the text: they are only drawn on, and
+ * only erased from, cells that are blank in @background, so the static
+ * layers never need redrawing.
+ *
+ * RETURNS
+ * Void.
+ */
+static void draw_menu_stars(Game* game, WINDOW* win, WINDOW* background) {
+    if ((game_rand(game) % MENU_STAR_AMOUNT) == 0) {
         spawn_star(game);
     }
 
@@ -61,7 +86,9 @@ static void draw_menu_stars(Game* game, WINDOW* win) {
     wattron(win, A_BOLD);
 
     while (curr != NULL) {
-        remove_sprite(game, &curr->ent);
+        if (is_menu_background(background, curr->ent.y, curr->ent.x)) {
+            mvwaddch(win, curr->ent.y, curr->ent.x, ' ');
+        }
 
         curr->ent.y += curr->ent.dy;
 
@@ -74,9 +101,11 @@ static void draw_menu_stars(Game* game, WINDOW* win) {
             }
 
             curr = curr->next;
-            free(to_free);
+            mem_free(to_free);
         } else {
-            draw_sprite(game, &curr->ent);
+            if (is_menu_background(background, curr->ent.y, curr->ent.x)) {
+                draw_sprite(game, &curr->ent);
+            }
             prev = curr;
             curr = curr->next;
         }
@@ -89,84 +118,121 @@ static void cleanup_menu_stars(Game* game) {
     Star* curr = game->entities.stars;
     while (curr) {
         Star* next = curr->next;
-        free(curr);
+        mem_free(curr);
         curr = next;
     }
     game->entities.stars = NULL;
 }
 
-static void draw_menu_options(WINDOW* win, const int selection, const int num_options,
-                              const char** options, const int start_y, const int center_x) {
-    for (int i = 0; i < num_options; i++) {
+static void draw_menu_options(WINDOW* win, const int cols, const int selection) {
+    const int start_y = LOGO_START + CENTER_Y_OFFSET;
+    const int x = (cols / 2) - CENTER_X_OFFSET;
+    for (int i = 0; i <= MENU_EXIT; i++) {
         if (i == selection) {
             wattron(win, A_REVERSE | A_BOLD);
-            mvwprintw(win, start_y + (i * 2), center_x - CENTER_X_OFFSET, "-> %s", options[i]);
+            mvwprintw(win, start_y + (i * 2), x, "-> %s", menu_options[i]);
             wattroff(win, A_REVERSE | A_BOLD);
         } else {
-            mvwprintw(win, start_y + (i * 2), center_x - CENTER_X_OFFSET, "   %s", options[i]);
+            mvwprintw(win, start_y + (i * 2), x, "   %s", menu_options[i]);
         }
     }
 }
 
-static int handle_menu_input(WINDOW* win, int* const selection, const int num_options) {
-    const int c = wgetch(win);
-    if (c == ERR) {
-        return 0;
+/**
+ * draw_menu_static - Draws the layers of the menu that do not move
+ * @game: Main game struct
+ * @selection: highlighted option
+ *
+ * RETURNS
+ * A copy of the window with just these layers, which the stars are drawn
+ * around.
+ */
+static WINDOW* draw_menu_static(Game* game, const int selection) {
+    WINDOW* win = game->main_win.window;
+
+    werase(win);
+    draw_main(game);
+    draw_logo(game, game->main_win.cols / 2, LOGO_START);
+    draw_menu_options(win, game->main_win.cols, selection);
+    if (game->username) {
+        mvwprintw(win, game->main_win.rows - 2, 2, "Logged in as: %s", game->username);
+    }
+
+    WINDOW* background = dupwin(win);
+    if (!background) {
+        exit(1);
     }
+    return background;
+}
+
+/**
+ * handle_menu_input - Handles every key waiting in the menu
+ * @game: Main game struct
+ * @background: copy of the static layers, kept in step with the window
+ * @selection: highlighted option, updated
+ *
+ * RETURNS
+ * 1 once an option was chosen, 0 otherwise.
+ */
+static int handle_menu_input(Game* game, WINDOW* background, int* const selection) {
+    WINDOW* win = game->main_win.window;
+    int c = wgetch(win);
 
-    if (c == KEY_UP) {
-        (*selection)--;
-        if (*selection < 0) {
-            *selection = num_options - 1;
+    while (c != ERR) {
+        if (c == '\n') {
+            return 1;
         }
-    } else if (c == KEY_DOWN) {
-        (*selection)++;
-        if (*selection >= num_options) {
-            *selection = 0;
+        if (c == KEY_UP || c == KEY_DOWN) {
+            *selection = (*selection + (c == KEY_UP ? MENU_EXIT : 1)) % (MENU_EXIT + 1);
+            draw_menu_options(win, game->main_win.cols, *selection);
+            draw_menu_options(background, game->main_win.cols, *selection);
         }
-    } else if (c == '\n') {
-        return 1;
+        c = wgetch(win);
     }
     return 0;
 }
 
+/**
+ * show_start_menu - Runs the start menu until an option is chosen
+ * @game: Main game struct
+ *
+ * The static layers are drawn once; after that only keys, the star timer
+ * and terminal resizes wake the menu, and each wake-up refreshes just the
+ * cells it changed.
+ *
+ * RETURNS
+ * The chosen option.
+ */
 MenuOption show_start_menu(Game* game) {
     WINDOW* win = game->main_win.window;
     int selection = 0;
-    const char* options[] = {"START GAME", "REPLAY LAST FLIGHT", "HIGH SCORES", "CHANGE USERNAME",
-                             "EXIT"};
-    const int num_options = sizeof(options) / sizeof(options[0]);
+    int chosen = 0;
 
     game->entities.stars = NULL;
 
     nodelay(win, TRUE);
     keypad(win, TRUE);
 
-    while (1) {
-        draw_main(game);
-
-        draw_menu_stars(game, win);
-
-        const int center_x = game->main_win.cols / 2;
-        const int art_start_y = LOGO_START;
-        draw_logo(game, center_x, art_start_y);
-
-        const int menu_start_y = art_start_y + CENTER_Y_OFFSET;
-        draw_menu_options(win, selection, num_options, options, menu_start_y, center_x);
-
-        if (game->username) {
-            mvwprintw(win, game->main_win.rows - 2, 2, "Logged in as: %s", game->username);
-        }
-
+    WINDOW* background = draw_menu_static(game, selection);
+    events_timer(&game->events, MENU_TICK_SPEED);
+    while (!chosen) {
         wrefresh(win);
-
-        if (handle_menu_input(win, &selection, num_options)) {
-            break;
+        const int events = events_wait(&game->events, EVENT_INPUT | EVENT_TICK | EVENT_RESIZE);
+        if (events & EVENT_RESIZE) {
+            events_resize_terminal();
+            delwin(background);
+            background = draw_menu_static(game, selection);
+        }
+        if (events & EVENT_INPUT) {
+            chosen = handle_menu_input(game, background, &selection);
+        }
+        if (!chosen && (events & EVENT_TICK)) {
+            draw_menu_stars(game, win, background);
         }
-
-        usleep(MENU_TICK_SPEED);
     }
+    events_timer(&game->events, 0);
 
+    delwin(background);
     cleanup_menu_stars(game);
 
     nodelay(stdscr, TRUE);
@@ -207,7 +273,7 @@ void get_username(Game* game) {
         strcpy(buffer, "Player");
     }
 
-    char* new_ptr = (char*)realloc(game->username, strlen(buffer) + 1);
+    char* new_ptr = (char*)mem_realloc(MEM_UI, game->username, strlen(buffer) + 1);
     if (new_ptr) {
         game->username = new_ptr;
         strcpy(game->username, buffer);
@@ -227,7 +293,7 @@ char* select_level(Game* game) {
         if (files) {
             free((void*)files);
         }
-        return strdup("config.txt");
+        return mem_strdup(MEM_UI, "config.txt");
     }
 
     WINDOW* win = game->main_win.window;
@@ -266,8 +332,7 @@ char* select_level(Game* game) {
         }
     }
 
-    char* res = NULL;
-    asprintf(&res, "levels/%s", files[sel]);
+    char* res = mem_asprintf(MEM_UI, "levels/%s", files[sel]);
 
     for (int i = 0; i < count; i++) {
         free(files[i]);
@@ -282,6 +347,164 @@ char* select_level(Game* game) {
     return res;
 }
 
+static void draw_replay_filter(WINDOW* win, const ReplayFilter* filter, const int cx) {
+    mvwprintw(win, 2, cx, "REPLAYS  [u] user: %-12s [l] level: ",
+              filter->username ? filter->username : "all");
+    if (filter->level_nr > 0) {
+        wprintw(win, "%-3d", filter->level_nr);
+    } else {
+        wprintw(win, "any");
+    }
+    wprintw(win, "  [s] min score: %d", filter->min_score);
+}
+
+static void draw_replay_entry(WINDOW* win, const int y, const int cx,
+                              const ReplayIndexEntry* entry) {
+    char date[32] = {0};
+    const time_t timestamp = (time_t)entry->timestamp;
+    strftime(date, sizeof(date), "%m-%d %H:%M", localtime(&timestamp));
+
+    mvwprintw(win, y, cx, "%s  %-12.12s L%-2d %8d  %-4s %6u ticks", date, entry->username,
+              entry->level_nr, entry->score, entry->result == WINNER ? "WIN" : "LOSS",
+              entry->ticks);
+}
+
+static void draw_replay_list(Game* game, const ReplayIndexEntry* entries, const int count,
+                             const int sel, const ReplayFilter* filter) {
+    WINDOW* win = game->main_win.window;
+    const int cx = (game->main_win.cols - (2 * REPLAY_LIST_X_OFFSET)) / 2;
+    const int visible = game->main_win.rows - REPLAY_LIST_START_Y - 1;
+    const int first = sel >= visible ? sel - visible + 1 : 0;
+
+    wclear(win);
+    draw_main(game);
+    draw_replay_filter(win, filter, cx);
+
+    if (count == 0) {
+        mvwprintw(win, REPLAY_LIST_START_Y, cx, "No replays match.");
+    }
+    for (int i = first; i < count && i - first < visible; i++) {
+        if (i == sel) {
+            wattron(win, A_REVERSE);
+        }
+        draw_replay_entry(win, REPLAY_LIST_START_Y + i - first, cx, &entries[i]);
+        if (i == sel) {
+            wattroff(win, A_REVERSE);
+        }
+    }
+    wrefresh(win);
+}
+
+/**
+ * update_replay_filter - applies a filter hotkey
+ * @game: Main game struct
+ * @filter: filter being edited
+ * @c: key pressed
+ *
+ * 'u' toggles between all players and the current user, 'l' cycles through
+ * level numbers and 's' cycles the minimum score.
+ *
+ * RETURNS
+ * 1 if the filter changed, 0 otherwise.
+ */
+static int update_replay_filter(Game* game, ReplayFilter* filter, const int c) {
+    static const int score_steps[] = {0, 1, 1000, 5000, 10000};
+    const int steps = sizeof(score_steps) / sizeof(score_steps[0]);
+
+    if (c == 'u') {
+        filter->username = filter->username ? NULL : game->username;
+    } else if (c == 'l') {
+        filter->level_nr = (filter->level_nr + 1) % (REPLAY_FILTER_MAX_LEVEL + 1);
+    } else if (c == 's') {
+        int step = 0;
+        while (step < steps - 1 && score_steps[step] != filter->min_score) {
+            step++;
+        }
+        filter->min_score = score_steps[(step + 1) % steps];
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static char* replay_selection_path(const ReplayIndexEntry* entries, const int sel) {
+    char path[MAX_LINE_LENGTH];
+    replay_path_for_id(entries[sel].id, path, sizeof(path));
+    return mem_strdup(MEM_UI, path);
+}
+
+/**
+ * select_replay - lets the player browse the replay library
+ * @game: Main game struct
+ *
+ * RETURNS
+ * Path of the chosen replay (caller frees), or NULL if the player backed out.
+ */
+char* select_replay(Game* game) {
+    WINDOW* win = game->main_win.window;
+    ReplayFilter filter = {NULL, 0, 0};
+    ReplayIndexEntry* entries = NULL;
+    int count = replay_index_query(&filter, &entries);
+    int sel = 0;
+    char* res = NULL;
+
+    nodelay(win, FALSE);
+    keypad(win, TRUE);
+
+    while (res == NULL) {
+        draw_replay_list(game, entries, count, sel, &filter);
+
+        const int c = wgetch(win);
+        if (c == KEY_UP && count > 0) {
+            sel = (sel - 1 + count) % count;
+        } else if (c == KEY_DOWN && count > 0) {
+            sel = (sel + 1) % count;
+        } else if (c == '\n' && count > 0) {
+            res = replay_selection_path(entries, sel);
+        } else if (c == 'q') {
+            break;
+        } else if (update_replay_filter(game, &filter, c)) {
+            mem_free(entries);
+            count = replay_index_query(&filter, &entries);
+            sel = 0;
+        }
+    }
+
+    mem_free(entries);
+    nodelay(win, TRUE);
+    wclear(win);
+    wrefresh(win);
+    return res;
+}
+
+static void show_replay_error(Game* game) {
+    wclear(game->main_win.window);
+    draw_main(game);
+    mvwprintw(game->main_win.window, CENTER_X_OFFSET, CENTER_Y_OFFSET,
+              "Replay file is missing or damaged!");
+    wrefresh(game->main_win.window);
+    nodelay(game->main_win.window, FALSE);
+    wgetch(game->main_win.window);
+    nodelay(game->main_win.window, TRUE);
+}
+
+static void play_replay(Game* game) {
+    char* path = select_replay(game);
+    if (path == NULL) {
+        return;
+    }
+
+    if (replay_open(&game->replay, path) == 0) {
+        game->replay.replay_state = REPLAY_PLAYING;
+        start_game(game);
+        replay_close(&game->replay);
+        end_game(game);
+    } else {
+        show_replay_error(game);
+    }
+    mem_free(path);
+}
+
 void handle_menu_choice(Game* game, const MenuOption choice) {
     switch (choice) {
         case MENU_START_GAME:
@@ -289,21 +512,15 @@ void handle_menu_choice(Game* game, const MenuOption choice) {
             start_game(game);
             end_game(game);
             break;
+        case MENU_PRACTICE:
+            game->replay.replay_state = REPLAY_OFF;
+            game->practice = 1;
+            start_game(game);
+            game->practice = 0;
+            end_game(game);
+            break;
         case MENU_REPLAY:
-            if (game->replay.replay_keys != NULL) {
-                game->replay.replay_state = REPLAY_PLAYING;
-                start_game(game);
-                end_game(game);
-            } else {
-                wclear(game->main_win.window);
-                draw_main(game);
-                mvwprintw(game->main_win.window, CENTER_X_OFFSET, CENTER_Y_OFFSET,
-                          "No replays yet!");
-                wrefresh(game->main_win.window);
-                nodelay(game->main_win.window, FALSE);
-                wgetch(game->main_win.window);
-                nodelay(game->main_win.window, TRUE);
-            }
+            play_replay(game);
             break;
         case MENU_HIGH_SCORES:
             show_high_scores(game, 1);
@@ -7,6 +7,7 @@ void show_high_scores(Game* game, const int row_start);
 MenuOption show_start_menu(Game* game);
 void get_username(Game* game);
 char* select_level(Game* game);
+char* select_replay(Game* game);
 void handle_menu_choice(Game* game, const MenuOption choice);
 
 #endif  // MENU_H
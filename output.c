@@ -0,0 +1,234 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "output.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * Output meter: stdout is replaced by a pipe that a relay thread copies to
+ * the terminal, counting every byte on the way. ncurses notices stdout is not
+ * a tty and uses stderr for terminal modes and size, so nothing else changes.
+ * The pipe contents plus the tty output queue (TIOCOUTQ) tell how far the
+ * terminal is behind.
+ *
+ * A frame only counts as shown once the relay has written its last byte to
+ * the tty: the render thread notes where in the stream the frame ends, and
+ * the relay stamps it when it gets there.
+ */
+
+static int tty_fd = -1;
+static int pipe_fd = -1;
+static pthread_t relay_thread;
+static atomic_uint_fast64_t bytes_out;
+
+// Stream positions in bytes and the frame waiting to reach the tty.
+static pthread_mutex_t frame_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t relay_read;
+static uint64_t relay_written;
+static uint32_t pending_seq;
+static uint64_t pending_end;
+static uint32_t shown_seq;
+static uint64_t shown_us;
+
+static ssize_t relay_read_chunk(char* buf, const size_t size) {
+    struct pollfd pfd = {pipe_fd, POLLIN, 0};
+    if (poll(&pfd, 1, -1) < 0) {
+        return errno == EINTR ? -2 : -1;
+    }
+    // Taken under the lock, so a frame's end is never counted twice or missed.
+    pthread_mutex_lock(&frame_lock);
+    const ssize_t n = read(pipe_fd, buf, size);
+    if (n > 0) {
+        relay_read += (uint64_t)n;
+    }
+    pthread_mutex_unlock(&frame_lock);
+    return n;
+}
+
+static void relay_wrote(const ssize_t n) {
+    atomic_fetch_add(&bytes_out, (uint_fast64_t)n);
+    pthread_mutex_lock(&frame_lock);
+    relay_written += (uint64_t)n;
+    if (pending_seq && relay_written >= pending_end) {
+        shown_seq = pending_seq;
+        shown_us = monotonic_us();
+        pending_seq = 0;
+    }
+    pthread_mutex_unlock(&frame_lock);
+}
+
+static void* relay_output(void* arg) {
+    (void)arg;
+    char buf[OUTPUT_RELAY_CHUNK];
+    ssize_t n = 0;
+
+    while ((n = relay_read_chunk(buf, sizeof(buf))) != 0) {
+        if (n == -2) {
+            continue;
+        }
+        if (n < 0) {
+            return NULL;
+        }
+        ssize_t done = 0;
+        while (done < n) {
+            const ssize_t w = write(tty_fd, buf + done, (size_t)(n - done));
+            if (w <= 0) {
+                return NULL;
+            }
+            done += w;
+        }
+        relay_wrote(n);
+    }
+    return NULL;
+}
+
+/**
+ * output_meter_start - Routes stdout through the counting relay
+ *
+ * Must be called before ncurses is initialised. If stdout is not a terminal
+ * or the pipe cannot be set up, output goes straight to stdout and is not
+ * counted.
+ *
+ * RETURNS
+ * Void.
+ */
+void output_meter_start(void) {
+    int fds[2];
+    if (!isatty(STDOUT_FILENO) || !isatty(STDERR_FILENO) || pipe(fds) != 0) {
+        return;
+    }
+
+    tty_fd = dup(STDOUT_FILENO);
+    if (tty_fd < 0 || dup2(fds[1], STDOUT_FILENO) < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+    close(fds[1]);
+    pipe_fd = fds[0];
+
+    if (pthread_create(&relay_thread, NULL, relay_output, NULL) != 0) {
+        dup2(tty_fd, STDOUT_FILENO);
+        close(pipe_fd);
+        pipe_fd = -1;
+    }
+}
+
+/**
+ * output_meter_stop - Restores stdout once ncurses has been shut down
+ *
+ * RETURNS
+ * Void.
+ */
+void output_meter_stop(void) {
+    if (pipe_fd < 0) {
+        return;
+    }
+
+    fflush(stdout);
+    // Replacing the pipe's only write end lets the relay drain and exit.
+    dup2(tty_fd, STDOUT_FILENO);
+    pthread_join(relay_thread, NULL);
+    close(pipe_fd);
+    close(tty_fd);
+    pipe_fd = -1;
+    tty_fd = -1;
+}
+
+/**
+ * output_tty - The terminal the game draws to
+ *
+ * While the meter runs stdout is a pipe, so terminal ioctls such as
+ * TIOCGWINSZ have to go to this descriptor instead.
+ *
+ * RETURNS
+ * The terminal's file descriptor.
+ */
+int output_tty(void) {
+    return tty_fd >= 0 ? tty_fd : STDOUT_FILENO;
+}
+
+/**
+ * output_frame_flushed - Notes that doupdate() has written a frame
+ * @seq: the frame's sequence number
+ * @flushed_us: monotonic_us() when doupdate() returned
+ *
+ * Without the relay the frame went straight to the tty and is shown now.
+ * Otherwise it is shown once the relay has written everything in the pipe
+ * up to here. Only the newest such frame is tracked; an older one still on
+ * its way is settled by it, a little late.
+ *
+ * RETURNS
+ * Void.
+ */
+void output_frame_flushed(const uint32_t seq, const uint64_t flushed_us) {
+    int piped = 0;
+
+    pthread_mutex_lock(&frame_lock);
+    if (pipe_fd < 0) {
+        shown_seq = seq;
+        shown_us = flushed_us;
+    } else if (ioctl(pipe_fd, FIONREAD, &piped) == 0 && relay_read + piped > relay_written) {
+        pending_seq = seq;
+        pending_end = relay_read + (uint64_t)piped;
+    } else {
+        shown_seq = seq;
+        shown_us = monotonic_us();
+    }
+    pthread_mutex_unlock(&frame_lock);
+}
+
+/**
+ * output_frame_shown - The last frame that reached the terminal
+ * @seq: receives its sequence number, 0 if none did yet
+ * @us: receives monotonic_us() when it did
+ *
+ * RETURNS
+ * Void.
+ */
+void output_frame_shown(uint32_t* seq, uint64_t* us) {
+    pthread_mutex_lock(&frame_lock);
+    *seq = shown_seq;
+    *us = shown_us;
+    pthread_mutex_unlock(&frame_lock);
+}
+
+// Frame numbers restart with every render thread.
+void output_frames_reset(void) {
+    pthread_mutex_lock(&frame_lock);
+    pending_seq = 0;
+    shown_seq = 0;
+    shown_us = 0;
+    pthread_mutex_unlock(&frame_lock);
+}
+
+uint64_t output_bytes(void) {
+    return atomic_load(&bytes_out);
+}
+
+/**
+ * output_backlog - Bytes written but not yet sent by the terminal
+ *
+ * RETURNS
+ * Bytes waiting in the relay pipe plus the tty output queue.
+ */
+int output_backlog(void) {
+    int queued = 0;
+    int piped = 0;
+
+    if (ioctl(tty_fd >= 0 ? tty_fd : STDOUT_FILENO, TIOCOUTQ, &queued) != 0) {
+        queued = 0;
+    }
+    if (pipe_fd >= 0 && ioctl(pipe_fd, FIONREAD, &piped) != 0) {
+        piped = 0;
+    }
+    return queued + piped;
+}
@@ -0,0 +1,15 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "types.h"
+
+void output_meter_start(void);
+void output_meter_stop(void);
+int output_tty(void);
+void output_frame_flushed(uint32_t seq, uint64_t flushed_us);
+void output_frame_shown(uint32_t* seq, uint64_t* us);
+void output_frames_reset(void);
+uint64_t output_bytes(void);
+int output_backlog(void);
+
+#endif  // OUTPUT_H
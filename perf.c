@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem.h"
+#include "perf.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * Figures for the performance overlay. The simulation thread records each
+ * tick into a small ring and, while the overlay is shown, summarises the
+ * ring into the frame it publishes; the render thread adds its own draw
+ * time and output count. Recording costs two clock reads per tick, so the
+ * ring is kept warm whether or not the overlay is on.
+ */
+
+void perf_begin(PerfStats* perf) {
+    const char visible = perf->visible;
+    memset(perf, 0, sizeof(*perf));
+    perf->visible = visible;
+    perf->start_us = monotonic_us();
+    perf->last_us = perf->start_us;
+    perf->last_allocs = mem_total_allocs();
+}
+
+/**
+ * perf_record_tick - Records a simulated tick
+ * @game: Main game struct
+ * @start_ns: monotonic_ns() before the tick was simulated
+ * @paced_us: wall time the tick is scheduled to take, 0 when unpaced
+ *
+ * Unpaced ticks (replays at full speed) count their wall time as simulated
+ * time, so they do not show up as drift.
+ *
+ * RETURNS
+ * Void.
+ */
+void perf_record_tick(Game* game, const uint64_t start_ns, const unsigned int paced_us) {
+    PerfStats* perf = &game->perf;
+    const uint64_t now_us = monotonic_us();
+    const uint64_t writes = game->occupancy_map.writes;
+    const uint64_t allocs = mem_total_allocs();
+
+    perf->tick_ns[perf->next] = (uint32_t)(monotonic_ns() - start_ns);
+    perf->tick_cells[perf->next] = (uint32_t)(writes - perf->last_writes);
+    perf->tick_allocs[perf->next] = (uint32_t)(allocs - perf->last_allocs);
+    perf->next = (perf->next + 1) % PERF_WINDOW_TICKS;
+    if (perf->count < PERF_WINDOW_TICKS) {
+        perf->count++;
+    }
+    perf->last_writes = writes;
+    perf->last_allocs = allocs;
+    // A paced tick's budget is only credited once its sleep has passed.
+    perf->sim_us += perf->paced_us ? perf->paced_us : now_us - perf->last_us;
+    perf->paced_us = paced_us;
+    perf->last_us = now_us;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    const uint32_t x = *(const uint32_t*)a;
+    const uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void summarise_ticks(const PerfStats* perf, Frame* frame) {
+    uint32_t sorted[PERF_WINDOW_TICKS];
+    uint64_t total_ns = 0;
+    uint64_t total_cells = 0;
+    uint64_t total_allocs = 0;
+
+    for (int i = 0; i < perf->count; i++) {
+        sorted[i] = perf->tick_ns[i];
+        total_ns += perf->tick_ns[i];
+        total_cells += perf->tick_cells[i];
+        total_allocs += perf->tick_allocs[i];
+    }
+    qsort(sorted, (size_t)perf->count, sizeof(uint32_t), compare_u32);
+
+    const int p99 = ((perf->count * PERF_PERCENTILE) + 99) / 100 - 1;
+    frame->tick_avg_us = (float)total_ns / (float)perf->count / 1000.0F;
+    frame->tick_p99_us = (float)sorted[p99] / 1000.0F;
+    frame->cells_per_tick = (float)total_cells / (float)perf->count;
+    frame->allocs_per_tick = (float)total_allocs / (float)perf->count;
+}
+
+/**
+ * perf_capture - Fills the simulation's figures into a frame
+ * @game: Main game struct
+ * @frame: frame being captured
+ *
+ * RETURNS
+ * Void.
+ */
+void perf_capture(const Game* game, Frame* frame) {
+    const PerfStats* perf = &game->perf;
+
+    frame->perf_visible = perf->visible;
+    if (!perf->visible) {
+        return;
+    }
+    frame->tick_avg_us = 0;
+    frame->tick_p99_us = 0;
+    frame->cells_per_tick = 0;
+    frame->allocs_per_tick = 0;
+    if (perf->count > 0) {
+        summarise_ticks(perf, frame);
+    }
+    const int64_t wall_us = (int64_t)(perf->last_us - perf->start_us);
+    frame->drift_ms = (float)(wall_us - (int64_t)perf->sim_us) / 1000.0F;
+
+    MemStats mem;
+    mem_stats(MEM_TAGS, &mem);
+    frame->mem_live = mem.live;
+    frame->mem_peak = mem.peak;
+
+    frame->hunter_count = 0;
+    for (const Hunter* hu = game->entities.hunters; hu; hu = hu->next) {
+        frame->hunter_count++;
+    }
+    frame->star_count = 0;
+    for (const Star* st = game->entities.stars; st; st = st->next) {
+        frame->star_count++;
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include "types.h"
+
+void perf_begin(PerfStats* perf);
+void perf_record_tick(Game* game, uint64_t start_ns, unsigned int paced_us);
+void perf_capture(const Game* game, Frame* frame);
+
+#endif  // PERF_H
@@ -1,34 +1,154 @@
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "mem.h"
 #include "types.h"
 
-void update_occupancy_map(char** occupancy_map, int rows, int cols, entity_t* ent,
-                          char map_representation) {
-    const int x = ent->x;
-    const int y = ent->y;
-    const int width = ent->width;
-    const int height = ent->height;
+static int is_border(const OccupancyMap* map, const int x, const int y) {
+    return x <= 0 || y <= 0 || x >= map->cols - 1 || y >= map->rows - 1;
+}
 
-    for (int i = y; i < y + height; i++) {
-        for (int j = x; j < x + width; j++) {
-            if (i >= 0 && i < rows && j >= 0 && j < cols) {
-                if (occupancy_map[i][j] != WALL) {
-                    occupancy_map[i][j] = map_representation;
-                }
+static int chunk_index(const OccupancyMap* map, const int x, const int y) {
+    return ((y >> OCCUPANCY_CHUNK_SHIFT) * map->chunk_cols) + (x >> OCCUPANCY_CHUNK_SHIFT);
+}
+
+static int cell_index(const int x, const int y) {
+    return ((y & (OCCUPANCY_CHUNK_SIZE - 1)) << OCCUPANCY_CHUNK_SHIFT) +
+           (x & (OCCUPANCY_CHUNK_SIZE - 1));
+}
+
+/**
+ * occupancy_init - Sets up an empty map for an arena
+ * @map: the map
+ * @rows: arena height
+ * @cols: arena width
+ *
+ * Only the chunk directory is allocated; chunks come and go with the
+ * entities in them.
+ *
+ * RETURNS
+ * Void.
+ */
+void occupancy_init(OccupancyMap* map, const int rows, const int cols) {
+    map->rows = rows;
+    map->cols = cols;
+    map->writes = 0;
+    map->chunk_rows = (rows + OCCUPANCY_CHUNK_SIZE - 1) >> OCCUPANCY_CHUNK_SHIFT;
+    map->chunk_cols = (cols + OCCUPANCY_CHUNK_SIZE - 1) >> OCCUPANCY_CHUNK_SHIFT;
+    map->chunks = (OccupancyChunk**)mem_calloc(
+            MEM_ENTITIES, (size_t)map->chunk_rows * (size_t)map->chunk_cols,
+            sizeof(OccupancyChunk*));
+    if (map->chunks == NULL) {
+        exit(1);
+    }
+}
+
+void occupancy_clear(OccupancyMap* map) {
+    const int count = map->chunk_rows * map->chunk_cols;
+    for (int i = 0; map->chunks && i < count; i++) {
+        mem_free(map->chunks[i]);
+        map->chunks[i] = NULL;
+    }
+}
+
+void occupancy_free(OccupancyMap* map) {
+    occupancy_clear(map);
+    mem_free((void*)map->chunks);
+    memset(map, 0, sizeof(*map));
+}
+
+/**
+ * occupancy_copy_chunk - Makes one chunk of @dst match @src
+ * @dst: map to update (same size as @src)
+ * @src: map to copy from
+ * @index: chunk index
+ *
+ * RETURNS
+ * Void.
+ */
+void occupancy_copy_chunk(OccupancyMap* dst, const OccupancyMap* src, const int index) {
+    if (src->chunks[index] == NULL) {
+        mem_free(dst->chunks[index]);
+        dst->chunks[index] = NULL;
+        return;
+    }
+    if (dst->chunks[index] == NULL) {
+        dst->chunks[index] = (OccupancyChunk*)mem_alloc(MEM_ENTITIES, sizeof(OccupancyChunk));
+        if (dst->chunks[index] == NULL) {
+            exit(1);
+        }
+    }
+    memcpy(dst->chunks[index], src->chunks[index], sizeof(OccupancyChunk));
+}
+
+char occupancy_get(const OccupancyMap* map, const int x, const int y) {
+    if (is_border(map, x, y)) {
+        return WALL;
+    }
+    const OccupancyChunk* chunk = map->chunks[chunk_index(map, x, y)];
+    return chunk ? chunk->cells[cell_index(x, y)] : EMPTY;
+}
+
+/**
+ * occupancy_set - Changes one cell of the map
+ * @map: the map
+ * @x: column
+ * @y: row
+ * @value: new cell value
+ *
+ * The border is always WALL and is left alone. A chunk is allocated by the
+ * first cell that stops being EMPTY and freed with the last one.
+ *
+ * RETURNS
+ * Void.
+ */
+void occupancy_set(OccupancyMap* map, const int x, const int y, const char value) {
+    if (is_border(map, x, y)) {
+        return;
+    }
+    map->writes++;
+    OccupancyChunk** slot = &map->chunks[chunk_index(map, x, y)];
+    if (*slot == NULL) {
+        if (value == EMPTY) {
+            return;
+        }
+        *slot = (OccupancyChunk*)mem_alloc(MEM_ENTITIES, sizeof(OccupancyChunk));
+        if (*slot == NULL) {
+            exit(1);
+        }
+        memset((*slot)->cells, EMPTY, sizeof((*slot)->cells));
+        (*slot)->used = 0;
+    }
+
+    char* cell = &(*slot)->cells[cell_index(x, y)];
+    (*slot)->used += (value != EMPTY) - (*cell != EMPTY);
+    *cell = value;
+    if ((*slot)->used == 0) {
+        mem_free(*slot);
+        *slot = NULL;
+    }
+}
+
+void update_occupancy_map(OccupancyMap* map, entity_t* ent, char map_representation) {
+    for (int i = ent->y; i < ent->y + ent->height; i++) {
+        for (int j = ent->x; j < ent->x + ent->width; j++) {
+            if (i >= 0 && i < map->rows && j >= 0 && j < map->cols) {
+                occupancy_set(map, j, i, map_representation);
             }
         }
     }
 }
 
-collision_t check_occupancy_map(char** occupancy_map, int rows, int cols, int x, int y, int width,
-                                int height) {
-    if (x <= 0 || y <= 0 || x + width >= cols || y + height >= rows) {
+collision_t check_occupancy_map(const OccupancyMap* map, int x, int y, int width, int height) {
+    if (x <= 0 || y <= 0 || x + width >= map->cols || y + height >= map->rows) {
         return WALL;
     }
     for (int i = y; i < y + height; i++) {
         for (int j = x; j < x + width; j++) {
-            if (occupancy_map[i][j] != EMPTY) {
-                return (collision_t)occupancy_map[i][j];
+            const char cell = occupancy_get(map, j, i);
+            if (cell != EMPTY) {
+                return (collision_t)cell;
             }
         }
     }
@@ -83,8 +203,7 @@ collision_t attempt_move_entity(Game* game, entity_t* ent) {
     const int check_y = ent->y + ent->dy;
 
     const collision_t ret =
-            check_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols,
-                                check_x, check_y, ent->width, ent->height);
+            check_occupancy_map(&game->occupancy_map, check_x, check_y, ent->width, ent->height);
     if (ret == EMPTY) {
         move_entity(ent, ent->dx, ent->dy);
         return EMPTY;
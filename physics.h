@@ -3,10 +3,14 @@
 
 #include "types.h"
 
-void update_occupancy_map(char** occupancy_map, int rows, int cols, entity_t* ent,
-                          char map_representation);
-collision_t check_occupancy_map(char** occupancy_map, int rows, int cols, int x, int y, int width,
-                                int height);
+void occupancy_init(OccupancyMap* map, int rows, int cols);
+void occupancy_clear(OccupancyMap* map);
+void occupancy_free(OccupancyMap* map);
+void occupancy_copy_chunk(OccupancyMap* dst, const OccupancyMap* src, int index);
+char occupancy_get(const OccupancyMap* map, int x, int y);
+void occupancy_set(OccupancyMap* map, int x, int y, char value);
+void update_occupancy_map(OccupancyMap* map, entity_t* ent, char map_representation);
+collision_t check_occupancy_map(const OccupancyMap* map, int x, int y, int width, int height);
 
 void change_entity_direction(entity_t* entity, direction_t direction, int speed);
 direction_t get_opposite_direction(direction_t direction);
@@ -0,0 +1,125 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "types.h"
+
+int pool_default_threads(void) {
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+}
+
+static void run_tasks(Pool* pool) {
+    int index = atomic_fetch_add(&pool->next, 1);
+    while (index < pool->count) {
+        pool->task(pool->ctx, index);
+        index = atomic_fetch_add(&pool->next, 1);
+    }
+}
+
+static void* pool_worker(void* arg) {
+    Pool* pool = (Pool*)arg;
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (1) {
+        while (pool->generation == seen && !pool->quit) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->quit) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_tasks(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * pool_start - Starts the worker threads
+ * @pool: pool to start
+ * @threads: threads to run batches on, counting the caller of pool_run();
+ *           0 or less means one per online core
+ *
+ * RETURNS
+ * Void.
+ */
+void pool_start(Pool* pool, int threads) {
+    memset(pool, 0, sizeof(*pool));
+    if (threads <= 0) {
+        threads = pool_default_threads();
+    }
+    pool->thread_count = threads - 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    if (pool->thread_count > 0) {
+        pool->threads = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)pool->thread_count);
+        if (!pool->threads) {
+            exit(1);
+        }
+    }
+    for (int i = 0; i < pool->thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+            exit(1);
+        }
+    }
+}
+
+/**
+ * pool_run - Runs @task for every index in [0, @count) and waits for all of them
+ * @pool: a started pool
+ * @task: called once per index, from any of the pool's threads
+ * @ctx: passed to @task
+ * @count: number of indices
+ *
+ * RETURNS
+ * Void.
+ */
+void pool_run(Pool* pool, const PoolTask task, void* ctx, const int count) {
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->ctx = ctx;
+    pool->count = count;
+    atomic_store(&pool->next, 0);
+    pool->busy = pool->thread_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_tasks(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_stop(Pool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    memset(pool, 0, sizeof(*pool));
+}
@@ -0,0 +1,11 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "types.h"
+
+int pool_default_threads(void);
+void pool_start(Pool* pool, int threads);
+void pool_run(Pool* pool, PoolTask task, void* ctx, int count);
+void pool_stop(Pool* pool);
+
+#endif  // POOL_H
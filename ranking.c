@@ -3,40 +3,63 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "mem.h"
+#include "ranking.h"
 #include "types.h"
+#include "verify.h"
+
+/*
+ * ranking.txt holds one "score username replay_id" line per entry, best
+ * first. Scores are only added after their replay has been re-simulated and
+ * found to produce them; lines written before replays were attached have no
+ * id and load with replay_id 0.
+ */
 
 typedef struct {
     int score;
     char username[MAX_USERNAME_LENGTH];
+    uint32_t replay_id;
 } SortEntry;
 
+static int read_entry(FILE* file, SortEntry* entry) {
+    char line[MAX_LINE_LENGTH];
+    unsigned int replay_id = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%d %49s %u", &entry->score, entry->username, &replay_id) >= 2) {
+            entry->replay_id = replay_id;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 static int compare_scores(const void* a, const void* b) {
     const SortEntry* entryA = (SortEntry*)a;
     const SortEntry* entryB = (SortEntry*)b;
     return (entryB->score - entryA->score);
 }
 
-const RankingNode* load_rankings() {
-    FILE* file = fopen("ranking.txt", "r");
+RankingNode* load_rankings() {
+    FILE* file = fopen(RANKING_PATH, "r");
     if (!file) {
         return NULL;
     }
 
-    const RankingNode* head = NULL;
+    RankingNode* head = NULL;
     RankingNode* tail = NULL;
+    SortEntry entry = {0};
 
-    int score = 0;
-    char name[MAX_USERNAME_LENGTH] = {0};
-
-    while (fscanf(file, "%d %49s", &score, name) == 2) {
-        RankingNode* new_node = (RankingNode*)malloc(sizeof(RankingNode));
+    while (read_entry(file, &entry)) {
+        RankingNode* new_node = (RankingNode*)mem_alloc(MEM_RANKING, sizeof(RankingNode));
         if (!new_node) {
             break;
         }
 
-        new_node->score = score;
-        strncpy(new_node->username, name, MAX_USERNAME_LENGTH - 1);
+        new_node->score = entry.score;
+        memcpy(new_node->username, entry.username, MAX_USERNAME_LENGTH);
         new_node->username[MAX_USERNAME_LENGTH - 1] = '\0';
+        new_node->replay_id = entry.replay_id;
         new_node->next = NULL;
 
         if (head == NULL) {
@@ -56,50 +79,91 @@ void free_rankings(RankingNode* head) {
     RankingNode* current = head;
     while (current != NULL) {
         RankingNode* next = current->next;
-        free(current);
+        mem_free(current);
         current = next;
     }
 }
 
-void save_ranking(Game* game) {
+/**
+ * ranking_replay_ids - Lists the replays the rankings rely on
+ * @ids: receives a heap array of replay ids (NULL when there are none)
+ *
+ * RETURNS
+ * Number of ids.
+ */
+int ranking_replay_ids(uint32_t** ids) {
+    RankingNode* head = load_rankings();
+    int count = 0;
+    *ids = NULL;
+
+    for (const RankingNode* node = head; node; node = node->next) {
+        if (node->replay_id == 0) {
+            continue;
+        }
+        uint32_t* tmp =
+                (uint32_t*)mem_realloc(MEM_RANKING, *ids, sizeof(uint32_t) * (size_t)(count + 1));
+        if (!tmp) {
+            exit(1);
+        }
+        *ids = tmp;
+        (*ids)[count++] = node->replay_id;
+    }
+    free_rankings(head);
+    return count;
+}
+
+static void add_ranking(const SortEntry* added) {
     SortEntry* entries = NULL;
     int count = 0;
 
-    FILE* read_file = fopen("ranking.txt", "r");
+    FILE* read_file = fopen(RANKING_PATH, "r");
+    SortEntry entry = {0};
+    while (read_file && read_entry(read_file, &entry)) {
+        entries = (SortEntry*)mem_realloc(MEM_RANKING, entries, sizeof(SortEntry) * (count + 1));
+        entries[count++] = entry;
+    }
     if (read_file) {
-        int temp_score = 0;
-        char temp_name[MAX_USERNAME_LENGTH] = {0};
-        while (fscanf(read_file, "%d %49s", &temp_score, temp_name) == 2) {
-            entries = (SortEntry*)realloc(entries, sizeof(SortEntry) * (count + 1));
-            entries[count].score = temp_score;
-            strcpy(entries[count].username, temp_name);
-            count++;
-        }
         fclose(read_file);
     }
 
-    entries = (SortEntry*)realloc(entries, sizeof(SortEntry) * (count + 1));
-    entries[count].score = game->score;
-    strncpy(entries[count].username, game->username, MAX_USERNAME_LENGTH - 1);
-    entries[count].username[MAX_USERNAME_LENGTH - 1] = '\0';
-    count++;
-
+    entries = (SortEntry*)mem_realloc(MEM_RANKING, entries, sizeof(SortEntry) * (count + 1));
+    entries[count++] = *added;
     qsort(entries, count, sizeof(SortEntry), compare_scores);
 
-    FILE* write_file = fopen("ranking.txt", "w");
-    if (!write_file) {
-        if (entries) {
-            free(entries);
-        }
-        return;
+    FILE* write_file = fopen(RANKING_PATH, "w");
+    for (int i = 0; write_file && i < count; i++) {
+        fprintf(write_file, "%d %s %u\n", entries[i].score, entries[i].username,
+                (unsigned int)entries[i].replay_id);
     }
-
-    for (int i = 0; i < count; i++) {
-        fprintf(write_file, "%d %s\n", entries[i].score, entries[i].username);
+    if (write_file) {
+        fclose(write_file);
     }
+    mem_free(entries);
+}
 
-    fclose(write_file);
-    if (entries) {
-        free(entries);
+/**
+ * submit_ranking - Adds a score to the rankings if its replay backs it up
+ * @username: player claiming the score
+ * @score: claimed score
+ * @replay_id: library replay of the game
+ *
+ * The replay is re-simulated headless; the score is only ranked if the
+ * replay belongs to @username, plays back without desyncing and ends with
+ * exactly @score.
+ *
+ * RETURNS
+ * VERIFY_OK if the score was ranked, otherwise why it was rejected.
+ */
+VerifyStatus submit_ranking(const char* username, const int score, const uint32_t replay_id) {
+    RankingNode claimed = {score, {0}, replay_id, NULL};
+    strncpy(claimed.username, username, MAX_USERNAME_LENGTH - 1);
+
+    RankingCheck check = {&claimed, VERIFY_OK, 0, 0};
+    verify_ranking(&check);
+    if (check.status == VERIFY_OK) {
+        SortEntry entry = {score, {0}, replay_id};
+        memcpy(entry.username, claimed.username, MAX_USERNAME_LENGTH);
+        add_ranking(&entry);
     }
+    return check.status;
 }
@@ -4,7 +4,8 @@
 #include "types.h"
 
 RankingNode* load_rankings();
-void save_ranking(Game* game);
+VerifyStatus submit_ranking(const char* username, int score, uint32_t replay_id);
+int ranking_replay_ids(uint32_t** ids);
 void free_rankings(RankingNode* head);
 
 #endif  // RANKING_H
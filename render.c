@@ -0,0 +1,325 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "drawlist.h"
+#include "events.h"
+#include "graphics.h"
+#include "mem.h"
+#include "output.h"
+#include "perf.h"
+#include "render.h"
+#include "swallow.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * The render thread owns every ncurses call while a game runs. The
+ * simulation captures a frame (sprite positions, grids, colours and status
+ * values) into its back buffer and swaps it with the ready buffer; the render
+ * thread swaps the ready buffer into its front buffer and draws it. Neither
+ * side ever waits for the other to finish a frame, so a terminal that blocks
+ * in doupdate() only delays what is shown, not the simulation or its input.
+ *
+ * In low-bandwidth mode colour shades are merged per family, and frames are
+ * dropped while the terminal has a backlog or earlier frames went over the
+ * byte budget. Since ncurses diffs against what is on screen, the next drawn
+ * frame carries every change the dropped ones had.
+ */
+
+/**
+ * add_sprite - Adds an entity to the frame if it is in view
+ * @frame: frame being captured
+ * @game: Main game struct
+ * @ent: the entity
+ * @layer: draw layer
+ *
+ * Positions are moved from arena to viewport coordinates; entities entirely
+ * outside the viewport are left out.
+ *
+ * RETURNS
+ * Void.
+ */
+static void add_sprite(Frame* frame, const Game* game, const entity_t* ent, const int layer) {
+    FrameSprite sprite = frame_sprite(ent);
+    sprite.x -= game->camera_x;
+    sprite.y -= game->camera_y;
+    sprite.layer = layer;
+    if (!sprite_visible(&sprite, &game->main_win)) {
+        return;
+    }
+
+    if (frame->sprite_count == frame->sprite_capacity) {
+        const int capacity =
+                frame->sprite_capacity ? frame->sprite_capacity * 2 : RENDER_INITIAL_SPRITES;
+        FrameSprite* sprites =
+                mem_realloc(MEM_RENDER, frame->sprites, sizeof(FrameSprite) * (size_t)capacity);
+        if (!sprites) {
+            exit(1);
+        }
+        frame->sprites = sprites;
+        frame->sprite_capacity = capacity;
+    }
+    frame->sprites[frame->sprite_count++] = sprite;
+}
+
+static void capture_status(const Game* game, Frame* frame) {
+    frame->username = game->username;
+    frame->level_nr = game->config.level_nr;
+    frame->hp = game->entities.swallow->hp;
+    frame->stars_collected = game->stars_collected;
+    frame->star_quota = game->config.star_quota;
+    frame->game_speed = game->game_speed;
+    frame->score = game->score;
+    frame->time_left = game->time_left;
+    frame->albatross_cooldown = game->albatross_cooldown;
+    frame->practice = game->practice;
+    frame->rewind_seconds =
+            (float)game->rewind.count * (float)TICK_BASE_US / 1000000.0F / game->game_speed;
+    frame->playing = game->replay.replay_state == REPLAY_PLAYING;
+    frame->playback_multiplier = game->playback_multiplier;
+    frame->desynced = game->replay.desynced;
+    frame->desync_tick = game->replay.desync_tick;
+    perf_capture(game, frame);
+}
+
+static ColorPair merge_shade(const ColorPair color) {
+    if (color < C_RED_1 || color > C_CYAN_5) {
+        return color;
+    }
+    const int family = (color - C_RED_1) / LOW_BANDWIDTH_SHADES;
+    return (ColorPair)(C_RED_1 + (family * LOW_BANDWIDTH_SHADES) + LOW_BANDWIDTH_SHADES - 1);
+}
+
+/**
+ * render_capture - Captures the game state a frame shows
+ * @game: Main game struct
+ * @frame: frame to fill; its sprite array is reused between captures
+ *
+ * RETURNS
+ * Void.
+ */
+void render_capture(const Game* game, Frame* frame) {
+    frame->sprite_count = 0;
+    for (const Star* st = game->entities.stars; st; st = st->next) {
+        add_sprite(frame, game, &st->ent, 0);
+    }
+    for (const Hunter* hu = game->entities.hunters; hu; hu = hu->next) {
+        add_sprite(frame, game, &hu->ent, 0);
+    }
+    if (game->taxi.active) {
+        entity_t taxi;
+        albatross_taxi_entity(game, &taxi);
+        add_sprite(frame, game, &taxi, 1);
+    } else {
+        add_sprite(frame, game, &game->entities.swallow->ent, 1);
+    }
+    capture_status(game, frame);
+
+    if (game->low_bandwidth) {
+        for (int i = 0; i < frame->sprite_count; i++) {
+            frame->sprites[i].color = merge_shade(frame->sprites[i].color);
+        }
+    }
+}
+
+static int should_drop(Renderer* r) {
+    if (r->byte_debt <= 0 && output_backlog() <= LOW_BANDWIDTH_BACKLOG_LIMIT) {
+        return 0;
+    }
+    r->byte_debt -= LOW_BANDWIDTH_FRAME_BUDGET;
+    if (r->byte_debt < 0) {
+        r->byte_debt = 0;
+    }
+    r->dropped_frames++;
+    return 1;
+}
+
+/**
+ * account_frame - Measures the output of the previously drawn frame
+ * @r: renderer state
+ *
+ * Bytes are counted as the relay forwards them, so the output of a frame is
+ * everything counted between two drawn frames.
+ *
+ * RETURNS
+ * Void.
+ */
+static void account_frame(Renderer* r) {
+    const uint64_t total = output_bytes();
+    const int64_t bytes = (int64_t)(total - r->last_bytes);
+    r->last_bytes = total;
+    r->bytes_per_frame += (int)((bytes - r->bytes_per_frame) / BANDWIDTH_AVERAGE_WEIGHT);
+    if (r->low_bandwidth && bytes > LOW_BANDWIDTH_FRAME_BUDGET) {
+        r->byte_debt += bytes - LOW_BANDWIDTH_FRAME_BUDGET;
+    }
+}
+
+/**
+ * timed_draw - Draws a frame, timing composition and output separately
+ * @r: renderer state
+ * @frame: the frame to draw
+ *
+ * Composing is ncurses work on this side; doupdate() mostly waits for the
+ * terminal to take the output, so a slow link shows up as flush time.
+ *
+ * RETURNS
+ * monotonic_us() when the terminal took the frame.
+ */
+static uint64_t timed_draw(Renderer* r, const Frame* frame) {
+    const uint64_t start = monotonic_us();
+    compose_frame(r->main_win, r->status_win, frame, &r->draw_list);
+    const uint64_t composed = monotonic_us();
+    doupdate();
+    const uint64_t flushed = monotonic_us();
+
+    r->render_us += ((float)(composed - start) - r->render_us) / BANDWIDTH_AVERAGE_WEIGHT;
+    r->flush_us += ((float)(flushed - composed) - r->flush_us) / BANDWIDTH_AVERAGE_WEIGHT;
+    return flushed;
+}
+
+static void* render_main(void* arg) {
+    Renderer* r = (Renderer*)arg;
+
+    while (1) {
+        pthread_mutex_lock(&r->lock);
+        while (!r->fresh && !r->quit) {
+            pthread_cond_wait(&r->wake, &r->lock);
+        }
+        if (!r->fresh) {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+        const int front = r->ready;
+        r->ready = r->front;
+        r->front = front;
+        r->fresh = 0;
+        const int last = r->quit;
+        const int repaint = r->repaint;
+        r->repaint = 0;
+        pthread_mutex_unlock(&r->lock);
+
+        if (repaint) {
+            events_resize_terminal();
+        }
+
+        if (r->low_bandwidth && !last && should_drop(r)) {
+            continue;
+        }
+        account_frame(r);
+        Frame* frame = &r->frames[r->front];
+        frame->bytes_per_frame = r->bytes_per_frame;
+        frame->low_bandwidth = r->low_bandwidth;
+        frame->dropped_frames = r->dropped_frames;
+        frame->render_us = r->render_us;
+        frame->flush_us = r->flush_us;
+        frame->output_total = r->last_bytes - r->start_bytes;
+        output_frame_flushed(frame->seq, timed_draw(r, frame));
+    }
+    return NULL;
+}
+
+/**
+ * render_start - Hands the game windows over to a render thread
+ * @game: Main game struct (windows must be set up)
+ *
+ * Until render_stop() the calling thread must not use ncurses.
+ *
+ * RETURNS
+ * Void.
+ */
+void render_start(Game* game) {
+    Renderer* r = &game->renderer;
+    r->back = 0;
+    r->ready = 1;
+    r->front = 2;
+    r->fresh = 0;
+    r->quit = 0;
+    r->main_win = &game->main_win;
+    r->status_win = &game->status_win;
+    r->low_bandwidth = game->low_bandwidth;
+    r->byte_debt = 0;
+    r->last_bytes = output_bytes();
+    r->start_bytes = r->last_bytes;
+    r->bytes_per_frame = 0;
+    r->dropped_frames = 0;
+    r->render_us = 0;
+    r->flush_us = 0;
+    r->published = 0;
+    output_frames_reset();
+    r->repaint = 0;
+    // The simulation reads stdin itself; doupdate() must not stop for input.
+    typeahead(-1);
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->wake, NULL);
+    if (pthread_create(&r->thread, NULL, render_main, r) != 0) {
+        exit(1);
+    }
+}
+
+/**
+ * render_publish - Publishes the current game state as the next frame
+ * @game: Main game struct
+ *
+ * Frames the render thread has not picked up yet are replaced, never queued.
+ *
+ * RETURNS
+ * Void.
+ */
+void render_publish(Game* game) {
+    Renderer* r = &game->renderer;
+    render_capture(game, &r->frames[r->back]);
+    r->frames[r->back].seq = ++r->published;
+
+    pthread_mutex_lock(&r->lock);
+    const int ready = r->back;
+    r->back = r->ready;
+    r->ready = ready;
+    r->fresh = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+}
+
+/**
+ * render_repaint - Has the next frame repaint the whole terminal
+ * @game: Main game struct
+ *
+ * Called by the simulation when the terminal was resized, since only the
+ * render thread may touch ncurses.
+ *
+ * RETURNS
+ * Void.
+ */
+void render_repaint(Game* game) {
+    Renderer* r = &game->renderer;
+
+    pthread_mutex_lock(&r->lock);
+    r->repaint = 1;
+    pthread_mutex_unlock(&r->lock);
+}
+
+/**
+ * render_stop - Draws the last published frame and joins the render thread
+ * @game: Main game struct
+ *
+ * RETURNS
+ * Void.
+ */
+void render_stop(Game* game) {
+    Renderer* r = &game->renderer;
+
+    pthread_mutex_lock(&r->lock);
+    r->quit = 1;
+    pthread_cond_signal(&r->wake);
+    pthread_mutex_unlock(&r->lock);
+    pthread_join(r->thread, NULL);
+
+    pthread_cond_destroy(&r->wake);
+    pthread_mutex_destroy(&r->lock);
+    for (int i = 0; i < RENDER_BUFFERS; i++) {
+        mem_free(r->frames[i].sprites);
+        memset(&r->frames[i], 0, sizeof(r->frames[i]));
+    }
+    draw_list_free(&r->draw_list);
+}
@@ -0,0 +1,12 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "types.h"
+
+void render_capture(const Game* game, Frame* frame);
+void render_start(Game* game);
+void render_publish(Game* game);
+void render_repaint(Game* game);
+void render_stop(Game* game);
+
+#endif  // RENDER_H
@@ -0,0 +1,514 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "mem.h"
+#include "replay.h"
+#include "replay_index.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * Replays are stored as a stream of (tick delta, type) records. The delta is
+ * the number of ticks since the previous record, written as an unsigned LEB128
+ * varint. Types below 0x80 are key presses and carry no payload; ticks without
+ * input produce no bytes, so a flight costs about two bytes per keypress
+ * instead of one byte per tick. REPLAY_TAG_CHECKSUM records carry the 64-bit
+ * state hash, little endian, taken at the end of their tick.
+ * REPLAY_TAG_KEYFRAME records carry a varint length and a full snapshot of
+ * the state at the end of their tick, so playback can seek without
+ * simulating from tick 0.
+ *
+ * While recording, events are buffered in memory and streamed to the replay
+ * file every REPLAY_FLUSH_TICKS ticks or REPLAY_FLUSH_BYTES bytes, so memory
+ * use stays flat no matter how long the game runs.
+ */
+
+static int write_all(const int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        const ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            return -1;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+static void flush_events(replay_t* replay) {
+    if (replay->fd >= 0 && replay->events.len > 0) {
+        if (write_all(replay->fd, replay->events.data, replay->events.len) == 0) {
+            replay->bytes_written += replay->events.len;
+        }
+    }
+    replay->events.len = 0;
+    replay->last_flush_tick = replay->tick;
+}
+
+static void put_record_header(replay_t* replay, const unsigned int type) {
+    buffer_put_varint(&replay->events, replay->tick - replay->last_event_tick);
+    buffer_put_u8(&replay->events, type);
+    replay->last_event_tick = replay->tick;
+}
+
+/**
+ * peek_record - decodes the record header at the playback cursor
+ * @replay: replay being played back
+ * @tick: receives the tick the record belongs to
+ * @after: receives a reader positioned at the record payload
+ *
+ * RETURNS
+ * The record type byte, or -1 at the end of the stream.
+ */
+static int peek_record(const replay_t* replay, unsigned int* tick, ByteReader* after) {
+    *after = replay->stream;
+    const uint64_t delta = reader_get_varint(after);
+    const unsigned int type = reader_get_u8(after);
+
+    if (after->error) {
+        return -1;
+    }
+    *tick = replay->last_event_tick + (unsigned int)delta;
+    return (int)type;
+}
+
+static void skip_payload(ByteReader* reader, const int type) {
+    if (type == REPLAY_TAG_CHECKSUM) {
+        reader_get_bytes(reader, sizeof(uint64_t));
+    } else if (type == REPLAY_TAG_KEYFRAME) {
+        reader_get_bytes(reader, (size_t)reader_get_varint(reader));
+    }
+}
+
+/**
+ * skip_stale_records - drops non-key records that belong to the current tick
+ * @replay: replay being played back
+ *
+ * Keyframes (and checksums that were not verified) would otherwise block the
+ * cursor from reaching the keys of the following ticks.
+ *
+ * RETURNS
+ * Void.
+ */
+static void skip_stale_records(replay_t* replay) {
+    unsigned int tick = 0;
+    ByteReader after;
+    int type = peek_record(replay, &tick, &after);
+
+    while (type >= REPLAY_TAG_CHECKSUM && tick <= replay->tick) {
+        skip_payload(&after, type);
+        if (after.error) {
+            return;
+        }
+        replay->stream = after;
+        replay->last_event_tick = tick;
+        type = peek_record(replay, &tick, &after);
+    }
+}
+
+static void append_keyframe(replay_t* replay, const ReplayKeyframe* keyframe) {
+    ReplayKeyframe* new_ptr = (ReplayKeyframe*)mem_realloc(
+            MEM_REPLAY, replay->keyframes, sizeof(ReplayKeyframe) * (replay->keyframe_count + 1));
+    if (new_ptr == NULL) {
+        exit(1);
+    }
+    replay->keyframes = new_ptr;
+    replay->keyframes[replay->keyframe_count++] = *keyframe;
+}
+
+/**
+ * index_keyframes - records where every keyframe of a mapped replay lives
+ * @replay: freshly opened replay
+ *
+ * One linear pass over the event stream; keyframe payloads are skipped, not
+ * decoded.
+ *
+ * RETURNS
+ * Void.
+ */
+static void index_keyframes(replay_t* replay) {
+    ByteReader reader = replay->stream;
+    unsigned int tick = 0;
+
+    while (reader.pos < reader.len) {
+        tick += (unsigned int)reader_get_varint(&reader);
+        const int type = (int)reader_get_u8(&reader);
+        if (type != REPLAY_TAG_KEYFRAME) {
+            skip_payload(&reader, type);
+        } else {
+            ReplayKeyframe keyframe = {tick, 0, 0, 0};
+            keyframe.payload_len = (size_t)reader_get_varint(&reader);
+            keyframe.payload_pos = reader.pos;
+            reader_get_bytes(&reader, keyframe.payload_len);
+            keyframe.next_pos = reader.pos;
+            if (!reader.error) {
+                append_keyframe(replay, &keyframe);
+            }
+        }
+        if (reader.error) {
+            break;
+        }
+    }
+}
+
+/**
+ * replay_next_key - fetches the next key recorded for the current tick
+ * @replay: replay being played back
+ *
+ * May be called repeatedly within a tick; every key recorded for the tick is
+ * returned once, in recording order.
+ *
+ * RETURNS
+ * The recorded key, or ERR once the tick has no more key events.
+ */
+int replay_next_key(replay_t* replay) {
+    unsigned int tick = 0;
+    ByteReader after;
+    const int type = peek_record(replay, &tick, &after);
+
+    if (type < 0 || type >= REPLAY_TAG_CHECKSUM || tick != replay->tick) {
+        return ERR;
+    }
+
+    replay->stream = after;
+    replay->last_event_tick = tick;
+    return type;
+}
+
+static void record_checksum(replay_t* replay, const uint64_t hash) {
+    put_record_header(replay, REPLAY_TAG_CHECKSUM);
+    buffer_put_u64(&replay->events, hash);
+}
+
+static void verify_checksum(replay_t* replay, const uint64_t hash) {
+    unsigned int tick = 0;
+    ByteReader after;
+    const int type = peek_record(replay, &tick, &after);
+
+    if (type != REPLAY_TAG_CHECKSUM || tick != replay->tick) {
+        return;
+    }
+
+    const uint64_t recorded = reader_get_u64(&after);
+    if (after.error) {
+        return;
+    }
+    replay->stream = after;
+    replay->last_event_tick = tick;
+
+    if (recorded != hash && !replay->desynced) {
+        replay->desynced = 1;
+        replay->desync_tick = tick;
+    }
+}
+
+static void fill_header(replay_t* replay, const char* level_data, const size_t level_size,
+                        const conf_t* config, const char* username) {
+    memset(&replay->header, 0, sizeof(replay->header));
+    memcpy(replay->header.magic, REPLAY_MAGIC, sizeof(replay->header.magic));
+    replay->header.version = REPLAY_VERSION;
+    replay->header.level_hash = hash_bytes(level_data, level_size);
+    replay->header.level_size = (uint32_t)level_size;
+    replay->header.seed = config->seed;
+    replay->header.level_nr = config->level_nr;
+    replay->header.timestamp = (int64_t)time(NULL);
+    if (username) {
+        strncpy(replay->header.username, username, MAX_USERNAME_LENGTH - 1);
+    }
+}
+
+/**
+ * create_replay_file - Creates the file for a new recording
+ * @replay: replay being recorded
+ *
+ * Existing files are never opened: if the reserved id is taken, another
+ * one is reserved.
+ *
+ * RETURNS
+ * 0 on success, -1 if no file could be created.
+ */
+static int create_replay_file(replay_t* replay) {
+    char path[MAX_LINE_LENGTH];
+
+    for (int attempt = 0; attempt < REPLAY_CREATE_ATTEMPTS; attempt++) {
+        replay->id = replay_index_reserve_id();
+        replay_path_for_id(replay->id, path, sizeof(path));
+        mem_free(replay->path);
+        replay->path = mem_strdup(MEM_REPLAY, path);
+
+        replay->fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        if (replay->fd >= 0) {
+            return 0;
+        }
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+    replay->id = 0;
+    mem_free(replay->path);
+    replay->path = NULL;
+    return -1;
+}
+
+/**
+ * replay_start_recording - opens a new replay file in the library
+ * @replay: replay state to (re)initialize
+ * @level_data: contents of the level file being played
+ * @level_size: number of bytes in @level_data
+ * @config: configuration parsed from @level_data
+ * @username: player name stored in the header
+ *
+ * The level contents are embedded in the file, so playback never depends on
+ * the level file on disk. If the file cannot be created the game is still
+ * playable, it just is not recorded.
+ *
+ * RETURNS
+ * Void.
+ */
+void replay_start_recording(replay_t* replay, const char* level_data, const size_t level_size,
+                            const conf_t* config, const char* username) {
+    replay_close(replay);
+    replay->events.len = 0;
+    replay->events.tag = MEM_REPLAY;
+    replay->bytes_written = 0;
+    replay->tick = 0;
+    replay->last_event_tick = 0;
+    replay->last_flush_tick = 0;
+    fill_header(replay, level_data, level_size, config, username);
+
+    if (create_replay_file(replay) != 0) {
+        return;
+    }
+    if (write_all(replay->fd, &replay->header, sizeof(replay->header)) != 0 ||
+        write_all(replay->fd, level_data, level_size) != 0) {
+        close(replay->fd);
+        replay->fd = -1;
+    }
+}
+
+void replay_record_key(replay_t* replay, const int key) {
+    put_record_header(replay, (unsigned int)key);
+}
+
+void replay_record_keyframe(replay_t* replay, const ByteBuffer* snapshot) {
+    put_record_header(replay, REPLAY_TAG_KEYFRAME);
+    buffer_put_varint(&replay->events, snapshot->len);
+    buffer_put_bytes(&replay->events, snapshot->data, snapshot->len);
+}
+
+void replay_end_tick(replay_t* replay) {
+    if (replay->replay_state == REPLAY_PLAYING) {
+        skip_stale_records(replay);
+    }
+    replay->tick++;
+    if (replay->replay_state == REPLAY_RECORDING &&
+        (replay->events.len >= REPLAY_FLUSH_BYTES ||
+         replay->tick - replay->last_flush_tick >= REPLAY_FLUSH_TICKS)) {
+        flush_events(replay);
+    }
+}
+
+/**
+ * replay_finish_recording - completes the replay file and indexes it
+ * @replay: replay being recorded
+ * @score: final score
+ * @result: final game result
+ *
+ * Flushes the remaining events, patches the final score into the header and
+ * adds the replay to the library index (which may evict older replays).
+ *
+ * RETURNS
+ * Void.
+ */
+void replay_finish_recording(replay_t* replay, const int score, const int result) {
+    flush_events(replay);
+    if (replay->fd < 0) {
+        return;
+    }
+
+    replay->header.score = score;
+    replay->header.result = result;
+    replay->header.ticks = replay->tick;
+    pwrite(replay->fd, &replay->header, sizeof(replay->header), 0);
+    close(replay->fd);
+    replay->fd = -1;
+
+    ReplayIndexEntry entry = {0};
+    entry.id = replay->id;
+    entry.level_nr = replay->header.level_nr;
+    entry.score = score;
+    entry.result = result;
+    entry.ticks = replay->tick;
+    entry.file_size =
+            (uint32_t)(sizeof(replay->header) + replay->header.level_size + replay->bytes_written);
+    entry.timestamp = replay->header.timestamp;
+    entry.level_hash = replay->header.level_hash;
+    memcpy(entry.username, replay->header.username, MAX_USERNAME_LENGTH);
+    replay_index_add(&entry);
+}
+
+static int validate_mapping(replay_t* replay) {
+    const ReplayFileHeader* header = (const ReplayFileHeader*)replay->map;
+    if (replay->map_len < sizeof(*header) ||
+        memcmp(header->magic, REPLAY_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != REPLAY_VERSION ||
+        header->level_size > replay->map_len - sizeof(*header)) {
+        return -1;
+    }
+
+    const char* level_data = (const char*)replay->map + sizeof(*header);
+    if (hash_bytes(level_data, header->level_size) != header->level_hash) {
+        return -1;
+    }
+
+    replay->header = *header;
+    replay->stream.data = (const unsigned char*)level_data + header->level_size;
+    replay->stream.len = replay->map_len - sizeof(*header) - header->level_size;
+    replay->stream.pos = 0;
+    replay->stream.error = 0;
+    return 0;
+}
+
+/**
+ * replay_open - maps a replay file for playback
+ * @replay: replay state to load into
+ * @path: replay file path
+ *
+ * RETURNS
+ * 0 on success, -1 if the file is missing, truncated or corrupted.
+ */
+int replay_open(replay_t* replay, const char* path) {
+    replay_close(replay);
+
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    replay->map = map;
+    replay->map_len = (size_t)st.st_size;
+    if (validate_mapping(replay) != 0) {
+        replay_close(replay);
+        return -1;
+    }
+    index_keyframes(replay);
+    return 0;
+}
+
+const char* replay_level_data(const replay_t* replay) {
+    return (const char*)replay->map + sizeof(ReplayFileHeader);
+}
+
+void replay_start_playback(replay_t* replay) {
+    replay->stream.pos = 0;
+    replay->tick = 0;
+    replay->last_event_tick = 0;
+    replay->desynced = 0;
+    replay->desync_tick = 0;
+}
+
+/**
+ * replay_checkpoint - records or verifies the simulation hash
+ * @replay: replay state
+ * @hash: hash of the state at the end of the current tick
+ * @final: non-zero on the last tick of the game
+ *
+ * A checksum is taken every REPLAY_CHECKSUM_TICKS ticks and on the final
+ * tick. During playback the first mismatch is remembered in desync_tick.
+ *
+ * RETURNS
+ * Void.
+ */
+void replay_checkpoint(replay_t* replay, const uint64_t hash, const int final) {
+    if (replay->tick % REPLAY_CHECKSUM_TICKS != 0 && !final) {
+        return;
+    }
+
+    if (replay->replay_state == REPLAY_RECORDING) {
+        record_checksum(replay, hash);
+    } else if (replay->replay_state == REPLAY_PLAYING) {
+        verify_checksum(replay, hash);
+    }
+}
+
+/**
+ * replay_find_keyframe - finds the keyframe to resume from
+ * @replay: replay being played back
+ * @tick: the tick that should be simulated next
+ *
+ * RETURNS
+ * The latest keyframe taken before @tick, or NULL if there is none.
+ */
+const ReplayKeyframe* replay_find_keyframe(const replay_t* replay, const unsigned int tick) {
+    const ReplayKeyframe* best = NULL;
+    for (int i = 0; i < replay->keyframe_count; i++) {
+        if (replay->keyframes[i].tick < tick) {
+            best = &replay->keyframes[i];
+        }
+    }
+    return best;
+}
+
+const unsigned char* replay_keyframe_data(const replay_t* replay, const ReplayKeyframe* keyframe) {
+    return replay->stream.data + keyframe->payload_pos;
+}
+
+void replay_resume_after(replay_t* replay, const ReplayKeyframe* keyframe) {
+    replay->stream.pos = keyframe->next_pos;
+    replay->stream.error = 0;
+    replay->last_event_tick = keyframe->tick;
+    replay->tick = keyframe->tick + 1;
+}
+
+/**
+ * replay_close - releases the playback mapping and any open recording file
+ * @replay: replay state
+ *
+ * RETURNS
+ * Void.
+ */
+void replay_close(replay_t* replay) {
+    if (replay->map != NULL) {
+        munmap(replay->map, replay->map_len);
+        replay->map = NULL;
+        replay->map_len = 0;
+    }
+    memset(&replay->stream, 0, sizeof(replay->stream));
+    mem_free(replay->keyframes);
+    replay->keyframes = NULL;
+    replay->keyframe_count = 0;
+
+    if (replay->fd >= 0) {
+        close(replay->fd);
+    }
+    replay->fd = -1;
+}
+
+void replay_free(replay_t* replay) {
+    replay_close(replay);
+    buffer_free(&replay->events);
+    mem_free(replay->path);
+    replay->path = NULL;
+}
@@ -0,0 +1,26 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "types.h"
+
+void replay_start_recording(replay_t* replay, const char* level_data, size_t level_size,
+                            const conf_t* config, const char* username);
+void replay_record_key(replay_t* replay, int key);
+void replay_record_keyframe(replay_t* replay, const ByteBuffer* snapshot);
+void replay_checkpoint(replay_t* replay, uint64_t hash, int final);
+void replay_end_tick(replay_t* replay);
+void replay_finish_recording(replay_t* replay, int score, int result);
+
+int replay_open(replay_t* replay, const char* path);
+const char* replay_level_data(const replay_t* replay);
+void replay_start_playback(replay_t* replay);
+int replay_next_key(replay_t* replay);
+
+const ReplayKeyframe* replay_find_keyframe(const replay_t* replay, unsigned int tick);
+const unsigned char* replay_keyframe_data(const replay_t* replay, const ReplayKeyframe* keyframe);
+void replay_resume_after(replay_t* replay, const ReplayKeyframe* keyframe);
+
+void replay_close(replay_t* replay);
+void replay_free(replay_t* replay);
+
+#endif  // REPLAY_H
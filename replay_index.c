@@ -0,0 +1,352 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "ranking.h"
+#include "replay_index.h"
+#include "types.h"
+#include "utils.h"
+
+void replay_path_for_id(const uint32_t id, char* buffer, const size_t size) {
+    snprintf(buffer, size, "%s/%08u.swr", REPLAY_DIR, (unsigned int)id);
+}
+
+static void replay_index_save(const ReplayIndexEntry* entries, const int count,
+                              const uint32_t next_id) {
+    ReplayIndexHeader header = {0};
+    memcpy(header.magic, REPLAY_INDEX_MAGIC, sizeof(header.magic));
+    header.version = REPLAY_INDEX_VERSION;
+    header.next_id = next_id;
+    header.count = (uint32_t)count;
+
+    // Write a temporary file first so a crash never leaves a torn index.
+    char tmp_path[MAX_LINE_LENGTH];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d", REPLAY_INDEX_TMP_PATH, (int)getpid());
+    FILE* file = fopen(tmp_path, "wb");
+    if (!file) {
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    if (count > 0) {
+        fwrite(entries, sizeof(ReplayIndexEntry), count, file);
+    }
+    if (fclose(file) == 0) {
+        rename(tmp_path, REPLAY_INDEX_PATH);
+    } else {
+        remove(tmp_path);
+    }
+}
+
+/**
+ * lock_index - Takes the lock every update of the index is made under
+ *
+ * Updates load, change and save the whole index, so two games finishing
+ * at once would otherwise lose one of their entries. Creates the replay
+ * directory on first use.
+ *
+ * RETURNS
+ * The lock's file descriptor for unlock_index(), or -1 if the lock cannot
+ * be taken; the update then goes ahead unlocked.
+ */
+static int lock_index(void) {
+    mkdir(REPLAY_DIR, 0755);
+    const int fd = open(REPLAY_INDEX_LOCK_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void unlock_index(const int fd) {
+    if (fd >= 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+    }
+}
+
+static uint32_t parse_replay_id(const char* path) {
+    const char* name = strrchr(path, '/');
+    unsigned int id = 0;
+    int len = 0;
+
+    name = name ? name + 1 : path;
+    if (sscanf(name, "%8u.swr%n", &id, &len) != 1 || len != 12 || name[len] != '\0') {
+        return 0;
+    }
+    return id;
+}
+
+/**
+ * read_index_entry - Builds the index entry of a replay file from its header
+ * @path: replay file
+ * @id: id the file name carries
+ * @entry: receives the entry
+ *
+ * RETURNS
+ * 0 on success, -1 if the file is not a finished replay of this version.
+ */
+static int read_index_entry(const char* path, const uint32_t id, ReplayIndexEntry* entry) {
+    ReplayFileHeader header;
+    struct stat st;
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+    const int ok = fread(&header, sizeof(header), 1, file) == 1 &&
+                   memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) == 0 &&
+                   header.version == REPLAY_VERSION && header.ticks > 0 &&
+                   fstat(fileno(file), &st) == 0;
+    fclose(file);
+    if (!ok) {
+        return -1;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->id = id;
+    entry->level_nr = header.level_nr;
+    entry->score = header.score;
+    entry->result = header.result;
+    entry->ticks = header.ticks;
+    entry->file_size = (uint32_t)st.st_size;
+    entry->timestamp = header.timestamp;
+    entry->level_hash = header.level_hash;
+    memcpy(entry->username, header.username, MAX_USERNAME_LENGTH);
+    entry->username[MAX_USERNAME_LENGTH - 1] = '\0';
+    return 0;
+}
+
+/**
+ * replay_index_rebuild - Recreates the index from the files in the library
+ * @entries: receives a heap array of entries (NULL when empty)
+ * @next_id: receives one more than the largest id of any replay file
+ *
+ * Files of another replay version or unfinished recordings are not indexed,
+ * but their ids still count, so new recordings never overwrite them.
+ *
+ * RETURNS
+ * Number of entries.
+ */
+static int replay_index_rebuild(ReplayIndexEntry** entries, uint32_t* next_id) {
+    char** paths = NULL;
+    const int path_count = list_files(REPLAY_DIR, ".swr", &paths);
+    int count = 0;
+
+    for (int i = 0; i < path_count; i++) {
+        const uint32_t id = parse_replay_id(paths[i]);
+        ReplayIndexEntry entry;
+        if (id >= *next_id) {
+            *next_id = id + 1;
+        }
+        if (id > 0 && read_index_entry(paths[i], id, &entry) == 0) {
+            *entries = (ReplayIndexEntry*)mem_realloc(MEM_REPLAY, *entries,
+                                                      sizeof(ReplayIndexEntry) * (count + 1));
+            if (*entries == NULL) {
+                exit(1);
+            }
+            (*entries)[count++] = entry;
+        }
+        free(paths[i]);
+    }
+    free((void*)paths);
+
+    if (path_count > 0) {
+        replay_index_save(*entries, count, *next_id);
+    }
+    return count;
+}
+
+/**
+ * replay_index_load - reads every entry of the replay index
+ * @entries: receives a heap array of entries (NULL when empty)
+ * @next_id: receives the id the next recorded replay should use
+ *
+ * A missing or malformed index is rebuilt from the replay files, so ids
+ * already on disk are never handed out again. Callers hold the index lock.
+ *
+ * RETURNS
+ * Number of entries read.
+ */
+int replay_index_load(ReplayIndexEntry** entries, uint32_t* next_id) {
+    ReplayIndexHeader header = {0};
+    *entries = NULL;
+    *next_id = 1;
+
+    FILE* file = fopen(REPLAY_INDEX_PATH, "rb");
+    if (!file) {
+        return replay_index_rebuild(entries, next_id);
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, REPLAY_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != REPLAY_INDEX_VERSION) {
+        fclose(file);
+        return replay_index_rebuild(entries, next_id);
+    }
+
+    *next_id = header.next_id;
+    if (header.count > 0) {
+        *entries = (ReplayIndexEntry*)mem_calloc(MEM_REPLAY, header.count,
+                                                 sizeof(ReplayIndexEntry));
+        if (*entries == NULL) {
+            exit(1);
+        }
+        header.count = (uint32_t)fread(*entries, sizeof(ReplayIndexEntry), header.count, file);
+    }
+    fclose(file);
+    return (int)header.count;
+}
+
+/**
+ * replay_index_reserve_id - allocates the id for a new replay file
+ *
+ * RETURNS
+ * The reserved id.
+ */
+uint32_t replay_index_reserve_id(void) {
+    ReplayIndexEntry* entries = NULL;
+    uint32_t next_id = 0;
+
+    const int lock = lock_index();
+    const int count = replay_index_load(&entries, &next_id);
+    replay_index_save(entries, count, next_id + 1);
+    unlock_index(lock);
+    mem_free(entries);
+
+    return next_id;
+}
+
+static int is_ranked(const uint32_t id, const uint32_t* ranked, const int ranked_count) {
+    for (int i = 0; i < ranked_count; i++) {
+        if (ranked[i] == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * find_eviction_victim - picks the least valuable replay
+ * @entries: index entries
+ * @count: number of entries
+ * @keep_id: replay that must survive (the one just recorded)
+ * @ranked: replays backing ranked scores, which also survive
+ * @ranked_count: number of entries in @ranked
+ *
+ * Lower scores are worth less; among equal scores the oldest goes first.
+ *
+ * RETURNS
+ * Index of the victim, or -1 if nothing can be evicted.
+ */
+static int find_eviction_victim(const ReplayIndexEntry* entries, const int count,
+                                const uint32_t keep_id, const uint32_t* ranked,
+                                const int ranked_count) {
+    int victim = -1;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].id == keep_id || is_ranked(entries[i].id, ranked, ranked_count)) {
+            continue;
+        }
+        if (victim < 0 || entries[i].score < entries[victim].score ||
+            (entries[i].score == entries[victim].score && entries[i].id < entries[victim].id)) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+static void enforce_storage_budget(ReplayIndexEntry* entries, int* count, const uint32_t keep_id) {
+    uint64_t total = 0;
+    for (int i = 0; i < *count; i++) {
+        total += entries[i].file_size;
+    }
+
+    uint32_t* ranked = NULL;
+    const int ranked_count = total > REPLAY_STORAGE_BUDGET ? ranking_replay_ids(&ranked) : 0;
+    while (total > REPLAY_STORAGE_BUDGET) {
+        const int victim = find_eviction_victim(entries, *count, keep_id, ranked, ranked_count);
+        if (victim < 0) {
+            break;
+        }
+
+        char path[MAX_LINE_LENGTH];
+        replay_path_for_id(entries[victim].id, path, sizeof(path));
+        remove(path);
+
+        total -= entries[victim].file_size;
+        entries[victim] = entries[*count - 1];
+        (*count)--;
+    }
+    mem_free(ranked);
+}
+
+void replay_index_add(const ReplayIndexEntry* entry) {
+    ReplayIndexEntry* entries = NULL;
+    uint32_t next_id = 0;
+    const int lock = lock_index();
+    int count = replay_index_load(&entries, &next_id);
+
+    ReplayIndexEntry* new_ptr = (ReplayIndexEntry*)mem_realloc(
+            MEM_REPLAY, entries, sizeof(ReplayIndexEntry) * (count + 1));
+    if (new_ptr == NULL) {
+        exit(1);
+    }
+    entries = new_ptr;
+    entries[count++] = *entry;
+
+    enforce_storage_budget(entries, &count, entry->id);
+    replay_index_save(entries, count, next_id);
+    unlock_index(lock);
+    mem_free(entries);
+}
+
+static int matches_filter(const ReplayIndexEntry* entry, const ReplayFilter* filter) {
+    if (filter->username && strcmp(entry->username, filter->username) != 0) {
+        return 0;
+    }
+    if (filter->level_nr > 0 && entry->level_nr != filter->level_nr) {
+        return 0;
+    }
+    return entry->score >= filter->min_score;
+}
+
+static int compare_newest_first(const void* a, const void* b) {
+    const ReplayIndexEntry* entry_a = (const ReplayIndexEntry*)a;
+    const ReplayIndexEntry* entry_b = (const ReplayIndexEntry*)b;
+    return (entry_a->id < entry_b->id) - (entry_a->id > entry_b->id);
+}
+
+/**
+ * replay_index_query - lists the replays matching a filter
+ * @filter: username (NULL for any), level (0 for any) and minimum score
+ * @out: receives a heap array of matching entries, newest first
+ *
+ * Only the index is read; replay files are not opened.
+ *
+ * RETURNS
+ * Number of matching entries.
+ */
+int replay_index_query(const ReplayFilter* filter, ReplayIndexEntry** out) {
+    uint32_t next_id = 0;
+    // Loading may rebuild and save the index, so it is locked here as well.
+    const int lock = lock_index();
+    const int count = replay_index_load(out, &next_id);
+    unlock_index(lock);
+    int matched = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (matches_filter(&(*out)[i], filter)) {
+            (*out)[matched++] = (*out)[i];
+        }
+    }
+
+    if (matched > 1) {
+        qsort(*out, matched, sizeof(ReplayIndexEntry), compare_newest_first);
+    }
+    return matched;
+}
@@ -0,0 +1,12 @@
+#ifndef REPLAY_INDEX_H
+#define REPLAY_INDEX_H
+
+#include "types.h"
+
+void replay_path_for_id(uint32_t id, char* buffer, size_t size);
+int replay_index_load(ReplayIndexEntry** entries, uint32_t* next_id);
+uint32_t replay_index_reserve_id(void);
+void replay_index_add(const ReplayIndexEntry* entry);
+int replay_index_query(const ReplayFilter* filter, ReplayIndexEntry** out);
+
+#endif  // REPLAY_INDEX_H
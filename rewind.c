@@ -0,0 +1,649 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "hunter.h"
+#include "mem.h"
+#include "physics.h"
+#include "rewind.h"
+#include "star.h"
+#include "types.h"
+
+/*
+ * Practice rewind keeps one undo record per simulated tick in a bounded ring.
+ * A record holds only what changed during the tick, as the values from before
+ * it: counters that moved, entity fields that differ (entities are matched by
+ * their stable id), spawned and removed entities with their list position,
+ * and changed occupancy cells. Capturing is a diff against shadow copies of
+ * the previous tick, so a quiet tick costs a few chunk compares and a
+ * handful of bytes.
+ */
+
+static uint64_t float_bits(const float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_float(const uint64_t bits) {
+    const uint32_t narrow = (uint32_t)bits;
+    float value = 0;
+    memcpy(&value, &narrow, sizeof(value));
+    return value;
+}
+
+static void read_counters(const Game* game, uint64_t* c) {
+    c[0] = float_bits(game->time_left);
+    c[1] = float_bits(game->albatross_cooldown);
+    c[2] = (uint64_t)game->game_speed;
+    c[3] = (uint64_t)game->stars_collected;
+    c[4] = (uint64_t)game->hunter_spawn_tick;
+    c[5] = (uint64_t)game->star_spawn_tick;
+    c[6] = (uint64_t)game->star_move_tick;
+    c[7] = (uint64_t)game->star_flicker_tick;
+    c[8] = (uint64_t)game->score;
+    c[9] = (uint64_t)game->result;
+    c[10] = (uint64_t)game->running;
+    c[11] = (uint64_t)game->entities.swallow->hp;
+    c[12] = game->rng_state;
+    c[13] = game->state_hash;
+    c[14] = game->next_entity_id;
+    c[15] = (uint64_t)game->taxi.active;
+    c[16] = (uint64_t)game->taxi.frame;
+    c[17] = ((uint64_t)(uint32_t)game->taxi.from_x << 32) | (uint32_t)game->taxi.from_y;
+    c[18] = ((uint64_t)(uint32_t)game->taxi.to_x << 32) | (uint32_t)game->taxi.to_y;
+}
+
+static void write_counters(Game* game, const uint64_t* c) {
+    game->time_left = bits_float(c[0]);
+    game->albatross_cooldown = bits_float(c[1]);
+    game->game_speed = (int)c[2];
+    game->stars_collected = (int)c[3];
+    game->hunter_spawn_tick = (int)c[4];
+    game->star_spawn_tick = (int)c[5];
+    game->star_move_tick = (int)c[6];
+    game->star_flicker_tick = (int)c[7];
+    game->score = (int)c[8];
+    game->result = (char)c[9];
+    game->running = (char)c[10];
+    game->entities.swallow->hp = (int)c[11];
+    game->rng_state = c[12];
+    game->state_hash = c[13];
+    game->next_entity_id = (uint32_t)c[14];
+    game->taxi.active = (char)c[15];
+    game->taxi.frame = (int)c[16];
+    game->taxi.from_x = (int)(int32_t)(c[17] >> 32);
+    game->taxi.from_y = (int)(int32_t)c[17];
+    game->taxi.to_x = (int)(int32_t)(c[18] >> 32);
+    game->taxi.to_y = (int)(int32_t)c[18];
+}
+
+static void flatten_entity(const entity_t* ent, int64_t* f) {
+    f[0] = ent->x;
+    f[1] = ent->y;
+    f[2] = ent->dx;
+    f[3] = ent->dy;
+    f[4] = ent->speed;
+    f[5] = ent->width;
+    f[6] = ent->height;
+    f[7] = ent->anim_frame;
+    f[8] = ent->anim_timer;
+    f[9] = ent->direction;
+    f[10] = ent->color;
+    f[11] = (int64_t)ent->hash;
+}
+
+static void flatten_hunter(const Hunter* h, int64_t* f) {
+    flatten_entity(&h->ent, f);
+    f[12] = h->template_idx;
+    f[13] = h->bounces;
+    f[14] = h->damage;
+    f[15] = h->state;
+    f[16] = h->state_timer;
+    f[17] = h->base_speed;
+    f[18] = h->dash_cooldown;
+}
+
+static void restore_entity(entity_t* ent, const int64_t* f) {
+    ent->x = (int)f[0];
+    ent->y = (int)f[1];
+    ent->dx = (int)f[2];
+    ent->dy = (int)f[3];
+    ent->speed = (int)f[4];
+    ent->width = (int)f[5];
+    ent->height = (int)f[6];
+    ent->anim_frame = (int)f[7];
+    ent->anim_timer = (int)f[8];
+    ent->direction = (direction_t)(f[9] % NUM_DIRECTIONS);
+    ent->color = (ColorPair)f[10];
+    ent->hash = (uint64_t)f[11];
+}
+
+static void restore_hunter(Hunter* h, const int64_t* f) {
+    restore_entity(&h->ent, f);
+    h->bounces = (int)f[13];
+    h->damage = (int)f[14];
+    h->state = (HunterState)f[15];
+    h->state_timer = (int)f[16];
+    h->base_speed = (int)f[17];
+    h->dash_cooldown = (int)f[18];
+}
+
+static void reserve_entities(Rewind* rw, const int count) {
+    if (count <= rw->capacity) {
+        return;
+    }
+
+    int capacity = rw->capacity ? rw->capacity : REWIND_INITIAL_ENTITIES;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    const size_t size = sizeof(RewindEntity) * (size_t)capacity;
+    RewindEntity* shadow = mem_realloc(MEM_REWIND, rw->shadow, size);
+    RewindEntity* current = mem_realloc(MEM_REWIND, rw->current, size);
+    if (!shadow || !current) {
+        exit(1);
+    }
+    rw->shadow = shadow;
+    rw->current = current;
+    rw->capacity = capacity;
+}
+
+/**
+ * flatten_world - copies every entity into rw->current
+ * @game: Main game struct
+ * @rw: rewind state
+ *
+ * Entities are laid out as the swallow, then the hunters and stars in list
+ * order, which is the order diff_entities relies on.
+ *
+ * RETURNS
+ * The number of entities written.
+ */
+static int flatten_world(const Game* game, Rewind* rw) {
+    int count = 1;
+    for (const Hunter* h = game->entities.hunters; h; h = h->next) {
+        count++;
+    }
+    for (const Star* s = game->entities.stars; s; s = s->next) {
+        count++;
+    }
+    reserve_entities(rw, count);
+
+    RewindEntity* out = rw->current;
+    memset(out, 0, sizeof(RewindEntity) * (size_t)count);
+    out->kind = SWALLOW;
+    flatten_entity(&game->entities.swallow->ent, out->fields);
+    out++;
+    for (const Hunter* h = game->entities.hunters; h; h = h->next, out++) {
+        out->id = h->ent.id;
+        out->kind = HUNTER;
+        flatten_hunter(h, out->fields);
+    }
+    for (const Star* s = game->entities.stars; s; s = s->next, out++) {
+        out->id = s->ent.id;
+        out->kind = STAR;
+        flatten_entity(&s->ent, out->fields);
+    }
+    return count;
+}
+
+static void put_counter_delta(ByteBuffer* rec, Rewind* rw, const Game* game) {
+    uint64_t now[REWIND_COUNTERS];
+    read_counters(game, now);
+
+    uint64_t mask = 0;
+    for (int i = 0; i < REWIND_COUNTERS; i++) {
+        if (now[i] != rw->counters[i]) {
+            mask |= 1ULL << i;
+        }
+    }
+    buffer_put_varint(rec, mask);
+    for (int i = 0; i < REWIND_COUNTERS; i++) {
+        if (mask & (1ULL << i)) {
+            buffer_put_varint(rec, rw->counters[i]);
+        }
+    }
+    memcpy(rw->counters, now, sizeof(now));
+}
+
+static void put_changed(ByteBuffer* rec, const RewindEntity* old, const RewindEntity* cur) {
+    uint64_t mask = 0;
+    for (int i = 0; i < REWIND_ENTITY_FIELDS; i++) {
+        if (old->fields[i] != cur->fields[i]) {
+            mask |= 1ULL << i;
+        }
+    }
+    if (mask == 0) {
+        return;
+    }
+
+    buffer_put_u8(rec, REWIND_OP_CHANGED);
+    buffer_put_u8(rec, old->kind);
+    buffer_put_varint(rec, old->id);
+    buffer_put_varint(rec, mask);
+    for (int i = 0; i < REWIND_ENTITY_FIELDS; i++) {
+        if (mask & (1ULL << i)) {
+            buffer_put_svarint(rec, old->fields[i]);
+        }
+    }
+}
+
+static void put_spawned(ByteBuffer* rec, const RewindEntity* cur) {
+    buffer_put_u8(rec, REWIND_OP_SPAWNED);
+    buffer_put_u8(rec, cur->kind);
+    buffer_put_varint(rec, cur->id);
+}
+
+static void put_removed(ByteBuffer* rec, const RewindEntity* old, const uint32_t index) {
+    buffer_put_u8(rec, REWIND_OP_REMOVED);
+    buffer_put_u8(rec, old->kind);
+    buffer_put_varint(rec, old->id);
+    buffer_put_varint(rec, index);
+    for (int i = 0; i < REWIND_ENTITY_FIELDS; i++) {
+        buffer_put_svarint(rec, old->fields[i]);
+    }
+}
+
+static void diff_kind(ByteBuffer* rec, const Rewind* rw, const int count, const collision_t kind,
+                      int* i, int* j) {
+    uint32_t index = 0;
+
+    while (1) {
+        const RewindEntity* old = NULL;
+        const RewindEntity* cur = NULL;
+        if (*i < rw->shadow_count && rw->shadow[*i].kind == kind) {
+            old = &rw->shadow[*i];
+        }
+        if (*j < count && rw->current[*j].kind == kind) {
+            cur = &rw->current[*j];
+        }
+
+        if (!old && !cur) {
+            return;
+        } else if (old && cur && old->id == cur->id) {
+            put_changed(rec, old, cur);
+            (*i)++, (*j)++, index++;
+        } else if (cur && (!old || cur->id > rw->next_id)) {
+            put_spawned(rec, cur);
+            (*j)++;
+        } else {
+            put_removed(rec, old, index);
+            (*i)++, index++;
+        }
+    }
+}
+
+/**
+ * diff_entities - records how the entity lists changed during the tick
+ * @rec: undo record being built
+ * @rw: rewind state (shadow holds the previous tick, current this one)
+ * @count: number of entities in rw->current
+ *
+ * Lists only ever lose nodes or gain new ones, never reorder, so one merge
+ * walk per kind is enough. A node with an id above the previous next_id was
+ * spawned this tick; an old node the walk skips over was removed, and its
+ * index among the old nodes is where undo reinserts it.
+ *
+ * RETURNS
+ * Void.
+ */
+static void diff_entities(ByteBuffer* rec, const Rewind* rw, const int count) {
+    const collision_t kinds[] = {SWALLOW, HUNTER, STAR};
+    int i = 0;
+    int j = 0;
+
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        diff_kind(rec, rw, count, kinds[k], &i, &j);
+    }
+}
+
+/**
+ * diff_chunk - emits the occupancy cells of one chunk that changed
+ * @rec: undo record
+ * @rw: rewind state
+ * @game: Main game struct
+ * @index: chunk index
+ * @last: previous cell index, cells are delta-coded against it
+ *
+ * Chunks missing on either side count as EMPTY; the shadow chunk is brought
+ * up to date afterwards.
+ *
+ * RETURNS
+ * Void.
+ */
+static void diff_chunk(ByteBuffer* rec, Rewind* rw, const Game* game, const int index,
+                       int64_t* last) {
+    const OccupancyMap* map = &game->occupancy_map;
+    const OccupancyChunk* live = map->chunks[index];
+    const OccupancyChunk* shadow = rw->map.chunks[index];
+    if (live == shadow || (live && shadow && memcmp(live->cells, shadow->cells,
+                                                    sizeof(live->cells)) == 0)) {
+        return;
+    }
+
+    const int base_x = (index % map->chunk_cols) << OCCUPANCY_CHUNK_SHIFT;
+    const int base_y = (index / map->chunk_cols) << OCCUPANCY_CHUNK_SHIFT;
+    for (int i = 0; i < OCCUPANCY_CHUNK_CELLS; i++) {
+        const char now = live ? live->cells[i] : EMPTY;
+        const char old = shadow ? shadow->cells[i] : EMPTY;
+        if (now != old) {
+            const int64_t y = base_y + (i >> OCCUPANCY_CHUNK_SHIFT);
+            const int64_t cell = (y * map->cols) + base_x + (i & (OCCUPANCY_CHUNK_SIZE - 1));
+            buffer_put_u8(rec, REWIND_OP_CELL);
+            buffer_put_svarint(rec, cell - *last);
+            buffer_put_u8(rec, (unsigned char)old);
+            *last = cell;
+        }
+    }
+    occupancy_copy_chunk(&rw->map, map, index);
+}
+
+static void diff_occupancy(ByteBuffer* rec, Rewind* rw, const Game* game) {
+    const int chunks = game->occupancy_map.chunk_rows * game->occupancy_map.chunk_cols;
+    int64_t last = 0;
+
+    for (int i = 0; i < chunks; i++) {
+        diff_chunk(rec, rw, game, i, &last);
+    }
+}
+
+static void drop_oldest(Rewind* rw) {
+    const int oldest = (rw->head - rw->count + REWIND_HISTORY_TICKS) % REWIND_HISTORY_TICKS;
+    rw->bytes -= rw->records[oldest].len;
+    rw->records[oldest].len = 0;
+    rw->count--;
+}
+
+/**
+ * rewind_capture - appends the undo record for the tick just simulated
+ * @game: Main game struct
+ *
+ * Oldest records are dropped once REWIND_HISTORY_TICKS records or
+ * REWIND_MAX_BYTES bytes are held. Record buffers are reused in place, so
+ * capturing stops allocating once the ring has wrapped.
+ *
+ * RETURNS
+ * Void.
+ */
+void rewind_capture(Game* game) {
+    Rewind* rw = &game->rewind;
+    if (rw->count == REWIND_HISTORY_TICKS) {
+        drop_oldest(rw);
+    }
+    ByteBuffer* rec = &rw->records[rw->head];
+    rec->len = 0;
+
+    put_counter_delta(rec, rw, game);
+    const int count = flatten_world(game, rw);
+    diff_entities(rec, rw, count);
+    diff_occupancy(rec, rw, game);
+    buffer_put_u8(rec, REWIND_OP_END);
+
+    RewindEntity* swap = rw->shadow;
+    rw->shadow = rw->current;
+    rw->current = swap;
+    rw->shadow_count = count;
+    rw->next_id = game->next_entity_id;
+
+    rw->head = (rw->head + 1) % REWIND_HISTORY_TICKS;
+    rw->count++;
+    rw->bytes += rec->len;
+    while (rw->count > 1 && rw->bytes > REWIND_MAX_BYTES) {
+        drop_oldest(rw);
+    }
+}
+
+static void sync_shadow(Game* game) {
+    Rewind* rw = &game->rewind;
+    const int chunks = game->occupancy_map.chunk_rows * game->occupancy_map.chunk_cols;
+
+    read_counters(game, rw->counters);
+    rw->next_id = game->next_entity_id;
+    rw->shadow_count = flatten_world(game, rw);
+    RewindEntity* swap = rw->shadow;
+    rw->shadow = rw->current;
+    rw->current = swap;
+
+    for (int i = 0; i < chunks; i++) {
+        occupancy_copy_chunk(&rw->map, &game->occupancy_map, i);
+    }
+}
+
+/**
+ * rewind_reset - clears the history and starts capturing from the current state
+ * @game: Main game struct (occupancy map and swallow must be set up)
+ *
+ * RETURNS
+ * Void.
+ */
+void rewind_reset(Game* game) {
+    Rewind* rw = &game->rewind;
+    if (rw->records == NULL) {
+        rw->records = mem_calloc(MEM_REWIND, REWIND_HISTORY_TICKS, sizeof(ByteBuffer));
+        if (!rw->records) {
+            exit(1);
+        }
+        for (int i = 0; i < REWIND_HISTORY_TICKS; i++) {
+            rw->records[i].tag = MEM_REWIND;
+        }
+    }
+    if (rw->map.rows != game->arena_rows || rw->map.cols != game->arena_cols) {
+        occupancy_free(&rw->map);
+        occupancy_init(&rw->map, game->arena_rows, game->arena_cols);
+    }
+
+    for (int i = 0; i < REWIND_HISTORY_TICKS; i++) {
+        rw->records[i].len = 0;
+    }
+    rw->head = 0;
+    rw->count = 0;
+    rw->bytes = 0;
+    sync_shadow(game);
+}
+
+static int read_op(ByteReader* reader, RewindOp* op) {
+    op->op = (RewindOpKind)reader_get_u8(reader);
+    if (reader->error || op->op == REWIND_OP_END) {
+        return 0;
+    }
+
+    if (op->op == REWIND_OP_CELL) {
+        op->cell += (uint64_t)reader_get_svarint(reader);
+        op->value = (char)reader_get_u8(reader);
+        return !reader->error;
+    }
+
+    op->kind = (collision_t)reader_get_u8(reader);
+    op->id = (uint32_t)reader_get_varint(reader);
+    if (op->op == REWIND_OP_REMOVED) {
+        op->index = (uint32_t)reader_get_varint(reader);
+        op->mask = (1ULL << REWIND_ENTITY_FIELDS) - 1;
+    } else if (op->op == REWIND_OP_CHANGED) {
+        op->mask = reader_get_varint(reader);
+    } else {
+        op->mask = 0;
+    }
+    for (int i = 0; i < REWIND_ENTITY_FIELDS; i++) {
+        if (op->mask & (1ULL << i)) {
+            op->fields[i] = reader_get_svarint(reader);
+        }
+    }
+    return !reader->error;
+}
+
+// The entity is the first member of both Hunter and Star nodes.
+static void** list_head(Game* game, const collision_t kind) {
+    return kind == HUNTER ? (void**)&game->entities.hunters : (void**)&game->entities.stars;
+}
+
+static void** next_link(void* node, const collision_t kind) {
+    const size_t offset = kind == HUNTER ? offsetof(Hunter, next) : offsetof(Star, next);
+    return (void**)((char*)node + offset);
+}
+
+static void** find_link(Game* game, const collision_t kind, const uint32_t id) {
+    void** link = list_head(game, kind);
+    while (*link && ((entity_t*)*link)->id != id) {
+        link = next_link(*link, kind);
+    }
+    return link;
+}
+
+static void undo_spawn(Game* game, const RewindOp* op) {
+    void** link = find_link(game, op->kind, op->id);
+    void* node = *link;
+    if (node) {
+        *link = *next_link(node, op->kind);
+        mem_free(node);
+    }
+}
+
+static void undo_removal(Game* game, const RewindOp* op) {
+    void* node = NULL;
+    if (op->kind == HUNTER && op->fields[12] >= 0 &&
+        op->fields[12] < game->config.hunter_templates_amount) {
+        node = init_hunter_data(game, (int)op->fields[12]);
+        restore_hunter(node, op->fields);
+    } else if (op->kind == STAR) {
+        node = init_star_data();
+        restore_entity(node, op->fields);
+    }
+    if (!node) {
+        return;
+    }
+    ((entity_t*)node)->id = op->id;
+
+    void** link = list_head(game, op->kind);
+    for (uint32_t i = 0; i < op->index && *link; i++) {
+        link = next_link(*link, op->kind);
+    }
+    *next_link(node, op->kind) = *link;
+    *link = node;
+}
+
+static void undo_change(Game* game, const RewindOp* op) {
+    int64_t fields[REWIND_ENTITY_FIELDS] = {0};
+    entity_t* ent = NULL;
+    if (op->kind == SWALLOW) {
+        ent = &game->entities.swallow->ent;
+    } else {
+        ent = *find_link(game, op->kind, op->id);
+    }
+    if (!ent) {
+        return;
+    }
+
+    if (op->kind == HUNTER) {
+        flatten_hunter((Hunter*)ent, fields);
+    } else {
+        flatten_entity(ent, fields);
+    }
+    for (int i = 0; i < REWIND_ENTITY_FIELDS; i++) {
+        if (op->mask & (1ULL << i)) {
+            fields[i] = op->fields[i];
+        }
+    }
+    if (op->kind == HUNTER) {
+        restore_hunter((Hunter*)ent, fields);
+    } else {
+        restore_entity(ent, fields);
+    }
+}
+
+static void apply_ops(Game* game, const ByteReader* start, const RewindOpKind pass) {
+    ByteReader reader = *start;
+    RewindOp op = {0};
+    const int cols = game->occupancy_map.cols;
+
+    while (read_op(&reader, &op)) {
+        if (op.op != pass && !(pass == REWIND_OP_CHANGED && op.op == REWIND_OP_CELL)) {
+            continue;
+        }
+        if (op.op == REWIND_OP_SPAWNED) {
+            undo_spawn(game, &op);
+        } else if (op.op == REWIND_OP_REMOVED) {
+            undo_removal(game, &op);
+        } else if (op.op == REWIND_OP_CHANGED) {
+            undo_change(game, &op);
+        } else if (op.cell < (uint64_t)game->occupancy_map.rows * (uint64_t)cols) {
+            occupancy_set(&game->occupancy_map, (int)(op.cell % (uint64_t)cols),
+                          (int)(op.cell / (uint64_t)cols), op.value);
+        }
+    }
+}
+
+/**
+ * undo_record - steps the game back over one captured tick
+ * @game: Main game struct
+ * @rec: undo record of the newest captured tick
+ *
+ * Spawned nodes are unlinked before removed ones are reinserted, so the old
+ * list indices line up; field and cell values are restored last.
+ *
+ * RETURNS
+ * Void.
+ */
+static void undo_record(Game* game, const ByteBuffer* rec) {
+    ByteReader reader = {rec->data, rec->len, 0, 0};
+    uint64_t counters[REWIND_COUNTERS];
+    read_counters(game, counters);
+
+    const uint64_t mask = reader_get_varint(&reader);
+    for (int i = 0; i < REWIND_COUNTERS; i++) {
+        if (mask & (1ULL << i)) {
+            counters[i] = reader_get_varint(&reader);
+        }
+    }
+    write_counters(game, counters);
+
+    apply_ops(game, &reader, REWIND_OP_SPAWNED);
+    apply_ops(game, &reader, REWIND_OP_REMOVED);
+    apply_ops(game, &reader, REWIND_OP_CHANGED);
+}
+
+/**
+ * rewind_step - rewinds the live game
+ * @game: Main game struct
+ * @ticks: maximum number of ticks to step back
+ *
+ * Undoes the newest records, then resynchronises the shadow copies so
+ * capturing continues from the restored state.
+ *
+ * RETURNS
+ * The number of ticks actually undone.
+ */
+int rewind_step(Game* game, const int ticks) {
+    Rewind* rw = &game->rewind;
+    int undone = 0;
+
+    while (undone < ticks && rw->count > 0) {
+        rw->head = (rw->head - 1 + REWIND_HISTORY_TICKS) % REWIND_HISTORY_TICKS;
+        ByteBuffer* rec = &rw->records[rw->head];
+        undo_record(game, rec);
+        rw->bytes -= rec->len;
+        rec->len = 0;
+        rw->count--;
+        undone++;
+    }
+
+    if (undone > 0) {
+        sync_shadow(game);
+    }
+    return undone;
+}
+
+void rewind_free(Rewind* rw) {
+    if (rw->records) {
+        for (int i = 0; i < REWIND_HISTORY_TICKS; i++) {
+            buffer_free(&rw->records[i]);
+        }
+    }
+    mem_free(rw->records);
+    mem_free(rw->shadow);
+    mem_free(rw->current);
+    occupancy_free(&rw->map);
+    memset(rw, 0, sizeof(*rw));
+}
@@ -0,0 +1,11 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "types.h"
+
+void rewind_reset(Game* game);
+void rewind_capture(Game* game);
+int rewind_step(Game* game, int ticks);
+void rewind_free(Rewind* rw);
+
+#endif  // REWIND_H
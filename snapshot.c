@@ -0,0 +1,324 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "hunter.h"
+#include "physics.h"
+#include "snapshot.h"
+#include "star.h"
+#include "types.h"
+
+/*
+ * A snapshot is the complete simulation state: counters, the taxi flight,
+ * RNG, the entity lists in list order (which decides processing order) and
+ * the occupancy map run-length encoded. Sprite pointers are not stored; hunters are rebuilt
+ * from their template index and stars and the swallow keep their static
+ * sprites.
+ */
+
+static uint32_t float_to_bits(const float value) {
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float bits_to_float(const uint32_t bits) {
+    float value = 0;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void put_entity(ByteBuffer* buf, const entity_t* ent) {
+    buffer_put_svarint(buf, ent->x);
+    buffer_put_svarint(buf, ent->y);
+    buffer_put_svarint(buf, ent->dx);
+    buffer_put_svarint(buf, ent->dy);
+    buffer_put_svarint(buf, ent->speed);
+    buffer_put_varint(buf, (uint64_t)ent->width);
+    buffer_put_varint(buf, (uint64_t)ent->height);
+    buffer_put_varint(buf, (uint64_t)ent->anim_frame);
+    buffer_put_varint(buf, (uint64_t)ent->anim_timer);
+    buffer_put_varint(buf, ent->direction);
+    buffer_put_varint(buf, ent->color);
+    buffer_put_u64(buf, ent->hash);
+}
+
+/**
+ * get_entity - reads an entity over one already set up from its template
+ * @reader: snapshot being read
+ * @ent: entity to fill in
+ *
+ * The size must match the template's, since the sprites drawn for the
+ * entity come from there.
+ *
+ * RETURNS
+ * Void.
+ */
+static void get_entity(ByteReader* reader, entity_t* ent) {
+    ent->x = (int)reader_get_svarint(reader);
+    ent->y = (int)reader_get_svarint(reader);
+    ent->dx = (int)reader_get_svarint(reader);
+    ent->dy = (int)reader_get_svarint(reader);
+    ent->speed = (int)reader_get_svarint(reader);
+    if (reader_get_varint(reader) != (uint64_t)ent->width ||
+        reader_get_varint(reader) != (uint64_t)ent->height) {
+        reader->error = 1;
+    }
+    ent->anim_frame = (int)reader_get_varint(reader);
+    ent->anim_timer = (int)reader_get_varint(reader);
+    ent->direction = (direction_t)(reader_get_varint(reader) % NUM_DIRECTIONS);
+    ent->color = (ColorPair)reader_get_varint(reader);
+    ent->hash = reader_get_u64(reader);
+}
+
+static void put_counters(ByteBuffer* buf, const Game* game) {
+    buffer_put_varint(buf, float_to_bits(game->time_left));
+    buffer_put_varint(buf, float_to_bits(game->albatross_cooldown));
+    buffer_put_svarint(buf, game->game_speed);
+    buffer_put_svarint(buf, game->stars_collected);
+    buffer_put_svarint(buf, game->hunter_spawn_tick);
+    buffer_put_svarint(buf, game->star_spawn_tick);
+    buffer_put_svarint(buf, game->star_move_tick);
+    buffer_put_svarint(buf, game->star_flicker_tick);
+    buffer_put_svarint(buf, game->score);
+    buffer_put_varint(buf, (uint64_t)game->result);
+    buffer_put_varint(buf, (uint64_t)game->running);
+    buffer_put_u64(buf, game->rng_state);
+    buffer_put_u64(buf, game->state_hash);
+}
+
+static void put_taxi(ByteBuffer* buf, const AlbatrossTaxi* taxi) {
+    buffer_put_varint(buf, (uint64_t)taxi->active);
+    buffer_put_svarint(buf, taxi->frame);
+    buffer_put_svarint(buf, taxi->from_x);
+    buffer_put_svarint(buf, taxi->from_y);
+    buffer_put_svarint(buf, taxi->to_x);
+    buffer_put_svarint(buf, taxi->to_y);
+}
+
+static void get_counters(ByteReader* reader, Game* game) {
+    game->time_left = bits_to_float((uint32_t)reader_get_varint(reader));
+    game->albatross_cooldown = bits_to_float((uint32_t)reader_get_varint(reader));
+    game->game_speed = (int)reader_get_svarint(reader);
+    game->stars_collected = (int)reader_get_svarint(reader);
+    game->hunter_spawn_tick = (int)reader_get_svarint(reader);
+    game->star_spawn_tick = (int)reader_get_svarint(reader);
+    game->star_move_tick = (int)reader_get_svarint(reader);
+    game->star_flicker_tick = (int)reader_get_svarint(reader);
+    game->score = (int)reader_get_svarint(reader);
+    game->result = (char)reader_get_varint(reader);
+    game->running = (char)reader_get_varint(reader);
+    game->rng_state = reader_get_u64(reader);
+    game->state_hash = reader_get_u64(reader);
+}
+
+static void get_taxi(ByteReader* reader, AlbatrossTaxi* taxi) {
+    taxi->active = (char)reader_get_varint(reader);
+    taxi->frame = (int)reader_get_svarint(reader);
+    taxi->from_x = (int)reader_get_svarint(reader);
+    taxi->from_y = (int)reader_get_svarint(reader);
+    taxi->to_x = (int)reader_get_svarint(reader);
+    taxi->to_y = (int)reader_get_svarint(reader);
+}
+
+static void put_hunters(ByteBuffer* buf, const Hunter* hunters) {
+    uint64_t count = 0;
+    for (const Hunter* h = hunters; h; h = h->next) {
+        count++;
+    }
+    buffer_put_varint(buf, count);
+
+    for (const Hunter* h = hunters; h; h = h->next) {
+        buffer_put_varint(buf, (uint64_t)h->template_idx);
+        buffer_put_svarint(buf, h->bounces);
+        buffer_put_svarint(buf, h->damage);
+        buffer_put_varint(buf, h->state);
+        buffer_put_svarint(buf, h->state_timer);
+        buffer_put_svarint(buf, h->base_speed);
+        buffer_put_svarint(buf, h->dash_cooldown);
+        put_entity(buf, &h->ent);
+    }
+}
+
+static void put_stars(ByteBuffer* buf, const Star* stars) {
+    uint64_t count = 0;
+    for (const Star* s = stars; s; s = s->next) {
+        count++;
+    }
+    buffer_put_varint(buf, count);
+
+    for (const Star* s = stars; s; s = s->next) {
+        put_entity(buf, &s->ent);
+    }
+}
+
+static void put_chunk(ByteBuffer* buf, const OccupancyChunk* chunk) {
+    uint64_t run = 0;
+    char value = chunk->cells[0];
+    for (int i = 0; i < OCCUPANCY_CHUNK_CELLS; i++) {
+        if (chunk->cells[i] != value) {
+            buffer_put_varint(buf, run);
+            buffer_put_u8(buf, (unsigned char)value);
+            value = chunk->cells[i];
+            run = 0;
+        }
+        run++;
+    }
+    buffer_put_varint(buf, run);
+    buffer_put_u8(buf, (unsigned char)value);
+}
+
+/**
+ * put_occupancy - run-length encodes the allocated chunks of the occupancy map
+ * @buf: output buffer
+ * @game: Main game struct
+ *
+ * Missing chunks are EMPTY and the border WALL is implicit, so only the
+ * chunks entities are in are stored, each as (run length, value) pairs.
+ *
+ * RETURNS
+ * Void.
+ */
+static void put_occupancy(ByteBuffer* buf, const Game* game) {
+    const OccupancyMap* map = &game->occupancy_map;
+    const int chunks = map->chunk_rows * map->chunk_cols;
+    uint64_t count = 0;
+
+    buffer_put_varint(buf, (uint64_t)map->rows);
+    buffer_put_varint(buf, (uint64_t)map->cols);
+    for (int i = 0; i < chunks; i++) {
+        count += map->chunks[i] != NULL;
+    }
+    buffer_put_varint(buf, count);
+    for (int i = 0; i < chunks; i++) {
+        if (map->chunks[i]) {
+            buffer_put_varint(buf, (uint64_t)i);
+            put_chunk(buf, map->chunks[i]);
+        }
+    }
+}
+
+static void get_chunk(ByteReader* reader, OccupancyMap* map, const int index) {
+    const int base_x = (index % map->chunk_cols) << OCCUPANCY_CHUNK_SHIFT;
+    const int base_y = (index / map->chunk_cols) << OCCUPANCY_CHUNK_SHIFT;
+    int done = 0;
+
+    while (done < OCCUPANCY_CHUNK_CELLS && !reader->error) {
+        const uint64_t run = reader_get_varint(reader);
+        const char value = (char)reader_get_u8(reader);
+        for (uint64_t i = 0; i < run && done < OCCUPANCY_CHUNK_CELLS; i++, done++) {
+            occupancy_set(map, base_x + (done & (OCCUPANCY_CHUNK_SIZE - 1)),
+                          base_y + (done >> OCCUPANCY_CHUNK_SHIFT), value);
+        }
+    }
+}
+
+static void get_occupancy(ByteReader* reader, Game* game) {
+    OccupancyMap* map = &game->occupancy_map;
+    if ((int)reader_get_varint(reader) != map->rows ||
+        (int)reader_get_varint(reader) != map->cols) {
+        reader->error = 1;
+        return;
+    }
+
+    occupancy_clear(map);
+    const uint64_t count = reader_get_varint(reader);
+    const uint64_t chunks = (uint64_t)map->chunk_rows * (uint64_t)map->chunk_cols;
+    for (uint64_t i = 0; i < count && !reader->error; i++) {
+        const uint64_t index = reader_get_varint(reader);
+        if (index >= chunks) {
+            reader->error = 1;
+            return;
+        }
+        get_chunk(reader, map, (int)index);
+    }
+}
+
+/**
+ * snapshot_write - serializes the full simulation state
+ * @game: Main game struct
+ * @buf: buffer the snapshot is appended to
+ *
+ * RETURNS
+ * Void.
+ */
+void snapshot_write(const Game* game, ByteBuffer* buf) {
+    put_counters(buf, game);
+    put_taxi(buf, &game->taxi);
+    buffer_put_svarint(buf, game->entities.swallow->hp);
+    put_entity(buf, &game->entities.swallow->ent);
+    put_hunters(buf, game->entities.hunters);
+    put_stars(buf, game->entities.stars);
+    put_occupancy(buf, game);
+}
+
+static void get_hunters(ByteReader* reader, Game* game) {
+    const uint64_t count = reader_get_varint(reader);
+    Hunter** tail = &game->entities.hunters;
+
+    for (uint64_t i = 0; i < count && !reader->error; i++) {
+        const uint64_t template_idx = reader_get_varint(reader);
+        if (game->config.hunter_templates_amount <= 0 ||
+            template_idx >= (uint64_t)game->config.hunter_templates_amount) {
+            reader->error = 1;
+            return;
+        }
+        Hunter* h = init_hunter_data(game, (int)template_idx);
+        if (!h) {
+            reader->error = 1;
+            return;
+        }
+        h->bounces = (int)reader_get_svarint(reader);
+        h->damage = (int)reader_get_svarint(reader);
+        h->state = (HunterState)reader_get_varint(reader);
+        h->state_timer = (int)reader_get_svarint(reader);
+        h->base_speed = (int)reader_get_svarint(reader);
+        h->dash_cooldown = (int)reader_get_svarint(reader);
+        get_entity(reader, &h->ent);
+        *tail = h;
+        tail = &h->next;
+    }
+}
+
+static void get_stars(ByteReader* reader, Game* game) {
+    const uint64_t count = reader_get_varint(reader);
+    Star** tail = &game->entities.stars;
+
+    for (uint64_t i = 0; i < count && !reader->error; i++) {
+        Star* s = init_star_data();
+        if (!s) {
+            reader->error = 1;
+            return;
+        }
+        get_entity(reader, &s->ent);
+        *tail = s;
+        tail = &s->next;
+    }
+}
+
+/**
+ * snapshot_restore - replaces the simulation state with a snapshot
+ * @game: Main game struct (config, windows and swallow must be set up)
+ * @data: snapshot bytes
+ * @size: number of bytes in @data
+ *
+ * RETURNS
+ * 0 on success, -1 if the snapshot is truncated or does not fit the level.
+ */
+int snapshot_restore(Game* game, const unsigned char* data, const size_t size) {
+    ByteReader reader = {data, size, 0, 0};
+
+    free_hunters(game);
+    free_stars(game);
+
+    get_counters(&reader, game);
+    get_taxi(&reader, &game->taxi);
+    game->entities.swallow->hp = (int)reader_get_svarint(&reader);
+    get_entity(&reader, &game->entities.swallow->ent);
+    get_hunters(&reader, game);
+    get_stars(&reader, game);
+    get_occupancy(&reader, game);
+
+    return reader.error ? -1 : 0;
+}
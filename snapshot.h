@@ -0,0 +1,9 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "types.h"
+
+void snapshot_write(const Game* game, ByteBuffer* buf);
+int snapshot_restore(Game* game, const unsigned char* data, size_t size);
+
+#endif  // SNAPSHOT_H
@@ -0,0 +1,524 @@
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "drawlist.h"
+#include "graphics.h"
+#include "spectator.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * The spectator client follows a broadcasting game through the shared ring
+ * (see broadcast.c). It starts at the latest keyframe, applies every record
+ * after it and draws with the same frame drawing the game uses. If the game
+ * laps it, it starts over from the newest keyframe.
+ */
+
+static float bits_float(const uint64_t bits) {
+    const uint32_t narrow = (uint32_t)bits;
+    float value = 0;
+    memcpy(&value, &narrow, sizeof(value));
+    return value;
+}
+
+static const SpectateRing* open_ring(const char* name, ino_t* ino) {
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SpectateRing)) {
+        close(fd);
+        return NULL;
+    }
+    void* mem = mmap(NULL, sizeof(SpectateRing), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return NULL;
+    }
+
+    const SpectateRing* ring = (const SpectateRing*)mem;
+    if (memcmp(ring->magic, SPECTATE_MAGIC, sizeof(ring->magic)) != 0 ||
+        ring->version != SPECTATE_VERSION) {
+        munmap(mem, sizeof(SpectateRing));
+        return NULL;
+    }
+    *ino = st.st_ino;
+    return ring;
+}
+
+static int owner_alive(const SpectateRing* ring) {
+    return kill(ring->pid, 0) == 0 || errno == EPERM;
+}
+
+static int filter_pid(const char* filter) {
+    char* end = NULL;
+    const long pid = filter && *filter ? strtol(filter, &end, 10) : 0;
+    return end && *end == '\0' && pid > 0 ? (int)pid : 0;
+}
+
+/**
+ * add_broadcast - Lists a ring if its game is still running and matches
+ * @name: shared-memory name of the ring
+ * @filter: pid or player name to match, NULL for any
+ * @found: list of broadcasts
+ * @count: entries in @found, updated
+ *
+ * RETURNS
+ * Void.
+ */
+static void add_broadcast(const char* name, const char* filter, BroadcastInfo* found,
+                          int* count) {
+    ino_t ino = 0;
+    const SpectateRing* ring = *count < SPECTATE_MAX_BROADCASTS ? open_ring(name, &ino) : NULL;
+    if (ring == NULL) {
+        return;
+    }
+    const int pid = filter_pid(filter);
+    const int matches = filter == NULL || (pid ? ring->pid == pid
+                                               : strncmp(ring->username, filter,
+                                                         MAX_USERNAME_LENGTH) == 0);
+    if (matches && owner_alive(ring)) {
+        BroadcastInfo* info = &found[(*count)++];
+        snprintf(info->name, sizeof(info->name), "%s", name);
+        info->pid = ring->pid;
+        info->uid = ring->uid;
+        memcpy(info->username, ring->username, MAX_USERNAME_LENGTH);
+        info->username[MAX_USERNAME_LENGTH - 1] = '\0';
+        info->live = (char)atomic_load_explicit(&ring->live, memory_order_acquire);
+    }
+    munmap((void*)ring, sizeof(SpectateRing));
+}
+
+/**
+ * find_broadcasts - Lists the games being broadcast on this host
+ * @filter: pid or player name to match, NULL for any
+ * @found: receives up to SPECTATE_MAX_BROADCASTS broadcasts
+ *
+ * Shared-memory names can only be listed where they live in
+ * SPECTATE_SHM_DIR; elsewhere a broadcast has to be asked for by pid.
+ * Rings left behind by crashed games are skipped.
+ *
+ * RETURNS
+ * Number of broadcasts found.
+ */
+static int find_broadcasts(const char* filter, BroadcastInfo* found) {
+    const char* prefix = SPECTATE_SHM_PREFIX + 1;
+    char name[SPECTATE_NAME_LENGTH];
+    int count = 0;
+
+    DIR* dir = opendir(SPECTATE_SHM_DIR);
+    const struct dirent* entry = NULL;
+    while (dir && (entry = readdir(dir))) {
+        const size_t len = strlen(entry->d_name);
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) == 0 && len < sizeof(name) - 1) {
+            name[0] = '/';
+            memcpy(name + 1, entry->d_name, len + 1);
+            add_broadcast(name, filter, found, &count);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+    if (count == 0 && filter_pid(filter)) {
+        snprintf(name, sizeof(name), "%s%d", SPECTATE_SHM_PREFIX, filter_pid(filter));
+        add_broadcast(name, filter, found, &count);
+    }
+    return count;
+}
+
+/**
+ * reopen_ring - Switches to a live broadcast, if there is one
+ * @ring: ring currently followed, or NULL
+ * @ino: identity of @ring, updated on a switch
+ * @view: spectator state
+ * @filter: pid or player name to follow, NULL for any
+ *
+ * RETURNS
+ * The ring to follow from now on.
+ */
+static const SpectateRing* reopen_ring(const SpectateRing* ring, ino_t* ino, Spectator* view,
+                                       const char* filter) {
+    BroadcastInfo found[SPECTATE_MAX_BROADCASTS];
+    const int count = find_broadcasts(filter, found);
+    int pick = ring == NULL && count > 0 ? 0 : -1;
+    for (int i = 0; i < count; i++) {
+        if (found[i].live) {
+            pick = i;
+            break;
+        }
+    }
+
+    ino_t fresh_ino = 0;
+    const SpectateRing* fresh = pick >= 0 ? open_ring(found[pick].name, &fresh_ino) : NULL;
+    if (fresh == NULL) {
+        return ring;
+    }
+    if (ring && fresh_ino == *ino) {
+        munmap((void*)fresh, sizeof(SpectateRing));
+        return ring;
+    }
+    if (ring) {
+        munmap((void*)ring, sizeof(SpectateRing));
+    }
+    *ino = fresh_ino;
+    view->synced = 0;
+    return fresh;
+}
+
+/**
+ * run_broadcast_list - Prints the games being broadcast on this host
+ *
+ * RETURNS
+ * The process exit status: 0 if any game is broadcast, 1 otherwise.
+ */
+int run_broadcast_list(void) {
+    BroadcastInfo found[SPECTATE_MAX_BROADCASTS];
+    const int count = find_broadcasts(NULL, found);
+
+    for (int i = 0; i < count; i++) {
+        const struct passwd* pw = getpwuid(found[i].uid);
+        printf("%-8d %-12s %-24s %s\n", (int)found[i].pid, pw ? pw->pw_name : "?",
+               found[i].username[0] ? found[i].username : "-",
+               found[i].live ? "playing" : "in menu");
+    }
+    if (count == 0) {
+        fprintf(stderr, "no games are being broadcast\n");
+    }
+    return count > 0 ? 0 : 1;
+}
+
+static SpectatorEntity* find_entity(Spectator* view, const uint32_t id) {
+    for (int i = 0; i < view->count; i++) {
+        if (view->entities[i].id == id) {
+            return &view->entities[i];
+        }
+    }
+    return NULL;
+}
+
+static SpectatorEntity* add_entity(Spectator* view, const uint32_t id) {
+    if (view->count == view->capacity) {
+        const int capacity = view->capacity ? view->capacity * 2 : SPECTATE_INITIAL_ENTITIES;
+        SpectatorEntity* entities =
+                realloc(view->entities, sizeof(SpectatorEntity) * (size_t)capacity);
+        if (!entities) {
+            exit(1);
+        }
+        view->entities = entities;
+        view->capacity = capacity;
+    }
+    SpectatorEntity* ent = &view->entities[view->count++];
+    memset(ent, 0, sizeof(*ent));
+    ent->id = id;
+    return ent;
+}
+
+static int remove_entity_id(Spectator* view, const uint32_t id) {
+    SpectatorEntity* ent = find_entity(view, id);
+    if (ent == NULL) {
+        return -1;
+    }
+    free(ent->text);
+    *ent = view->entities[--view->count];
+    return 0;
+}
+
+static void clear_entities(Spectator* view) {
+    for (int i = 0; i < view->count; i++) {
+        free(view->entities[i].text);
+    }
+    view->count = 0;
+}
+
+static void read_look(ByteReader* reader, SpectatorEntity* ent) {
+    const uint64_t width = reader_get_varint(reader);
+    const uint64_t height = reader_get_varint(reader);
+    const ColorPair color = (ColorPair)reader_get_varint(reader);
+    if (width == 0 || height == 0 || width > SPECTATE_MAX_RECORD || height > SPECTATE_MAX_RECORD) {
+        reader->error = 1;
+        return;
+    }
+    const size_t size = (size_t)(width * height);
+    const unsigned char* text = reader_get_bytes(reader, size);
+    if (text == NULL) {
+        return;
+    }
+
+    if (size > ent->text_cap) {
+        char* grown = realloc(ent->text, size);
+        if (!grown) {
+            exit(1);
+        }
+        ent->text = grown;
+        ent->text_cap = size;
+    }
+    memcpy(ent->text, text, size);
+    ent->sprite.width = (int)width;
+    ent->sprite.height = (int)height;
+    ent->sprite.color = color;
+    ent->sprite.sprite = ent->text;
+}
+
+static void apply_reset(Spectator* view, ByteReader* reader) {
+    clear_entities(view);
+    view->window_width = (int)reader_get_varint(reader);
+    view->window_height = (int)reader_get_varint(reader);
+    view->level_nr = (int)reader_get_varint(reader);
+    view->star_quota = (int)reader_get_varint(reader);
+    view->practice = (char)reader_get_varint(reader);
+
+    const size_t len = (size_t)reader_get_varint(reader);
+    const unsigned char* name = reader_get_bytes(reader, len);
+    const size_t kept = len < MAX_USERNAME_LENGTH - 1 ? len : MAX_USERNAME_LENGTH - 1;
+    if (name) {
+        memcpy(view->username, name, kept);
+        view->username[kept] = '\0';
+    }
+}
+
+static void apply_status(Spectator* view, ByteReader* reader) {
+    const uint64_t mask = reader_get_varint(reader);
+    for (int i = 0; i < SPECTATE_STATUS_FIELDS; i++) {
+        if (mask & (1ULL << i)) {
+            view->status[i] = reader_get_varint(reader);
+        }
+    }
+}
+
+static void apply_op(Spectator* view, ByteReader* reader, const SpectateOp op) {
+    if (op == SPECTATE_OP_RESET) {
+        apply_reset(view, reader);
+        return;
+    }
+    if (op == SPECTATE_OP_STATUS) {
+        apply_status(view, reader);
+        return;
+    }
+
+    const uint32_t id = (uint32_t)reader_get_varint(reader);
+    SpectatorEntity* ent = find_entity(view, id);
+    if (op == SPECTATE_OP_SPAWN) {
+        ent = ent ? ent : add_entity(view, id);
+        ent->sprite.layer = (int)reader_get_varint(reader);
+        ent->sprite.x = (int)reader_get_svarint(reader);
+        ent->sprite.y = (int)reader_get_svarint(reader);
+        read_look(reader, ent);
+    } else if (op == SPECTATE_OP_MOVE && ent) {
+        ent->sprite.x = (int)reader_get_svarint(reader);
+        ent->sprite.y = (int)reader_get_svarint(reader);
+    } else if (op == SPECTATE_OP_LOOK && ent) {
+        read_look(reader, ent);
+    } else if (op != SPECTATE_OP_REMOVE || remove_entity_id(view, id) != 0) {
+        reader->error = 1;
+    }
+}
+
+static int apply_record(Spectator* view, const unsigned char* data, const size_t len) {
+    ByteReader reader = {data, len, 0, 0};
+
+    while (!reader.error) {
+        const SpectateOp op = (SpectateOp)reader_get_u8(&reader);
+        if (op == SPECTATE_OP_END) {
+            break;
+        }
+        apply_op(view, &reader, op);
+    }
+    return reader.error ? -1 : 1;
+}
+
+static void copy_out(const SpectateRing* ring, const uint64_t pos, unsigned char* out,
+                     const size_t len) {
+    const size_t offset = (size_t)(pos % SPECTATE_RING_BYTES);
+    const size_t first = len < SPECTATE_RING_BYTES - offset ? len : SPECTATE_RING_BYTES - offset;
+    memcpy(out, ring->data + offset, first);
+    memcpy(out + first, ring->data, len - first);
+}
+
+/**
+ * read_record - Copies the next record out of the ring and applies it
+ * @ring: the shared ring
+ * @view: spectator state
+ * @committed: ring position up to which records are complete
+ *
+ * RETURNS
+ * 1 if a record was applied, -1 if it was overwritten while being copied or
+ * does not parse, in which case the view has to start over from a keyframe.
+ */
+static int read_record(const SpectateRing* ring, Spectator* view, const uint64_t committed) {
+    const uint64_t start = view->read_pos;
+    unsigned char header[sizeof(uint32_t)];
+
+    copy_out(ring, start, header, sizeof(header));
+    const uint32_t len = (uint32_t)header[0] | ((uint32_t)header[1] << 8) |
+                         ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+    if (len > SPECTATE_MAX_RECORD || start + sizeof(header) + len > committed) {
+        return -1;
+    }
+    view->record.len = 0;
+    buffer_reserve(&view->record, len);
+    copy_out(ring, start + sizeof(header), view->record.data, len);
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&ring->reserved, memory_order_relaxed) - start >
+        SPECTATE_RING_BYTES) {
+        return -1;
+    }
+    view->read_pos = start + sizeof(header) + len;
+    return apply_record(view, view->record.data, len);
+}
+
+static int drain_ring(const SpectateRing* ring, Spectator* view) {
+    int changed = 0;
+
+    while (1) {
+        const uint64_t committed = atomic_load_explicit(&ring->committed, memory_order_acquire);
+        if (committed == 0) {
+            return changed;
+        }
+        if (!view->synced || committed - view->read_pos > SPECTATE_RING_BYTES) {
+            view->read_pos = atomic_load_explicit(&ring->keyframe, memory_order_acquire);
+            view->synced = 1;
+            continue;
+        }
+        if (view->read_pos == committed) {
+            return changed;
+        }
+        if (read_record(ring, view, committed) < 0) {
+            view->synced = 0;
+            return changed;
+        }
+        changed = 1;
+    }
+}
+
+static void build_frame(Spectator* view) {
+    Frame* frame = &view->frame;
+
+    if (view->count > frame->sprite_capacity) {
+        FrameSprite* sprites = realloc(frame->sprites, sizeof(FrameSprite) * (size_t)view->count);
+        if (!sprites) {
+            exit(1);
+        }
+        frame->sprites = sprites;
+        frame->sprite_capacity = view->count;
+    }
+    frame->sprite_count = 0;
+    for (int i = 0; i < view->count; i++) {
+        FrameSprite sprite = view->entities[i].sprite;
+        sprite.x -= (int)view->status[SPECTATE_CAMERA_X];
+        sprite.y -= (int)view->status[SPECTATE_CAMERA_Y];
+        if (sprite_visible(&sprite, &view->main_win)) {
+            frame->sprites[frame->sprite_count++] = sprite;
+        }
+    }
+}
+
+static void build_status(const Spectator* view, Frame* frame) {
+    frame->username = view->username;
+    frame->level_nr = view->level_nr;
+    frame->star_quota = view->star_quota;
+    frame->practice = view->practice;
+    frame->hp = (int)view->status[SPECTATE_HP];
+    frame->stars_collected = (int)view->status[SPECTATE_STARS];
+    frame->game_speed = (int)view->status[SPECTATE_SPEED];
+    frame->score = (int)view->status[SPECTATE_SCORE];
+    frame->time_left = bits_float(view->status[SPECTATE_TIME_LEFT]);
+    frame->albatross_cooldown = bits_float(view->status[SPECTATE_COOLDOWN]);
+    frame->rewind_seconds = bits_float(view->status[SPECTATE_REWIND_SECONDS]);
+}
+
+static void close_windows(Spectator* view) {
+    if (view->main_win.window) {
+        delwin(view->main_win.window);
+        delwin(view->status_win.window);
+        view->main_win.window = NULL;
+        view->status_win.window = NULL;
+    }
+}
+
+static void show_view(Spectator* view, const int live) {
+    if (view->main_win.window == NULL || view->main_win.cols != view->window_width ||
+        view->main_win.rows + view->status_win.rows != view->window_height) {
+        close_windows(view);
+        erase();
+        refresh();
+        conf_t config = {0};
+        config.window_width = view->window_width;
+        config.window_height = view->window_height;
+        setup_windows(&view->main_win, &view->status_win, &config);
+    }
+
+    build_frame(view);
+    build_status(view, &view->frame);
+    draw_frame(&view->main_win, &view->status_win, &view->frame, &view->draw_list);
+    if (!live) {
+        mvwprintw(view->main_win.window, 0, 2, " Waiting for the next game - [q] quit ");
+        wrefresh(view->main_win.window);
+    }
+}
+
+static void free_spectator(Spectator* view, const SpectateRing* ring) {
+    clear_entities(view);
+    free(view->entities);
+    free(view->frame.sprites);
+    draw_list_free(&view->draw_list);
+    buffer_free(&view->record);
+    close_windows(view);
+    if (ring) {
+        munmap((void*)ring, sizeof(SpectateRing));
+    }
+}
+
+/**
+ * run_spectator - Watches games broadcast by another swallow process
+ * @filter: pid or player name to follow, NULL for any broadcast
+ *
+ * Runs until 'q' is pressed. Waits for a matching broadcast to appear, and
+ * picks up the next game (or the next game process) when one ends.
+ *
+ * RETURNS
+ * Void.
+ */
+void run_spectator(const char* filter) {
+    Spectator view = {.record.tag = MEM_BROADCAST};
+    const SpectateRing* ring = NULL;
+    ino_t ring_ino = 0;
+    uint64_t last_open = 0;
+    int shown_live = -1;
+
+    erase();
+    mvprintw(1, 2, "Waiting for a game started with --broadcast - [q] quit");
+    refresh();
+
+    while (tolower(read_key()) != 'q') {
+        const uint64_t now = monotonic_us();
+        const int idle = ring == NULL || !atomic_load(&ring->live) || !owner_alive(ring);
+        if (idle && now - last_open >= SPECTATE_REOPEN_US) {
+            ring = reopen_ring(ring, &ring_ino, &view, filter);
+            last_open = now;
+        }
+
+        const int changed = ring ? drain_ring(ring, &view) : 0;
+        const int live = ring && atomic_load_explicit(&ring->live, memory_order_acquire);
+        if ((changed || live != shown_live) && view.window_width > 0) {
+            show_view(&view, live);
+            shown_live = live;
+        }
+        usleep(SPECTATE_POLL_US);
+    }
+    free_spectator(&view, ring);
+}
@@ -0,0 +1,7 @@
+#ifndef SPECTATOR_H
+#define SPECTATOR_H
+
+void run_spectator(const char* filter);
+int run_broadcast_list(void);
+
+#endif  // SPECTATOR_H
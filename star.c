@@ -2,8 +2,10 @@
 #include <stdlib.h>
 
 #include "entity.h"
+#include "mem.h"
 #include "physics.h"
 #include "types.h"
+#include "utils.h"
 
 Star* remove_star(Game* game, Star* current, Star* prev) {
     return (Star*)remove_generic_node(game, (void**)&game->entities.stars, current, prev,
@@ -15,6 +17,11 @@ void collect_stars(Game* game) {
     Star* prev = NULL;
     Swallow* swallow = game->entities.swallow;
 
+    // A swallow riding the taxi is not in the arena.
+    if (game->taxi.active) {
+        return;
+    }
+
     while (current != NULL) {
         if (is_touching(&current->ent, &swallow->ent)) {
             game->stars_collected++;
@@ -27,26 +34,23 @@ void collect_stars(Game* game) {
 }
 
 static void update_star_color(Game* game, Star* star) {
-    const int y = star->ent.y;
-    const int height = game->main_win.rows;
+    // Brightest near the top, fading as the star falls.
+    static const ColorPair shades[] = {C_YELLOW_5, C_YELLOW_4, C_YELLOW_3, C_YELLOW_2,
+                                       C_YELLOW_1};
+    const int count = sizeof(shades) / sizeof(shades[0]);
+    const int height = game->arena_rows;
 
     if (height == 0) {
         return;
     }
 
-    const float star_progress = (float)y / (float)height;
-
-    if (star_progress < 0.2F) {
-        star->ent.color = C_YELLOW_5;
-    } else if (star_progress < 0.4F) {
-        star->ent.color = C_YELLOW_4;
-    } else if (star_progress < 0.6F) {
-        star->ent.color = C_YELLOW_3;
-    } else if (star_progress < 0.8F) {
-        star->ent.color = C_YELLOW_2;
-    } else {
-        star->ent.color = C_YELLOW_1;
+    int band = star->ent.y * count / height;
+    if (band < 0) {
+        band = 0;
+    } else if (band >= count) {
+        band = count - 1;
     }
+    star->ent.color = shades[band];
 }
 
 void move_stars(Game* game) {
@@ -85,36 +89,55 @@ void move_stars(Game* game) {
     }
 }
 
-void spawn_star(Game* game) {
-    Star* star = (Star*)malloc(sizeof(Star));
+/**
+ * init_star_data - Allocates a star with its fixed properties set
+ *
+ * Position and speed are left for the caller to fill in.
+ *
+ * RETURNS
+ * Pointer to the new Star, or NULL if malloc fails.
+ */
+Star* init_star_data(void) {
+    Star* star = (Star*)mem_alloc(MEM_ENTITIES, sizeof(Star));
     if (!star) {
-        return;
+        return NULL;
     }
 
     star->ent.width = 1;
     star->ent.height = 1;
     for (int i = 0; i < NUM_DIRECTIONS; i++) {
         star->ent.sprites[i] = "*";
+        star->ent.anim_sprites[i] = NULL;
+    }
+    star->ent.color = C_YELLOW_5;
+    star->ent.anim_frame = 0;
+    star->ent.anim_timer = 0;
+    star->ent.hash = 0;
+    star->ent.id = 0;
+    star->next = NULL;
+
+    return star;
+}
+
+void spawn_star(Game* game) {
+    Star* star = init_star_data();
+    if (!star) {
+        return;
     }
 
-    star->ent.speed = (rand() % STAR_SPEED_MAX) + 1;
+    star->ent.speed = (game_rand(game) % STAR_SPEED_MAX) + 1;
 
-    int max_c = game->main_win.cols - star->ent.width - 2;
+    int max_c = game->arena_cols - star->ent.width - 2;
     if (max_c <= 0) {
         max_c = 1;
     }
 
-    star->ent.x = 2 + (rand() % max_c);
+    star->ent.x = 2 + (game_rand(game) % max_c);
     star->ent.y = 1;
-    star->ent.color = C_YELLOW_5;
-    for (int i = 0; i < NUM_DIRECTIONS; i++) {
-        star->ent.anim_sprites[i] = NULL;
-    }
-    star->ent.anim_frame = 0;
-    star->ent.anim_timer = 0;
 
     change_entity_direction(&star->ent, DIR_DOWN, star->ent.speed);
 
+    star->ent.id = ++game->next_entity_id;
     star->next = game->entities.stars;
     game->entities.stars = star;
 }
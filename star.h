@@ -7,6 +7,7 @@ Star* remove_star(Game* game, Star* current, Star* prev);
 void collect_stars(Game* game);
 void move_stars(Game* game);
 void spawn_star(Game* game);
+Star* init_star_data(void);
 void free_stars(Game* game);
 
 #endif  // STAR_H
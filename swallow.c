@@ -1,13 +1,13 @@
 #include <ncurses.h>
 #include <stdlib.h>
-#include <unistd.h>
 
+#include "checksum.h"
 #include "entity.h"
-#include "graphics.h"
 #include "hunter.h"
 #include "physics.h"
 #include "star.h"
 #include "types.h"
+#include "utils.h"
 
 static void handle_swallow_star(Game* game, Swallow* s) {
     Star* prev = NULL;
@@ -76,19 +76,19 @@ static int is_zone_safe(Game* game, int x, int y, int w, int h) {
     const int check_w = w + (pad * 2);
     const int check_h = h + (pad * 2);
 
-    if (check_x < 2 || check_y < 2 || check_x + check_w >= game->main_win.cols - 2 ||
-        check_y + check_h >= game->main_win.rows - 2) {
+    if (check_x < 2 || check_y < 2 || check_x + check_w >= game->arena_cols - 2 ||
+        check_y + check_h >= game->arena_rows - 2) {
         return 0;
     }
 
-    return check_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols,
-                               check_x, check_y, check_w, check_h) == EMPTY;
+    return check_occupancy_map(&game->occupancy_map, check_x, check_y, check_w, check_h) ==
+           EMPTY;
 }
 
 static void find_safe_zone(Game* game, int* safe_x, int* safe_y, int w, int h) {
     for (int i = 0; i < MAX_SAFE_ZONE_ATTEMPTS; i++) {
-        const int tx = 2 + (rand() % (game->main_win.cols - SAFE_ZONE_PADDING));
-        const int ty = 2 + (rand() % (game->main_win.rows - SAFE_ZONE_PADDING));
+        const int tx = 2 + (game_rand(game) % (game->arena_cols - SAFE_ZONE_PADDING));
+        const int ty = 2 + (game_rand(game) % (game->arena_rows - SAFE_ZONE_PADDING));
         if (is_zone_safe(game, tx, ty, w, h)) {
             *safe_x = tx;
             *safe_y = ty;
@@ -111,57 +111,21 @@ static void init_taxi_sprite(entity_t* taxi, int x, int y) {
             "###";
 }
 
-static void draw_static_scene(Game* game) {
-    draw_main(game);
-    Hunter* hu = game->entities.hunters;
-    while (hu) {
-        draw_sprite(game, &hu->ent);
-        hu = hu->next;
-    }
-    Star* st = game->entities.stars;
-    while (st) {
-        draw_sprite(game, &st->ent);
-        st = st->next;
-    }
-}
-
-static void run_taxi_animation(Game* game, entity_t* taxi, int target_x, int target_y) {
-    float cur_x = (float)taxi->x;
-    float cur_y = (float)taxi->y;
-    const float dx = ((float)target_x - cur_x) / ALBATROSS_TAXI_DURATION;
-    const float dy = ((float)target_y - cur_y) / ALBATROSS_TAXI_DURATION;
-
-    for (int i = 0; i < ALBATROSS_TAXI_FRAMES; i++) {
-        remove_sprite(game, taxi);
-
-        draw_static_scene(game);
-
-        cur_x += dx;
-        cur_y += dy;
-        taxi->x = (int)cur_x;
-        taxi->y = (int)cur_y;
-
-        draw_sprite(game, taxi);
-        wnoutrefresh(game->main_win.window);
-        doupdate();
-        usleep(TAXI_ANIMATION_TICK_SPEED);
-    }
-    remove_sprite(game, taxi);
-}
-
 void init_swallow(Game* game, Swallow* swallow) {
     entity_t* s = &swallow->ent;
 
     swallow->hp = SWALLOW_HP;
     s->width = SWALLOW_SIZE;
     s->height = SWALLOW_SIZE;
-    s->x = game->main_win.cols / 2;
-    s->y = game->main_win.rows / 2;
+    s->x = game->arena_cols / 2;
+    s->y = game->arena_rows / 2;
     s->speed = SWALLOW_SPEED;
     s->direction = DIR_RIGHT;
     s->dx = s->speed;
     s->dy = 0;
     s->color = C_GREEN_5;
+    s->hash = 0;
+    s->id = 0;
     s->sprites[DIR_UP] =
             " ^ "
             "/o\\"
@@ -200,8 +164,39 @@ void init_swallow(Game* game, Swallow* swallow) {
             "-- ";
 }
 
+/**
+ * albatross_taxi_entity - Builds the taxi sprite at its current position
+ * @game: Main game struct
+ * @taxi: entity to fill in
+ *
+ * The position follows from the flight's frame, so it is not part of the
+ * simulation state.
+ *
+ * RETURNS
+ * Void.
+ */
+void albatross_taxi_entity(const Game* game, entity_t* taxi) {
+    const AlbatrossTaxi* t = &game->taxi;
+    const float progress = (float)t->frame / (float)ALBATROSS_TAXI_FRAMES;
+    const int x = t->from_x + (int)((float)(t->to_x - t->from_x) * progress);
+    const int y = t->from_y + (int)((float)(t->to_y - t->from_y) * progress);
+
+    *taxi = (entity_t){0};
+    init_taxi_sprite(taxi, x, y);
+}
+
+/**
+ * call_albatross_taxi - Picks the swallow up for a flight to a safe spot
+ * @game: Main game struct
+ *
+ * The swallow leaves the arena until the taxi lands; the flight itself is
+ * advanced by process_albatross_taxi() along with the rest of the tick.
+ *
+ * RETURNS
+ * Void.
+ */
 void call_albatross_taxi(Game* game) {
-    if (game->albatross_cooldown > 0) {
+    if (game->albatross_cooldown > 0 || game->taxi.active) {
         return;
     }
 
@@ -216,15 +211,67 @@ void call_albatross_taxi(Game* game) {
 
     remove_entity(game, &s->ent);
 
-    entity_t taxi = {0};
-    init_taxi_sprite(&taxi, s->ent.x, s->ent.y);
+    game->taxi.active = 1;
+    game->taxi.frame = 0;
+    game->taxi.from_x = s->ent.x;
+    game->taxi.from_y = s->ent.y;
+    game->taxi.to_x = safe_x;
+    game->taxi.to_y = safe_y;
+}
 
-    run_taxi_animation(game, &taxi, safe_x, safe_y);
+/**
+ * land_albatross_taxi - Puts the swallow down at the end of the flight
+ * @game: Main game struct
+ *
+ * Hunters keep moving while the taxi flies, so the landing spot is checked
+ * again. If it has been taken, the taxi heads for a new one, or hovers until
+ * one turns up.
+ *
+ * RETURNS
+ * Void.
+ */
+static void land_albatross_taxi(Game* game) {
+    Swallow* s = game->entities.swallow;
+    AlbatrossTaxi* t = &game->taxi;
+
+    if (!is_zone_safe(game, t->to_x, t->to_y, s->ent.width, s->ent.height)) {
+        int safe_x = 0;
+        int safe_y = 0;
+        find_safe_zone(game, &safe_x, &safe_y, s->ent.width, s->ent.height);
+        if (safe_x != -1) {
+            t->from_x = t->to_x;
+            t->from_y = t->to_y;
+            t->to_x = safe_x;
+            t->to_y = safe_y;
+            t->frame = 0;
+        }
+        return;
+    }
 
-    s->ent.x = safe_x;
-    s->ent.y = safe_y;
-    update_occupancy_map(game->occupancy_map, game->main_win.rows, game->main_win.cols, &s->ent,
-                         SWALLOW);
+    s->ent.x = t->to_x;
+    s->ent.y = t->to_y;
+    update_occupancy_map(&game->occupancy_map, &s->ent, SWALLOW);
+    checksum_update_entity(game, &s->ent, SWALLOW);
 
+    t->active = 0;
     game->albatross_cooldown = game->config.albatross_cooldown;
 }
+
+/**
+ * process_albatross_taxi - Advances a running taxi flight by one frame
+ * @game: Main game struct
+ *
+ * RETURNS
+ * Void.
+ */
+void process_albatross_taxi(Game* game) {
+    if (!game->taxi.active) {
+        return;
+    }
+    if (game->taxi.frame < ALBATROSS_TAXI_FRAMES) {
+        game->taxi.frame++;
+    }
+    if (game->taxi.frame == ALBATROSS_TAXI_FRAMES) {
+        land_albatross_taxi(game);
+    }
+}
@@ -6,5 +6,7 @@
 void process_swallow(Game* game);
 void init_swallow(Game* game, Swallow* swallow);
 void call_albatross_taxi(Game* game);
+void process_albatross_taxi(Game* game);
+void albatross_taxi_entity(const Game* game, entity_t* taxi);
 
 #endif  // SWALLOW_H
@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "bot.h"
+#include "conf.h"
+#include "headless.h"
+#include "pool.h"
+#include "sweep.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * A sweep runs a base level at every point of a parameter grid, each over
+ * the same seeds, and prints one CSV row per point. A point's values go
+ * through the config parser as if they were lines of the level file, so any
+ * global key can be swept. Every game played is cached in SWEEP_CACHE_PATH
+ * under a hash of the level text with the point's values appended, the seed
+ * and the input policy, so re-running a sweep only plays the new games.
+ */
+
+static void* random_policy_init(const int seed) {
+    uint64_t* state = (uint64_t*)malloc(sizeof(uint64_t));
+    if (!state) {
+        exit(1);
+    }
+    *state = ((uint64_t)(uint32_t)seed * RNG_SEED_MULTIPLIER) | 1;
+    return state;
+}
+
+static int random_policy_key(const BotView* view, void* state) {
+    uint64_t* x = (uint64_t*)state;
+    (void)view;
+
+    *x ^= *x >> 12;
+    *x ^= *x << 25;
+    *x ^= *x >> 27;
+    const uint64_t roll = *x * RNG_OUTPUT_MULTIPLIER;
+    if ((roll >> 40) % SWEEP_RANDOM_KEY_TICKS != 0) {
+        return 0;
+    }
+    return "wasde"[(roll >> 32) % 5];
+}
+
+static int idle_policy_key(const BotView* view, void* state) {
+    (void)view;
+    (void)state;
+    return 0;
+}
+
+/**
+ * load_policy - Sets up the input policy the sweep plays with
+ * @bot: receives the policy
+ * @name: "random" (a key every SWEEP_RANDOM_KEY_TICKS ticks on average),
+ *        "idle" (no input) or the path of a bot plug-in
+ *
+ * RETURNS
+ * 0 on success, -1 if the bot cannot be loaded.
+ */
+static int load_policy(BotPlugin* bot, const char* name) {
+    memset(bot, 0, sizeof(*bot));
+    if (strcmp(name, "random") == 0) {
+        bot->init = random_policy_init;
+        bot->key = random_policy_key;
+        bot->free = free;
+    } else if (strcmp(name, "idle") == 0) {
+        bot->key = idle_policy_key;
+    } else {
+        return bot_load(bot, name);
+    }
+    bot->name = strdup(name);
+    return 0;
+}
+
+/**
+ * parse_param - Parses one NAME=LO:HI:STEP or NAME=V1,V2,... argument
+ * @param: receives the key and its values
+ * @arg: the argument
+ *
+ * RETURNS
+ * 0 on success, -1 (with a message on stderr) if @arg is malformed or names
+ * an unknown key.
+ */
+static int parse_param(SweepParam* param, const char* arg) {
+    const char* eq = strchr(arg, '=');
+    double lo = 0;
+    double hi = 0;
+    double step = 0;
+
+    param->name = eq ? strndup(arg, (size_t)(eq - arg)) : strdup(arg);
+    if (!eq || !is_config_key(param->name)) {
+        fprintf(stderr, "%s: expected KEY=LO:HI:STEP or KEY=V1,V2,... with a level key\n", arg);
+        return -1;
+    }
+    if (sscanf(eq + 1, "%lf:%lf:%lf", &lo, &hi, &step) == 3 && step > 0 && hi >= lo) {
+        param->count = (int)(((hi - lo) / step) + 1e-9) + 1;
+    } else {
+        param->count = 1;
+        for (const char* c = eq + 1; *c; c++) {
+            param->count += *c == ',';
+        }
+    }
+    param->values = (double*)malloc(sizeof(double) * (size_t)param->count);
+    if (!param->values) {
+        exit(1);
+    }
+
+    const char* value = eq + 1;
+    for (int i = 0; i < param->count; i++) {
+        if (step > 0) {
+            param->values[i] = lo + (step * i);
+        } else {
+            const char* comma = strchr(value, ',');
+            param->values[i] = strtod(value, NULL);
+            value = comma ? comma + 1 : value;
+        }
+    }
+    return 0;
+}
+
+static int param_value_index(const Sweep* sweep, int point, const int param) {
+    for (int i = sweep->param_count - 1; i > param; i--) {
+        point /= sweep->params[i].count;
+    }
+    return point % sweep->params[param].count;
+}
+
+/**
+ * point_text - Describes one grid point as level text
+ * @sweep: the sweep
+ * @point: point index
+ * @len: receives the length of the text
+ *
+ * RETURNS
+ * Heap copy of the base level with a "key value" line per param appended.
+ */
+static char* point_text(const Sweep* sweep, const int point, size_t* len) {
+    char* text = NULL;
+    FILE* out = open_memstream(&text, len);
+    if (!out) {
+        exit(1);
+    }
+    fwrite(sweep->level_data, 1, sweep->level_size, out);
+    fputc('\n', out);
+    for (int i = 0; i < sweep->param_count; i++) {
+        const SweepParam* param = &sweep->params[i];
+        fprintf(out, "%s %.9g\n", param->name, param->values[param_value_index(sweep, point, i)]);
+    }
+    fclose(out);
+    return text;
+}
+
+static void build_points(Sweep* sweep) {
+    sweep->configs = (conf_t*)calloc((size_t)sweep->point_count, sizeof(conf_t));
+    sweep->level_hashes = (uint64_t*)calloc((size_t)sweep->point_count, sizeof(uint64_t));
+    sweep->results = (HeadlessResult*)calloc((size_t)sweep->point_count * (size_t)sweep->seeds,
+                                             sizeof(HeadlessResult));
+    sweep->jobs = (SweepJob*)calloc((size_t)sweep->point_count * (size_t)sweep->seeds,
+                                    sizeof(SweepJob));
+    if (!sweep->configs || !sweep->level_hashes || !sweep->results || !sweep->jobs) {
+        exit(1);
+    }
+
+    for (int point = 0; point < sweep->point_count; point++) {
+        size_t len = 0;
+        char* text = point_text(sweep, point, &len);
+        sweep->level_hashes[point] = hash_bytes(text, len);
+        free(text);
+
+        sweep->configs[point] = read_config_data(sweep->level_data, sweep->level_size);
+        for (int i = 0; i < sweep->param_count; i++) {
+            char value[MAX_LINE_LENGTH];
+            snprintf(value, sizeof(value), "%.9g",
+                     sweep->params[i].values[param_value_index(sweep, point, i)]);
+            set_config_value(&sweep->configs[point], sweep->params[i].name, value);
+        }
+    }
+}
+
+static uint64_t game_key(const Sweep* sweep, const int point, const int seed) {
+    unsigned char id[sizeof(uint64_t) + sizeof(int) + SWEEP_POLICY_NAME_LENGTH] = {0};
+
+    memcpy(id, &sweep->level_hashes[point], sizeof(uint64_t));
+    memcpy(id + sizeof(uint64_t), &seed, sizeof(int));
+    strncpy((char*)id + sizeof(uint64_t) + sizeof(int), sweep->policy.name,
+            SWEEP_POLICY_NAME_LENGTH - 1);
+    return hash_bytes(id, sizeof(id));
+}
+
+static int compare_cache_entries(const void* a, const void* b) {
+    const uint64_t x = ((const SweepCacheEntry*)a)->key;
+    const uint64_t y = ((const SweepCacheEntry*)b)->key;
+    return (x > y) - (x < y);
+}
+
+static void load_cache(Sweep* sweep) {
+    size_t size = 0;
+    char* data = read_file_contents(SWEEP_CACHE_PATH, &size);
+    const size_t header = 4 + sizeof(uint32_t);
+    uint32_t version = 0;
+
+    if (data && size >= header) {
+        memcpy(&version, data + 4, sizeof(version));
+    }
+    if (version != SWEEP_CACHE_VERSION || memcmp(data, SWEEP_CACHE_MAGIC, 4) != 0) {
+        free(data);
+        return;
+    }
+    sweep->cache_count = (int)((size - header) / sizeof(SweepCacheEntry));
+    sweep->cache = (SweepCacheEntry*)malloc(sizeof(SweepCacheEntry) * (size_t)sweep->cache_count);
+    if (!sweep->cache && sweep->cache_count > 0) {
+        exit(1);
+    }
+    memcpy((void*)sweep->cache, data + header,
+           sizeof(SweepCacheEntry) * (size_t)sweep->cache_count);
+    qsort(sweep->cache, (size_t)sweep->cache_count, sizeof(SweepCacheEntry),
+          compare_cache_entries);
+    free(data);
+}
+
+static const SweepCacheEntry* find_cached(const Sweep* sweep, const uint64_t key) {
+    const SweepCacheEntry wanted = {key, {0}};
+    if (sweep->cache_count == 0) {
+        return NULL;
+    }
+    return (const SweepCacheEntry*)bsearch(&wanted, sweep->cache, (size_t)sweep->cache_count,
+                                           sizeof(SweepCacheEntry), compare_cache_entries);
+}
+
+/**
+ * plan_games - Fills results from the cache and queues every other game
+ * @sweep: the sweep
+ *
+ * RETURNS
+ * Void.
+ */
+static void plan_games(Sweep* sweep) {
+    load_cache(sweep);
+    for (int point = 0; point < sweep->point_count; point++) {
+        for (int seed = 0; seed < sweep->seeds; seed++) {
+            const SweepCacheEntry* hit = find_cached(sweep, game_key(sweep, point, seed));
+            if (hit) {
+                sweep->results[(point * sweep->seeds) + seed] = hit->result;
+            } else {
+                sweep->jobs[sweep->job_count++] = (SweepJob){(uint32_t)point, seed};
+            }
+        }
+    }
+}
+
+static void play_point(void* ctx, const int index) {
+    Sweep* sweep = (Sweep*)ctx;
+    const SweepJob* job = &sweep->jobs[index];
+    const conf_t* config = &sweep->configs[job->point];
+
+    headless_run(config, config->seed + job->seed, &sweep->policy,
+                 &sweep->results[(job->point * sweep->seeds) + job->seed]);
+}
+
+static void save_cache(const Sweep* sweep) {
+    mkdir(SWEEP_DIR, 0755);
+    FILE* file = fopen(SWEEP_CACHE_PATH, "ab");
+    if (!file) {
+        perror("Error opening sweep cache");
+        return;
+    }
+    if (ftell(file) == 0) {
+        const uint32_t version = SWEEP_CACHE_VERSION;
+        fwrite(SWEEP_CACHE_MAGIC, 1, 4, file);
+        fwrite(&version, sizeof(version), 1, file);
+    }
+    for (int i = 0; i < sweep->job_count; i++) {
+        const SweepJob* job = &sweep->jobs[i];
+        const SweepCacheEntry entry = {
+                game_key(sweep, (int)job->point, job->seed),
+                sweep->results[(job->point * sweep->seeds) + job->seed]};
+        fwrite(&entry, sizeof(entry), 1, file);
+    }
+    fclose(file);
+}
+
+static int compare_ints(const void* a, const void* b) {
+    return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+static void print_csv_header(const Sweep* sweep) {
+    for (int i = 0; i < sweep->param_count; i++) {
+        printf("%s,", sweep->params[i].name);
+    }
+    printf("games,win_rate,score_mean,score_min,score_p25,score_median,score_p75,score_max,"
+           "survival_mean_s\n");
+}
+
+/**
+ * print_point - Prints the CSV row of one grid point
+ * @sweep: a finished sweep
+ * @point: point index
+ * @scores: scratch space for @sweep->seeds scores
+ *
+ * Survival is game time played, whether the game was won or lost.
+ *
+ * RETURNS
+ * Void.
+ */
+static void print_point(const Sweep* sweep, const int point, int* scores) {
+    const HeadlessResult* r = &sweep->results[point * sweep->seeds];
+    const int n = sweep->seeds;
+    double total = 0;
+    double survived = 0;
+    int wins = 0;
+
+    for (int seed = 0; seed < n; seed++) {
+        scores[seed] = r[seed].score;
+        total += r[seed].score;
+        survived += sweep->configs[point].timer - r[seed].time_left;
+        wins += r[seed].result == WINNER;
+    }
+    qsort(scores, (size_t)n, sizeof(int), compare_ints);
+
+    for (int i = 0; i < sweep->param_count; i++) {
+        printf("%.9g,", sweep->params[i].values[param_value_index(sweep, point, i)]);
+    }
+    printf("%d,%.4f,%.2f,%d,%d,%d,%d,%d,%.2f\n", n, (double)wins / n, total / n, scores[0],
+           scores[(n - 1) / 4], scores[(n - 1) / 2], scores[(3 * (n - 1)) / 4], scores[n - 1],
+           survived / n);
+}
+
+static void free_sweep(Sweep* sweep) {
+    for (int i = 0; i < sweep->param_count; i++) {
+        free(sweep->params[i].name);
+        free(sweep->params[i].values);
+    }
+    for (int i = 0; sweep->configs && i < sweep->point_count; i++) {
+        free_config(&sweep->configs[i]);
+    }
+    bot_unload(&sweep->policy);
+    free((void*)sweep->level_data);
+    free(sweep->params);
+    free(sweep->configs);
+    free(sweep->level_hashes);
+    free(sweep->cache);
+    free(sweep->results);
+    free(sweep->jobs);
+}
+
+static int setup_sweep(Sweep* sweep, const char* level_path, const char** params,
+                       const int param_count, const char* policy) {
+    sweep->level_data = read_file_contents(level_path, &sweep->level_size);
+    if (!sweep->level_data) {
+        perror(level_path);
+        return -1;
+    }
+    sweep->params = (SweepParam*)calloc((size_t)param_count + 1, sizeof(SweepParam));
+    if (!sweep->params) {
+        exit(1);
+    }
+    long points = 1;
+    for (int i = 0; i < param_count; i++) {
+        sweep->param_count++;
+        if (parse_param(&sweep->params[i], params[i]) != 0) {
+            return -1;
+        }
+        points *= sweep->params[i].count;
+        if (points > SWEEP_MAX_POINTS) {
+            fprintf(stderr, "More than %d points to sweep\n", SWEEP_MAX_POINTS);
+            return -1;
+        }
+    }
+    sweep->point_count = (int)points;
+    return load_policy(&sweep->policy, policy ? policy : "random");
+}
+
+/**
+ * run_sweep - Plays a parameter grid and prints its statistics as CSV
+ * @level_path: base level file
+ * @params: KEY=LO:HI:STEP or KEY=V1,V2,... arguments
+ * @param_count: number of entries in @params
+ * @seeds: games per point
+ * @threads: threads to play on, 0 for one per core
+ * @policy: input policy, see load_policy(); NULL for "random"
+ *
+ * RETURNS
+ * The process exit status.
+ */
+int run_sweep(const char* level_path, const char** params, const int param_count,
+              const int seeds, const int threads, const char* policy) {
+    Sweep sweep = {0};
+    sweep.seeds = seeds > 0 ? seeds : TOURNAMENT_DEFAULT_SEEDS;
+    if (setup_sweep(&sweep, level_path, params, param_count, policy) != 0) {
+        free_sweep(&sweep);
+        return 1;
+    }
+    build_points(&sweep);
+    plan_games(&sweep);
+
+    Pool pool;
+    pool_start(&pool, threads);
+    const uint64_t start = monotonic_us();
+    pool_run(&pool, play_point, &sweep, sweep.job_count);
+    const uint64_t elapsed = monotonic_us() - start;
+    pool_stop(&pool);
+    save_cache(&sweep);
+    fprintf(stderr, "%d points x %d seeds: %d cached, %d played in %.2f s\n", sweep.point_count,
+            sweep.seeds, (sweep.point_count * sweep.seeds) - sweep.job_count, sweep.job_count,
+            (double)elapsed / 1000000.0);
+
+    int* scores = (int*)malloc(sizeof(int) * (size_t)sweep.seeds);
+    if (!scores) {
+        exit(1);
+    }
+    print_csv_header(&sweep);
+    for (int point = 0; point < sweep.point_count; point++) {
+        print_point(&sweep, point, scores);
+    }
+    free(scores);
+    free_sweep(&sweep);
+    return 0;
+}
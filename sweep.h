@@ -0,0 +1,7 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+int run_sweep(const char* level_path, const char** params, int param_count, int seeds, int threads,
+              const char* policy);
+
+#endif  // SWEEP_H
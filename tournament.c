@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bot.h"
+#include "conf.h"
+#include "headless.h"
+#include "pool.h"
+#include "tournament.h"
+#include "types.h"
+#include "utils.h"
+
+/*
+ * A tournament plays every bot on every level with seeds level.seed,
+ * level.seed + 1, ... as headless games spread over a thread pool, then
+ * prints one table per statistic. It never initialises ncurses, so its
+ * output can be redirected and diffed between builds.
+ */
+
+static void play_match(void* ctx, const int index) {
+    Tournament* t = (Tournament*)ctx;
+    const int seed = index % t->seeds;
+    const int level = (index / t->seeds) % t->level_count;
+    const int bot = index / (t->seeds * t->level_count);
+    const conf_t* config = &t->levels[level].config;
+
+    headless_run(config, config->seed + seed, &t->bots[bot], &t->results[index]);
+}
+
+static int load_bots(Tournament* t, const char** paths, const int count) {
+    t->bots = (BotPlugin*)calloc((size_t)count, sizeof(BotPlugin));
+    if (!t->bots) {
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        if (bot_load(&t->bots[i], paths[i]) != 0) {
+            return -1;
+        }
+        t->bot_count++;
+    }
+    return 0;
+}
+
+static int load_tournament_levels(Tournament* t) {
+    char** files = NULL;
+    const int count = load_levels(&files);
+
+    t->levels = (TournamentLevel*)calloc((size_t)count + 1, sizeof(TournamentLevel));
+    if (!t->levels) {
+        exit(1);
+    }
+    for (int i = 0; i < count; i++) {
+        char* path = NULL;
+        if (asprintf(&path, "levels/%s", files[i]) < 0) {
+            exit(1);
+        }
+        t->levels[i].config = read_config(path);
+        t->levels[i].name = strndup(files[i], strcspn(files[i], "."));
+        t->level_count++;
+        free(path);
+        free(files[i]);
+    }
+    free((void*)files);
+    return count > 0 ? 0 : -1;
+}
+
+static void print_header(const Tournament* t, const char* title) {
+    printf("\n%s\n%-*s", title, TOURNAMENT_COLUMN_WIDTH, "bot");
+    for (int level = 0; level < t->level_count; level++) {
+        printf("%*s", TOURNAMENT_COLUMN_WIDTH, t->levels[level].name);
+    }
+    printf("\n");
+}
+
+/**
+ * print_results - Prints the mean score and win count of every bot per level
+ * @t: a finished tournament
+ *
+ * RETURNS
+ * Void.
+ */
+static void print_results(const Tournament* t) {
+    print_header(t, "Mean score (wins/games)");
+    for (int bot = 0; bot < t->bot_count; bot++) {
+        printf("%-*s", TOURNAMENT_COLUMN_WIDTH, t->bots[bot].name);
+        for (int level = 0; level < t->level_count; level++) {
+            const HeadlessResult* r = &t->results[(bot * t->level_count + level) * t->seeds];
+            long total = 0;
+            int wins = 0;
+            for (int seed = 0; seed < t->seeds; seed++) {
+                total += r[seed].score;
+                wins += r[seed].result == WINNER;
+            }
+            char cell[TOURNAMENT_COLUMN_WIDTH + 1];
+            snprintf(cell, sizeof(cell), "%ld (%d/%d)", total / t->seeds, wins, t->seeds);
+            printf("%*s", TOURNAMENT_COLUMN_WIDTH, cell);
+        }
+        printf("\n");
+    }
+}
+
+static void print_throughput(const Tournament* t, const int matches, const int threads,
+                             const uint64_t elapsed_us) {
+    uint64_t ticks = 0;
+    for (int i = 0; i < matches; i++) {
+        ticks += t->results[i].ticks;
+    }
+    const double seconds = elapsed_us > 0 ? (double)elapsed_us / 1000000.0 : 1e-6;
+    printf("\n%d games, %llu ticks in %.2f s on %d threads: %.0f ticks/s (%.0f per thread)\n",
+           matches, (unsigned long long)ticks, seconds, threads, (double)ticks / seconds,
+           (double)ticks / seconds / threads);
+}
+
+static void free_tournament(Tournament* t) {
+    for (int i = 0; i < t->bot_count; i++) {
+        bot_unload(&t->bots[i]);
+    }
+    for (int i = 0; i < t->level_count; i++) {
+        free_config(&t->levels[i].config);
+        free(t->levels[i].name);
+    }
+    free(t->bots);
+    free(t->levels);
+    free(t->results);
+}
+
+/**
+ * run_tournament - Plays every bot on every level and seed and prints the results
+ * @bot_paths: bot plug-ins to load
+ * @bot_count: number of entries in @bot_paths
+ * @seeds: games per bot and level
+ * @threads: threads to play on, 0 for one per core
+ *
+ * RETURNS
+ * The process exit status: 0 on success, 1 if a bot or the levels cannot be loaded.
+ */
+int run_tournament(const char** bot_paths, const int bot_count, const int seeds, int threads) {
+    Tournament t = {0};
+    t.seeds = seeds > 0 ? seeds : TOURNAMENT_DEFAULT_SEEDS;
+    if (load_bots(&t, bot_paths, bot_count) != 0) {
+        free_tournament(&t);
+        return 1;
+    }
+    if (load_tournament_levels(&t) != 0) {
+        fprintf(stderr, "No levels found in levels/\n");
+        free_tournament(&t);
+        return 1;
+    }
+
+    const int matches = t.bot_count * t.level_count * t.seeds;
+    t.results = (HeadlessResult*)calloc((size_t)matches, sizeof(HeadlessResult));
+    if (!t.results) {
+        exit(1);
+    }
+    threads = threads > 0 ? threads : pool_default_threads();
+
+    Pool pool;
+    pool_start(&pool, threads);
+    const uint64_t start = monotonic_us();
+    pool_run(&pool, play_match, &t, matches);
+    const uint64_t elapsed = monotonic_us() - start;
+    pool_stop(&pool);
+
+    print_results(&t);
+    print_throughput(&t, matches, threads, elapsed);
+    free_tournament(&t);
+    return 0;
+}
@@ -0,0 +1,6 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+int run_tournament(const char** bot_paths, int bot_count, int seeds, int threads);
+
+#endif  // TOURNAMENT_H
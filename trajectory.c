@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "game.h"
+#include "headless.h"
+#include "replay.h"
+#include "trajectory.h"
+#include "types.h"
+
+/*
+ * Trajectories are exported column by column: every field has its own
+ * growable buffer that the playback appends raw values to, and the file is
+ * the buffers written back to back. No value is ever formatted, and reading
+ * a field for a whole game is a single aligned array in the mapped file.
+ */
+
+static const TrajectoryColumnInfo columns[TRAJ_COLUMNS] = {
+        [TRAJ_TICK] = {"tick", TRAJ_U32, 4},
+        [TRAJ_KEY] = {"key", TRAJ_I32, 4},
+        [TRAJ_SWALLOW_X] = {"swallow_x", TRAJ_I32, 4},
+        [TRAJ_SWALLOW_Y] = {"swallow_y", TRAJ_I32, 4},
+        [TRAJ_SWALLOW_HP] = {"swallow_hp", TRAJ_I32, 4},
+        [TRAJ_SWALLOW_DIR] = {"swallow_dir", TRAJ_U8, 1},
+        [TRAJ_SCORE] = {"score", TRAJ_I32, 4},
+        [TRAJ_STARS_COLLECTED] = {"stars_collected", TRAJ_I32, 4},
+        [TRAJ_TIME_LEFT] = {"time_left", TRAJ_F32, 4},
+        [TRAJ_HUNTER_OFFSETS] = {"hunter_offsets", TRAJ_U32, 4},
+        [TRAJ_STAR_OFFSETS] = {"star_offsets", TRAJ_U32, 4},
+        [TRAJ_HUNTER_ID] = {"hunter_id", TRAJ_U32, 4},
+        [TRAJ_HUNTER_X] = {"hunter_x", TRAJ_I32, 4},
+        [TRAJ_HUNTER_Y] = {"hunter_y", TRAJ_I32, 4},
+        [TRAJ_HUNTER_DIR] = {"hunter_dir", TRAJ_U8, 1},
+        [TRAJ_HUNTER_STATE] = {"hunter_state", TRAJ_U8, 1},
+        [TRAJ_HUNTER_TEMPLATE] = {"hunter_template", TRAJ_U8, 1},
+        [TRAJ_STAR_ID] = {"star_id", TRAJ_U32, 4},
+        [TRAJ_STAR_X] = {"star_x", TRAJ_I32, 4},
+        [TRAJ_STAR_Y] = {"star_y", TRAJ_I32, 4},
+};
+
+static void put_i32(ByteBuffer* col, const int32_t value) {
+    buffer_put_bytes(col, &value, sizeof(value));
+}
+
+static void put_u32(ByteBuffer* col, const uint32_t value) {
+    buffer_put_bytes(col, &value, sizeof(value));
+}
+
+static void put_f32(ByteBuffer* col, const float value) {
+    buffer_put_bytes(col, &value, sizeof(value));
+}
+
+static size_t column_rows(const ByteBuffer* cols, const TrajectoryColumn c) {
+    return cols[c].len / columns[c].width;
+}
+
+static void append_entities(ByteBuffer* cols, const Game* game) {
+    for (const Hunter* hu = game->entities.hunters; hu; hu = hu->next) {
+        put_u32(&cols[TRAJ_HUNTER_ID], hu->ent.id);
+        put_i32(&cols[TRAJ_HUNTER_X], hu->ent.x);
+        put_i32(&cols[TRAJ_HUNTER_Y], hu->ent.y);
+        buffer_put_u8(&cols[TRAJ_HUNTER_DIR], hu->ent.direction);
+        buffer_put_u8(&cols[TRAJ_HUNTER_STATE], hu->state);
+        buffer_put_u8(&cols[TRAJ_HUNTER_TEMPLATE], (unsigned int)hu->template_idx);
+    }
+    for (const Star* st = game->entities.stars; st; st = st->next) {
+        put_u32(&cols[TRAJ_STAR_ID], st->ent.id);
+        put_i32(&cols[TRAJ_STAR_X], st->ent.x);
+        put_i32(&cols[TRAJ_STAR_Y], st->ent.y);
+    }
+    put_u32(&cols[TRAJ_HUNTER_OFFSETS], (uint32_t)column_rows(cols, TRAJ_HUNTER_ID));
+    put_u32(&cols[TRAJ_STAR_OFFSETS], (uint32_t)column_rows(cols, TRAJ_STAR_ID));
+}
+
+/**
+ * append_tick - Appends the state at the end of a tick to the columns
+ * @cols: one buffer per column
+ * @game: game being played back
+ *
+ * RETURNS
+ * Void.
+ */
+static void append_tick(ByteBuffer* cols, const Game* game) {
+    const Swallow* swallow = game->entities.swallow;
+
+    put_u32(&cols[TRAJ_TICK], game->replay.tick - 1);
+    put_i32(&cols[TRAJ_KEY], game->tick_key);
+    put_i32(&cols[TRAJ_SWALLOW_X], swallow->ent.x);
+    put_i32(&cols[TRAJ_SWALLOW_Y], swallow->ent.y);
+    put_i32(&cols[TRAJ_SWALLOW_HP], swallow->hp);
+    buffer_put_u8(&cols[TRAJ_SWALLOW_DIR], swallow->ent.direction);
+    put_i32(&cols[TRAJ_SCORE], game->score);
+    put_i32(&cols[TRAJ_STARS_COLLECTED], game->stars_collected);
+    put_f32(&cols[TRAJ_TIME_LEFT], game->time_left);
+    append_entities(cols, game);
+}
+
+static uint64_t align_offset(const uint64_t offset) {
+    return (offset + TRAJECTORY_ALIGN - 1) & ~(uint64_t)(TRAJECTORY_ALIGN - 1);
+}
+
+static void fill_header(TrajectoryFileHeader* header, const ByteBuffer* cols, const Game* game) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, TRAJECTORY_MAGIC, sizeof(header->magic));
+    header->version = TRAJECTORY_VERSION;
+    header->column_count = TRAJ_COLUMNS;
+    header->ticks = (uint32_t)column_rows(cols, TRAJ_TICK);
+    header->hunter_rows = column_rows(cols, TRAJ_HUNTER_ID);
+    header->star_rows = column_rows(cols, TRAJ_STAR_ID);
+    header->level_hash = game->replay.header.level_hash;
+    header->level_nr = game->replay.header.level_nr;
+    header->seed = game->replay.header.seed;
+}
+
+/**
+ * write_columns - Writes the header, the column table and the columns
+ * @file: trajectory file
+ * @cols: filled column buffers
+ * @game: the game they were taken from
+ *
+ * RETURNS
+ * 0 on success, -1 on a write error.
+ */
+static int write_columns(FILE* file, const ByteBuffer* cols, const Game* game) {
+    static const unsigned char padding[TRAJECTORY_ALIGN] = {0};
+    TrajectoryFileHeader header;
+    TrajectoryColumnDesc descs[TRAJ_COLUMNS];
+    uint64_t offset = sizeof(header) + sizeof(descs);
+
+    fill_header(&header, cols, game);
+    memset(descs, 0, sizeof(descs));
+    for (int c = 0; c < TRAJ_COLUMNS; c++) {
+        strncpy(descs[c].name, columns[c].name, TRAJECTORY_NAME_LENGTH - 1);
+        descs[c].type = columns[c].type;
+        descs[c].width = columns[c].width;
+        descs[c].count = column_rows(cols, (TrajectoryColumn)c);
+        descs[c].offset = align_offset(offset);
+        offset = descs[c].offset + cols[c].len;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(descs, sizeof(descs), 1, file) == 1;
+    uint64_t pos = sizeof(header) + sizeof(descs);
+    for (int c = 0; ok && c < TRAJ_COLUMNS; c++) {
+        const size_t pad = (size_t)(descs[c].offset - pos);
+        ok = fwrite(padding, 1, pad, file) == pad &&
+             (cols[c].len == 0 || fwrite(cols[c].data, 1, cols[c].len, file) == cols[c].len);
+        pos = descs[c].offset + cols[c].len;
+    }
+    return ok ? 0 : -1;
+}
+
+/**
+ * trajectory_export - Exports a replay to a columnar trajectory file
+ * @replay_path: replay to export
+ * @out_path: trajectory file to write
+ *
+ * One row is taken at the end of every tick, including the last key
+ * applied during it (ERR when there was none).
+ *
+ * RETURNS
+ * 0 on success, -1 if the replay cannot be read, desyncs, or the file
+ * cannot be written.
+ */
+int trajectory_export(const char* replay_path, const char* out_path) {
+    Game game = {0};
+    ByteBuffer cols[TRAJ_COLUMNS] = {0};
+    for (int c = 0; c < TRAJ_COLUMNS; c++) {
+        cols[c].tag = MEM_REPLAY;
+    }
+    game.replay.fd = -1;
+    game.replay.replay_state = REPLAY_OFF;
+    if (replay_open(&game.replay, replay_path) != 0) {
+        return -1;
+    }
+
+    headless_playback_start(&game);
+    put_u32(&cols[TRAJ_HUNTER_OFFSETS], 0);
+    put_u32(&cols[TRAJ_STAR_OFFSETS], 0);
+    while (game.running) {
+        simulate_tick(&game);
+        append_tick(cols, &game);
+    }
+
+    int status = game.replay.desynced ? -1 : 0;
+    FILE* file = status == 0 ? fopen(out_path, "wb") : NULL;
+    if (file) {
+        status = write_columns(file, cols, &game);
+        status = fclose(file) == 0 ? status : -1;
+        if (status != 0) {
+            remove(out_path);
+        }
+    } else {
+        status = -1;
+    }
+
+    headless_playback_finish(&game);
+    replay_free(&game.replay);
+    for (int c = 0; c < TRAJ_COLUMNS; c++) {
+        buffer_free(&cols[c]);
+    }
+    return status;
+}
+
+/**
+ * run_trajectory_export - Exports replays and replay directories to trajectories/
+ * @args: replay files and directories of replays; none for the replay library
+ * @count: number of entries in @args
+ * @threads: threads to export on, 0 for one per core
+ *
+ * RETURNS
+ * The process exit status: 0 if every replay was exported, 1 otherwise.
+ */
+int run_trajectory_export(const char** args, const int count, const int threads) {
+    return run_replay_export(args, count, threads, TRAJECTORY_DIR, ".traj", trajectory_export);
+}
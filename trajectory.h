@@ -0,0 +1,9 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "types.h"
+
+int trajectory_export(const char* replay_path, const char* out_path);
+int run_trajectory_export(const char** args, int count, int threads);
+
+#endif  // TRAJECTORY_H
@@ -2,10 +2,80 @@
 #define TYPES_H
 
 #include <ncurses.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define MAX_LINE_LENGTH 256
 #define MAX_USERNAME_LENGTH 50
-#define REPLAY_CHUNK 512
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+#define RNG_SEED_MULTIPLIER 0x9E3779B97F4A7C15ULL
+#define RNG_OUTPUT_MULTIPLIER 0x2545F4914F6CDD1DULL
+#define BUFFER_INITIAL_CAPACITY 64
+#define MAX_VARINT_BYTES 10
+#define REPLAY_DIR "replays"
+#define REPLAY_INDEX_PATH "replays/index.bin"
+#define REPLAY_INDEX_TMP_PATH "replays/index.tmp"
+#define REPLAY_INDEX_LOCK_PATH "replays/index.lock"
+#define REPLAY_MAGIC "SWRP"
+#define REPLAY_INDEX_MAGIC "SWIX"
+#define REPLAY_INDEX_VERSION 1
+#define REPLAY_VERSION 6
+#define REPLAY_TAG_CHECKSUM 0x80
+#define REPLAY_TAG_KEYFRAME 0x81
+#define REPLAY_CHECKSUM_TICKS 60
+#define REPLAY_KEYFRAME_TICKS 150
+#define REPLAY_SEEK_TICKS 150
+#define REPLAY_FLUSH_BYTES 4096
+#define REPLAY_FLUSH_TICKS 150
+#define REPLAY_STORAGE_BUDGET (8 * 1024 * 1024)
+#define REPLAY_CREATE_ATTEMPTS 16
+#define REPLAY_LIST_X_OFFSET 30
+#define REPLAY_LIST_START_Y 4
+#define REPLAY_FILTER_MAX_LEVEL 9
+#define REWIND_HISTORY_TICKS 450
+#define REWIND_STEP_TICKS 45
+#define REWIND_MAX_BYTES (1024 * 1024)
+#define REWIND_ENTITY_FIELDS 19
+#define REWIND_COUNTERS 19
+#define REWIND_INITIAL_ENTITIES 32
+#define SPECTATE_SHM_PREFIX "/swallow-spectate-"
+#define SPECTATE_SHM_DIR "/dev/shm"
+#define SPECTATE_NAME_LENGTH 64
+#define SPECTATE_NAME_ATTEMPTS 8
+#define SPECTATE_MAX_BROADCASTS 32
+#define SPECTATE_MAGIC "SWSP"
+#define SPECTATE_VERSION 3
+#define SPECTATE_RING_BYTES (1024 * 1024)
+#define SPECTATE_MAX_RECORD (SPECTATE_RING_BYTES / 4)
+#define SPECTATE_KEYFRAME_TICKS 30
+#define SPECTATE_TAXI_ID UINT32_MAX
+#define SPECTATE_INITIAL_ENTITIES 64
+#define SPECTATE_POLL_US 20000
+#define SPECTATE_REOPEN_US 500000
+#define BOT_API_VERSION 1
+#define TOURNAMENT_DEFAULT_SEEDS 8
+#define TOURNAMENT_COLUMN_WIDTH 16
+#define RANKING_PATH "ranking.txt"
+#define SWEEP_DIR "sweeps"
+#define SWEEP_CACHE_PATH "sweeps/cache.bin"
+#define SWEEP_CACHE_MAGIC "SWSC"
+#define SWEEP_CACHE_VERSION 1
+#define SWEEP_MAX_POINTS 100000
+#define SWEEP_RANDOM_KEY_TICKS 8
+#define SWEEP_POLICY_NAME_LENGTH 64
+#define HEATMAP_DIR "heatmaps"
+#define HEATMAP_MAGIC "SWHM"
+#define HEATMAP_VERSION 1
+#define HEATMAP_RAMP_STEPS 5
+#define CAST_DIR "casts"
+#define CAST_STATUS_COL 2
+#define TRAJECTORY_DIR "trajectories"
+#define TRAJECTORY_MAGIC "SWTJ"
+#define TRAJECTORY_VERSION 1
+#define TRAJECTORY_NAME_LENGTH 24
+#define TRAJECTORY_ALIGN 64
 
 #define BORDER_WIDTH 2
 #define CENTER_X_OFFSET 10
@@ -22,6 +92,26 @@
 #define MENU_TICK_SPEED 50000
 #define ASCII_HIGH_SCORE_LINES 4
 
+#define TICK_BASE_US 66666
+#define DEFAULT_RENDER_FPS 30
+#define RENDER_BUFFERS 3
+#define RENDER_INITIAL_SPRITES 64
+#define DRAW_LIST_INITIAL_SPANS 256
+#define KEY_ESCAPE 27
+#define INPUT_DRAIN_MAX 64
+#define OUTPUT_RELAY_CHUNK 4096
+#define LOW_BANDWIDTH_FRAME_BUDGET 1024
+#define LOW_BANDWIDTH_BACKLOG_LIMIT 512
+#define LOW_BANDWIDTH_SHADES 5
+#define BANDWIDTH_AVERAGE_WEIGHT 8
+#define REPLAY_SPEED_MAX 0
+#define PERF_WINDOW_TICKS 128
+#define PERF_TOGGLE_KEY 'i'
+#define PERF_PERCENTILE 99
+#define LATENCY_BUCKET_US 1000
+#define LATENCY_BUCKETS 256
+#define LATENCY_PENDING_KEYS 64
+
 #define ANIMATION_TICKS 5
 #define GAME_OVER_INPUT_BLOCK 2000000
 #define MAX_REDUCTION_FACTOR 0.2f
@@ -39,9 +129,12 @@
 #define HUNTER_IDLE_TICKS 30
 #define MAX_SPAWN_HUNTER_THRESHOLD 5
 
-#define ALBATROSS_TAXI_DURATION 20.0f
 #define ALBATROSS_TAXI_FRAMES 20
-#define TAXI_ANIMATION_TICK_SPEED 30000
+
+#define OCCUPANCY_CHUNK_SHIFT 6
+#define OCCUPANCY_CHUNK_SIZE (1 << OCCUPANCY_CHUNK_SHIFT)
+#define OCCUPANCY_CHUNK_CELLS (OCCUPANCY_CHUNK_SIZE * OCCUPANCY_CHUNK_SIZE)
+#define CAMERA_MARGIN_DIVISOR 4
 
 #define STAR_MOVE_TICKS 4
 #define STAR_SPEED_MAX 3
@@ -57,8 +150,63 @@ typedef enum { UP, DOWN } increment_t;
 
 typedef enum { WALL, HUNTER, SWALLOW, STAR, EMPTY } collision_t;
 
+// Where the terminal input stream is within an escape sequence.
+typedef enum { KEY_PARSE_TEXT, KEY_PARSE_ESCAPE, KEY_PARSE_SEQUENCE } KeyParseState;
+
+// A square of the occupancy map; only allocated while something is in it.
+typedef struct {
+    char cells[OCCUPANCY_CHUNK_CELLS];
+    int used;
+} OccupancyChunk;
+
+/*
+ * Occupancy of the whole arena, split into chunks of OCCUPANCY_CHUNK_SIZE
+ * squared cells. Missing chunks are EMPTY and the border is an implicit
+ * WALL, so memory follows the occupied regions rather than the arena size.
+ */
+typedef struct {
+    int rows, cols;
+    int chunk_rows, chunk_cols;
+    OccupancyChunk** chunks;
+    // Cells written since the map was created, for the performance overlay.
+    uint64_t writes;
+} OccupancyMap;
+
 typedef enum { UNKNOWN, WINNER, LOSER } result_t;
 
+// Subsystems that tracked allocations are charged to.
+typedef enum {
+    MEM_ENTITIES,
+    MEM_CONFIG,
+    MEM_REPLAY,
+    MEM_RANKING,
+    MEM_RENDER,
+    MEM_UI,
+    MEM_REWIND,
+    MEM_BROADCAST,
+    MEM_TAGS
+} MemTag;
+
+// Prefix of every tracked block; keeps the payload maximally aligned.
+typedef struct {
+    _Alignas(max_align_t) size_t size;
+    MemTag tag;
+} MemHeader;
+
+typedef struct {
+    _Atomic uint64_t allocs;
+    _Atomic uint64_t frees;
+    _Atomic uint64_t live;
+    _Atomic uint64_t peak;
+} MemCounters;
+
+typedef struct {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t live;
+    uint64_t peak;
+} MemStats;
+
 typedef enum {
     PAIR_DEFAULT = 1,
     PAIR_PLAYER,
@@ -97,7 +245,22 @@ typedef enum {
     C_GREY_2
 } ColorPair;
 
-typedef enum { REPLAY_RECORDING, REPLAY_PLAYING } ReplayState;
+typedef enum { REPLAY_RECORDING, REPLAY_PLAYING, REPLAY_OFF } ReplayState;
+
+// Growable byte buffer; its storage is charged to tag.
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t cap;
+    MemTag tag;
+} ByteBuffer;
+
+typedef struct {
+    const unsigned char* data;
+    size_t len;
+    size_t pos;
+    int error;
+} ByteReader;
 
 // Entity types
 typedef struct {
@@ -111,6 +274,8 @@ typedef struct {
     int anim_timer;
     direction_t direction;
     ColorPair color;
+    uint64_t hash;
+    uint32_t id;
 } entity_t;
 
 typedef struct {
@@ -134,6 +299,7 @@ typedef struct Hunter {
     int state_timer;
     int base_speed;
     int dash_cooldown;
+    int template_idx;
     struct Hunter* next;
 } Hunter;
 
@@ -156,6 +322,9 @@ typedef struct {
     int max_speed;
     int seed;
     int hunter_templates_amount;
+    int render_fps;
+    int arena_width;
+    int arena_height;
     float timer;
     float star_spawn;
     float hunter_spawn;
@@ -187,15 +356,675 @@ typedef struct GameEntities {
     Star* stars;
 } GameEntities;
 
+// On-disk replay layout: header, level file contents, event stream.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t level_hash;
+    uint32_t level_size;
+    int32_t seed;
+    int32_t level_nr;
+    int32_t score;
+    int32_t result;
+    uint32_t ticks;
+    int64_t timestamp;
+    char username[MAX_USERNAME_LENGTH];
+} ReplayFileHeader;
+
+typedef struct {
+    uint32_t id;
+    int32_t level_nr;
+    int32_t score;
+    int32_t result;
+    uint32_t ticks;
+    uint32_t file_size;
+    int64_t timestamp;
+    uint64_t level_hash;
+    char username[MAX_USERNAME_LENGTH];
+} ReplayIndexEntry;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t next_id;
+    uint32_t count;
+} ReplayIndexHeader;
+
+typedef struct {
+    const char* username;
+    int level_nr;
+    int min_score;
+} ReplayFilter;
+
+// Keyframe record in a mapped replay: full game state at the end of `tick`.
+typedef struct {
+    unsigned int tick;
+    size_t payload_pos;
+    size_t payload_len;
+    size_t next_pos;
+} ReplayKeyframe;
+
 typedef struct {
     ReplayState replay_state;
-    char* replay_keys;
-    char* replay_level_name;
-    unsigned int replay_index;
-    unsigned int replay_chunks;
-    unsigned int playback_index;
+    ReplayFileHeader header;
+    uint32_t id;
+    char* path;
+    // Recording: events are buffered here and streamed to fd.
+    int fd;
+    ByteBuffer events;
+    size_t bytes_written;
+    unsigned int last_flush_tick;
+    // Playback: the whole file is mapped read-only.
+    void* map;
+    size_t map_len;
+    ByteReader stream;
+    ReplayKeyframe* keyframes;
+    int keyframe_count;
+    unsigned int tick;
+    unsigned int last_event_tick;
+    int desynced;
+    unsigned int desync_tick;
 } replay_t;
 
+// Rewind undo records: entity list changes and occupancy cells, by op.
+typedef enum {
+    REWIND_OP_END,
+    REWIND_OP_SPAWNED,
+    REWIND_OP_REMOVED,
+    REWIND_OP_CHANGED,
+    REWIND_OP_CELL
+} RewindOpKind;
+
+// Entity state flattened to integers so shadow copies diff field by field.
+typedef struct {
+    uint32_t id;
+    collision_t kind;
+    int64_t fields[REWIND_ENTITY_FIELDS];
+} RewindEntity;
+
+typedef struct {
+    RewindOpKind op;
+    collision_t kind;
+    uint32_t id;
+    uint32_t index;
+    uint64_t mask;
+    int64_t fields[REWIND_ENTITY_FIELDS];
+    uint64_t cell;
+    char value;
+} RewindOp;
+
+/*
+ * Ring of per-tick undo records, newest at head - 1. The shadow copies hold
+ * the state at the end of the last captured tick and are what each new tick
+ * is diffed against.
+ */
+typedef struct {
+    ByteBuffer* records;
+    int head;
+    int count;
+    size_t bytes;
+    uint64_t counters[REWIND_COUNTERS];
+    uint32_t next_id;
+    RewindEntity* shadow;
+    RewindEntity* current;
+    int shadow_count;
+    int capacity;
+    OccupancyMap map;
+} Rewind;
+
+typedef enum {
+    SPECTATE_OP_END,
+    SPECTATE_OP_RESET,
+    SPECTATE_OP_STATUS,
+    SPECTATE_OP_SPAWN,
+    SPECTATE_OP_MOVE,
+    SPECTATE_OP_LOOK,
+    SPECTATE_OP_REMOVE
+} SpectateOp;
+
+// Status values carried by SPECTATE_OP_STATUS, in mask bit order.
+typedef enum {
+    SPECTATE_HP,
+    SPECTATE_STARS,
+    SPECTATE_SPEED,
+    SPECTATE_SCORE,
+    SPECTATE_TIME_LEFT,
+    SPECTATE_COOLDOWN,
+    SPECTATE_REWIND_SECONDS,
+    SPECTATE_CAMERA_X,
+    SPECTATE_CAMERA_Y,
+    SPECTATE_STATUS_FIELDS
+} SpectateStatus;
+
+/*
+ * Shared-memory ring the game writes its broadcast records into. Positions
+ * count bytes since the ring was created; a record is a 4-byte length and its
+ * ops, and may wrap around the end of data[]. Readers check reserved after
+ * copying a record to detect that the writer has lapped them. Every
+ * broadcasting process has its own ring, named after its pid, and says
+ * whose it is so spectators can choose.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    int32_t pid;
+    uint32_t uid;
+    char username[MAX_USERNAME_LENGTH];
+    _Atomic uint64_t reserved;
+    _Atomic uint64_t committed;
+    _Atomic uint64_t keyframe;
+    _Atomic uint32_t live;
+    unsigned char data[SPECTATE_RING_BYTES];
+} SpectateRing;
+
+// What spectators were last told about one drawn entity.
+typedef struct {
+    uint32_t id;
+    int x, y;
+    int width, height;
+    const char* sprite;
+    ColorPair color;
+    int layer;
+} BroadcastEntity;
+
+// A live broadcast found by the spectator.
+typedef struct {
+    char name[SPECTATE_NAME_LENGTH];
+    int32_t pid;
+    uint32_t uid;
+    char username[MAX_USERNAME_LENGTH];
+    char live;
+} BroadcastInfo;
+
+typedef struct {
+    char enabled;
+    SpectateRing* ring;
+    char shm_name[SPECTATE_NAME_LENGTH];
+    ByteBuffer record;
+    BroadcastEntity* shadow;
+    BroadcastEntity* current;
+    int shadow_count;
+    int capacity;
+    uint64_t status[SPECTATE_STATUS_FIELDS];
+    unsigned int ticks;
+} Broadcast;
+
+// One sprite of a published frame; the grid points at static or config data.
+typedef struct {
+    int x, y;
+    int width, height;
+    const char* sprite;
+    ColorPair color;
+    int layer;
+} FrameSprite;
+
+// A run of visible sprite characters on one row, clipped to the window.
+typedef struct {
+    int layer;
+    ColorPair color;
+    int row;
+    int col;
+    int len;
+    const char* text;
+} DrawSpan;
+
+typedef struct {
+    DrawSpan* spans;
+    int count;
+    int capacity;
+} DrawList;
+
+// Draw state handed from the simulation to the render thread.
+typedef struct {
+    FrameSprite* sprites;
+    int sprite_count;
+    int sprite_capacity;
+    const char* username;
+    int level_nr;
+    int hp;
+    int stars_collected;
+    int star_quota;
+    int game_speed;
+    int score;
+    float time_left;
+    float albatross_cooldown;
+    float rewind_seconds;
+    char practice;
+    char playing;
+    int playback_multiplier;
+    int desynced;
+    unsigned int desync_tick;
+    // Performance overlay, only captured while it is shown.
+    char perf_visible;
+    float tick_avg_us;
+    float tick_p99_us;
+    float drift_ms;
+    int hunter_count;
+    int star_count;
+    float cells_per_tick;
+    float allocs_per_tick;
+    uint64_t mem_live;
+    uint64_t mem_peak;
+    // Filled in by the render thread just before drawing.
+    int bytes_per_frame;
+    char low_bandwidth;
+    unsigned int dropped_frames;
+    float render_us;
+    float flush_us;
+    uint64_t output_total;
+    // Sequence number given by render_publish(), matched against key stamps.
+    uint32_t seq;
+} Frame;
+
+/*
+ * Triple buffer between the simulation (writes frames[back]) and the render
+ * thread (draws frames[front]); frames[ready] is the newest published frame.
+ * The lock only guards index swaps, never drawing.
+ */
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    Frame frames[RENDER_BUFFERS];
+    int back;
+    int ready;
+    int front;
+    int fresh;
+    int quit;
+    const WIN* main_win;
+    const WIN* status_win;
+    DrawList draw_list;
+    // Low-bandwidth mode: bytes over budget still to be paid off by skipping.
+    char low_bandwidth;
+    int64_t byte_debt;
+    uint64_t last_bytes;
+    int bytes_per_frame;
+    unsigned int dropped_frames;
+    // Running averages of compose and doupdate() time; output count at the start.
+    float render_us;
+    float flush_us;
+    uint64_t start_bytes;
+    // Frames published so far.
+    uint32_t published;
+    // Set when the terminal was resized: the next frame repaints every cell.
+    char repaint;
+} Renderer;
+
+/*
+ * Timings of the last PERF_WINDOW_TICKS simulated ticks (a ring indexed by
+ * next) and the simulated time so far, against which wall time drifts when
+ * ticks or frames fall behind their schedule.
+ */
+typedef struct {
+    char visible;
+    uint32_t tick_ns[PERF_WINDOW_TICKS];
+    uint32_t tick_cells[PERF_WINDOW_TICKS];
+    uint32_t tick_allocs[PERF_WINDOW_TICKS];
+    int count;
+    int next;
+    uint64_t start_us;
+    uint64_t last_us;
+    uint64_t sim_us;
+    unsigned int paced_us;
+    uint64_t last_writes;
+    uint64_t last_allocs;
+} PerfStats;
+
+// A key read from the terminal, waiting for frame @seq to reach the screen.
+typedef struct {
+    uint32_t seq;
+    uint64_t read_us;
+} KeyStamp;
+
+/*
+ * Input-to-photon latency of the current session in LATENCY_BUCKET_US wide
+ * buckets (the last one also takes everything slower), and the summaries of
+ * the sessions played so far.
+ */
+typedef struct {
+    KeyStamp pending[LATENCY_PENDING_KEYS];
+    int pending_count;
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t keys;
+    uint64_t total_us;
+    uint64_t max_us;
+    int sessions;
+    ByteBuffer report;
+} LatencyStats;
+
+typedef enum {
+    VERIFY_OK,
+    VERIFY_NO_REPLAY,
+    VERIFY_BAD_REPLAY,
+    VERIFY_WRONG_PLAYER,
+    VERIFY_DESYNC,
+    VERIFY_WRONG_SCORE
+} VerifyStatus;
+
+// What events_wait() can wait for and report.
+typedef enum { EVENT_INPUT = 1, EVENT_TICK = 2, EVENT_RESIZE = 4 } EventMask;
+
+/*
+ * Waits on stdin, a periodic tick timer and terminal resizes at once. The
+ * timer is a timerfd where there is one; elsewhere its next deadline
+ * becomes the poll() timeout.
+ */
+typedef struct {
+    int timer_fd;
+    unsigned int interval_us;
+    uint64_t deadline_us;
+} EventLoop;
+
+// The albatross taxi flies the swallow across the arena, one frame per tick.
+typedef struct {
+    char active;
+    int frame;
+    int from_x;
+    int from_y;
+    int to_x;
+    int to_y;
+} AlbatrossTaxi;
+
+// An entity as a spectator knows it, with its own copy of the sprite grid.
+typedef struct {
+    uint32_t id;
+    FrameSprite sprite;
+    char* text;
+    size_t text_cap;
+} SpectatorEntity;
+
+typedef struct {
+    SpectatorEntity* entities;
+    int count;
+    int capacity;
+    uint64_t status[SPECTATE_STATUS_FIELDS];
+    char username[MAX_USERNAME_LENGTH];
+    int window_width;
+    int window_height;
+    int level_nr;
+    int star_quota;
+    char practice;
+    WIN main_win;
+    WIN status_win;
+    Frame frame;
+    DrawList draw_list;
+    ByteBuffer record;
+    uint64_t read_pos;
+    char synced;
+} Spectator;
+
+// What a bot sees each tick. Everything points into the game and is read-only.
+typedef struct {
+    unsigned int tick;
+    int arena_rows;
+    int arena_cols;
+    const entity_t* swallow;
+    int hp;
+    const Hunter* hunters;
+    const Star* stars;
+    const OccupancyMap* occupancy_map;
+    int stars_collected;
+    int star_quota;
+    int game_speed;
+    float time_left;
+    float albatross_cooldown;
+    char taxi_active;
+} BotView;
+
+typedef void* (*BotInitFn)(int seed);
+typedef int (*BotKeyFn)(const BotView* view, void* state);
+typedef void (*BotFreeFn)(void* state);
+
+/*
+ * A loaded bot plug-in: a shared object exporting swallow_bot_api (set to
+ * BOT_API_VERSION) and swallow_bot_key. swallow_bot_init and swallow_bot_free
+ * are optional and manage per-game state, since a tournament has one bot
+ * playing many games at once.
+ */
+typedef struct {
+    char* name;
+    void* handle;
+    BotInitFn init;
+    BotKeyFn key;
+    BotFreeFn free;
+} BotPlugin;
+
+typedef void (*PoolTask)(void* ctx, int index);
+
+/*
+ * Worker threads that run batches of indexed tasks. The thread calling
+ * pool_run() works on the batch too; indices are handed out one at a time
+ * from an atomic counter, so uneven tasks still keep every thread busy.
+ */
+typedef struct {
+    pthread_t* threads;
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    PoolTask task;
+    void* ctx;
+    int count;
+    _Atomic int next;
+    int busy;
+    unsigned int generation;
+    int quit;
+} Pool;
+
+typedef struct {
+    int score;
+    int result;
+    int stars_collected;
+    int hp;
+    unsigned int ticks;
+    float time_left;
+} HeadlessResult;
+
+// Command line options shared by the headless modes.
+typedef struct {
+    const char* policy;
+    int seeds;
+    int threads;
+    int preview;
+} HeadlessOptions;
+
+typedef struct {
+    char* name;
+    conf_t config;
+} TournamentLevel;
+
+// One swept config key and the values it takes, in order.
+typedef struct {
+    char* name;
+    double* values;
+    int count;
+} SweepParam;
+
+// Cached outcome of one (level hash, parameters, seed, policy) game.
+typedef struct {
+    uint64_t key;
+    HeadlessResult result;
+} SweepCacheEntry;
+
+typedef struct {
+    uint32_t point;
+    int seed;
+} SweepJob;
+
+/*
+ * A parameter sweep: the grid of points is every combination of the param
+ * values, the first param varying slowest. Results are indexed by
+ * point * seeds + seed; only games missing from the cache are played.
+ */
+typedef struct {
+    SweepParam* params;
+    int param_count;
+    const char* level_data;
+    size_t level_size;
+    int point_count;
+    int seeds;
+    conf_t* configs;
+    uint64_t* level_hashes;
+    BotPlugin policy;
+    SweepCacheEntry* cache;
+    int cache_count;
+    HeadlessResult* results;
+    SweepJob* jobs;
+    int job_count;
+} Sweep;
+
+typedef enum {
+    HEAT_PRESENCE,
+    HEAT_HP_LOSS,
+    HEAT_STAR_PICKUP,
+    HEAT_HUNTERS,
+    HEAT_LAYERS
+} HeatLayer;
+
+/*
+ * Per-cell counters for one level, HEAT_LAYERS planes of rows * cols cells.
+ * Presence and hunters count every cell an entity covers per tick; hp loss
+ * and star pickups count the swallow's centre cell once per event.
+ */
+typedef struct {
+    uint64_t level_hash;
+    int level_nr;
+    int rows;
+    int cols;
+    int replays;
+    uint64_t ticks;
+    uint32_t* cells;
+} Heatmap;
+
+// On disk a header is followed by the cell planes, in HeatLayer order, row-major.
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t level_nr;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t replays;
+    uint64_t level_hash;
+    uint64_t ticks;
+} HeatmapFileHeader;
+
+// Each replay fills its own partial; they are summed per level once all are done.
+typedef struct {
+    char** paths;
+    int count;
+    Heatmap* partials;
+} HeatmapJob;
+
+// One terminal cell of an exported recording; blank cells always use the default pen.
+typedef struct {
+    uint16_t ch;
+    uint8_t color;
+    uint8_t bold;
+} CastCell;
+
+/*
+ * Screen model of an asciicast export: frames are drawn into `cells` and only
+ * the cells that differ from `shown` (what the player's terminal holds) are
+ * written, as one output event per frame.
+ */
+typedef struct {
+    FILE* file;
+    int rows;
+    int cols;
+    CastCell* cells;
+    CastCell* shown;
+    int pen;
+    Frame frame;
+    DrawList list;
+    ByteBuffer out;
+} CastWriter;
+
+typedef enum { TRAJ_I32, TRAJ_U32, TRAJ_U8, TRAJ_F32 } TrajectoryType;
+
+/*
+ * Columns of a trajectory file. Tick columns have one value per tick; the
+ * two offset columns have ticks + 1 entries, and the hunters (stars) alive
+ * at the end of tick t are rows offsets[t] to offsets[t + 1] - 1 of the
+ * hunter (star) columns.
+ */
+typedef enum {
+    TRAJ_TICK,
+    TRAJ_KEY,
+    TRAJ_SWALLOW_X,
+    TRAJ_SWALLOW_Y,
+    TRAJ_SWALLOW_HP,
+    TRAJ_SWALLOW_DIR,
+    TRAJ_SCORE,
+    TRAJ_STARS_COLLECTED,
+    TRAJ_TIME_LEFT,
+    TRAJ_HUNTER_OFFSETS,
+    TRAJ_STAR_OFFSETS,
+    TRAJ_HUNTER_ID,
+    TRAJ_HUNTER_X,
+    TRAJ_HUNTER_Y,
+    TRAJ_HUNTER_DIR,
+    TRAJ_HUNTER_STATE,
+    TRAJ_HUNTER_TEMPLATE,
+    TRAJ_STAR_ID,
+    TRAJ_STAR_X,
+    TRAJ_STAR_Y,
+    TRAJ_COLUMNS
+} TrajectoryColumn;
+
+typedef struct {
+    const char* name;
+    TrajectoryType type;
+    uint32_t width;
+} TrajectoryColumnInfo;
+
+/*
+ * On disk: this header, column_count descriptors, then every column as one
+ * contiguous array in host byte order, each starting TRAJECTORY_ALIGN-aligned
+ * at the descriptor's offset so a mapped file can be used in place.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t column_count;
+    uint32_t ticks;
+    uint64_t hunter_rows;
+    uint64_t star_rows;
+    uint64_t level_hash;
+    int32_t level_nr;
+    int32_t seed;
+} TrajectoryFileHeader;
+
+typedef struct {
+    char name[TRAJECTORY_NAME_LENGTH];
+    uint32_t type;
+    uint32_t width;
+    uint64_t count;
+    uint64_t offset;
+} TrajectoryColumnDesc;
+
+// Writes the export of one replay; returns 0 on success, -1 on failure.
+typedef int (*ReplayExportFn)(const char* replay_path, const char* out_path);
+
+// Replays exported in parallel, each into DIR/NAME.EXT.
+typedef struct {
+    char** replays;
+    int count;
+    int* failed;
+    ReplayExportFn export_fn;
+    const char* dir;
+    const char* ext;
+} ReplayExportJob;
+
+// Every bot plays every level with every seed; results are indexed in that order.
+typedef struct {
+    BotPlugin* bots;
+    int bot_count;
+    TournamentLevel* levels;
+    int level_count;
+    int seeds;
+    HeadlessResult* results;
+} Tournament;
+
 typedef struct {
     conf_t config;
     WIN main_win;
@@ -203,29 +1032,94 @@ typedef struct {
     char running;
     char menu_running;
     replay_t replay;
+    char practice;
+    char low_bandwidth;
+    Rewind rewind;
+    Renderer renderer;
+    PerfStats perf;
+    LatencyStats latency;
+    EventLoop events;
+    Broadcast broadcast;
+    const BotPlugin* bot;
+    void* bot_state;
     char result;
-    char** occupancy_map;
+    OccupancyMap occupancy_map;
+    int arena_rows;
+    int arena_cols;
+    int camera_x;
+    int camera_y;
     char* username;
     float time_left;
     float albatross_cooldown;
+    AlbatrossTaxi taxi;
     int game_speed;
+    int playback_multiplier;
+    uint64_t last_render_us;
     int stars_collected;
     int hunter_spawn_tick;
     int star_spawn_tick;
     int star_move_tick;
     int star_flicker_tick;
     int score;
+    // Why the last recorded game's score was not ranked, VERIFY_OK if it was.
+    VerifyStatus ranking_status;
+    // Last key applied during the last simulated tick, ERR if there was none.
+    int tick_key;
+    uint64_t state_hash;
+    uint64_t rng_state;
+    uint32_t next_entity_id;
     GameEntities entities;
 } Game;
 
+/*
+ * Caller-owned output arrays of batch_step(), one entry per environment
+ * (grids: grid_rows * grid_cols cells per environment, row-major, each a
+ * collision_t). Values describe the state the next input applies to, so
+ * after an automatic reset they belong to the new episode; done and
+ * final_score report the episode that just ended.
+ */
+typedef struct {
+    unsigned char* grids;
+    int* hp;
+    float* time_left;
+    int* stars;
+    unsigned char* done;
+    int* final_score;
+} BatchObservation;
+
+// N independent games of one level, stepped together on a thread pool.
+typedef struct {
+    conf_t config;
+    Game* games;
+    int count;
+    int* keys;
+    int* episodes;
+    BotPlugin input;
+    Pool pool;
+    int grid_rows;
+    int grid_cols;
+    const int* step_keys;
+    BatchObservation* obs;
+} Batch;
+
+// replay_id is the library replay the score was verified against, 0 for none.
 typedef struct RankingNode {
     int score;
     char username[MAX_USERNAME_LENGTH];
+    uint32_t replay_id;
     struct RankingNode* next;
 } RankingNode;
 
+typedef struct {
+    const RankingNode* entry;
+    VerifyStatus status;
+    int replayed_score;
+    unsigned int ticks;
+} RankingCheck;
+
 typedef enum {
     MENU_START_GAME,
+    MENU_PRACTICE,
     MENU_REPLAY,
     MENU_HIGH_SCORES,
     MENU_USERNAME,
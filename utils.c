@@ -1,10 +1,14 @@
 #include <dirent.h>
 #include <ncurses.h>
+#include <poll.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "physics.h"
 #include "types.h"
 #include "utils.h"
 
@@ -15,49 +19,44 @@ void strip_newline(char* str) {
     }
 }
 
+// xterm-256 foreground of every colour pair; all pairs use the default background.
+static const short pair_colors[] = {
+        [C_RED_1] = 52,     [C_RED_2] = 88,     [C_RED_3] = 124,     [C_RED_4] = 160,
+        [C_RED_5] = 196,
+
+        [C_GREEN_1] = 22,   [C_GREEN_2] = 28,   [C_GREEN_3] = 34,    [C_GREEN_4] = 40,
+        [C_GREEN_5] = 46,
+
+        [C_BLUE_1] = 17,    [C_BLUE_2] = 21,    [C_BLUE_3] = 27,     [C_BLUE_4] = 33,
+        [C_BLUE_5] = 51,
+
+        [C_YELLOW_1] = 94,  [C_YELLOW_2] = 130, [C_YELLOW_3] = 172,  [C_YELLOW_4] = 214,
+        [C_YELLOW_5] = 226,
+
+        [C_PURPLE_1] = 53,  [C_PURPLE_2] = 90,  [C_PURPLE_3] = 127,  [C_PURPLE_4] = 163,
+        [C_PURPLE_5] = 201,
+
+        [C_CYAN_1] = 23,    [C_CYAN_2] = 30,    [C_CYAN_3] = 37,     [C_CYAN_4] = 44,
+        [C_CYAN_5] = 51,
+
+        [C_GREY_1] = 240,   [C_GREY_2] = 250,   [PAIR_PLAYER] = 51,  [PAIR_DEFAULT] = 255,
+};
+
+/**
+ * pair_color - Looks up the terminal colour of a colour pair
+ * @pair: the colour pair
+ *
+ * RETURNS
+ * The xterm-256 foreground colour index of @pair.
+ */
+int pair_color(const ColorPair pair) {
+    return pair_colors[pair];
+}
+
 static void init_game_colors() {
-    init_pair(C_RED_1, 52, -1);
-    init_pair(C_RED_2, 88, -1);
-    init_pair(C_RED_3, 124, -1);
-    init_pair(C_RED_4, 160, -1);
-    init_pair(C_RED_5, 196, -1);
-
-    init_pair(C_GREEN_1, 22, -1);
-    init_pair(C_GREEN_2, 28, -1);
-    init_pair(C_GREEN_3, 34, -1);
-    init_pair(C_GREEN_4, 40, -1);
-    init_pair(C_GREEN_5, 46, -1);
-
-    init_pair(C_BLUE_1, 17, -1);
-    init_pair(C_BLUE_2, 21, -1);
-    init_pair(C_BLUE_3, 27, -1);
-    init_pair(C_BLUE_4, 33, -1);
-    init_pair(C_BLUE_5, 51, -1);
-
-    init_pair(C_YELLOW_1, 94, -1);
-    init_pair(C_YELLOW_2, 130, -1);
-    init_pair(C_YELLOW_3, 172, -1);
-    init_pair(C_YELLOW_4, 214, -1);
-    init_pair(C_YELLOW_5, 226, -1);
-
-    init_pair(C_PURPLE_1, 53, -1);
-    init_pair(C_PURPLE_2, 90, -1);
-    init_pair(C_PURPLE_3, 127, -1);
-    init_pair(C_PURPLE_4, 163, -1);
-    init_pair(C_PURPLE_5, 201, -1);
-
-    init_pair(C_CYAN_1, 23, -1);
-    init_pair(C_CYAN_2, 30, -1);
-    init_pair(C_CYAN_3, 37, -1);
-    init_pair(C_CYAN_4, 44, -1);
-    init_pair(C_CYAN_5, 51, -1);
-
-    init_pair(C_GREY_1, 240, -1);
-    init_pair(C_GREY_2, 250, -1);
-
-    init_pair(PAIR_PLAYER, 51, -1);
-
-    init_pair(PAIR_DEFAULT, 255, -1);
+    for (int pair = PAIR_DEFAULT; pair <= C_GREY_2; pair++) {
+        init_pair((short)pair, pair_colors[pair], -1);
+    }
 }
 
 void init_curses() {
@@ -80,7 +79,19 @@ void init_curses() {
     refresh();
 }
 
-void setup_windows(WIN* main_win, WIN* status_win, const conf_t* config) {
+/**
+ * size_windows - Lays out the game windows without creating them
+ * @main_win: arena window
+ * @status_win: status window
+ * @config: level configuration
+ *
+ * Headless games need the viewport size to size the arena the same way an
+ * interactive game would.
+ *
+ * RETURNS
+ * Void.
+ */
+void size_windows(WIN* main_win, WIN* status_win, const conf_t* config) {
     const int game_area_height = config->window_height;
     const int game_area_width = config->window_width;
 
@@ -88,12 +99,16 @@ void setup_windows(WIN* main_win, WIN* status_win, const conf_t* config) {
     main_win->cols = game_area_width;
     main_win->y = 0;
     main_win->x = 0;
-    main_win->window = newwin(main_win->rows, main_win->cols, main_win->y, main_win->x);
 
     status_win->rows = game_area_height - main_win->rows;
     status_win->cols = game_area_width;
     status_win->y = main_win->rows;
     status_win->x = 0;
+}
+
+void setup_windows(WIN* main_win, WIN* status_win, const conf_t* config) {
+    size_windows(main_win, status_win, config);
+    main_win->window = newwin(main_win->rows, main_win->cols, main_win->y, main_win->x);
     status_win->window = newwin(status_win->rows, status_win->cols, status_win->y, status_win->x);
 
     wrefresh(main_win->window);
@@ -126,45 +141,11 @@ void setup_menu_window(WIN* menu_win) {
 }
 
 void free_occupancy_map(Game* game) {
-    if (game->occupancy_map != NULL) {
-        const int rows = game->main_win.rows;
-        for (int y = 0; y < rows; y++) {
-            free(game->occupancy_map[y]);
-        }
-        free((void*)game->occupancy_map);
-        game->occupancy_map = NULL;
-    }
+    occupancy_free(&game->occupancy_map);
 }
 
 void init_occupancy_map(Game* game) {
-    const int rows = game->main_win.rows;
-    const int cols = game->main_win.cols;
-
-    game->occupancy_map = (char**)calloc(rows, sizeof(char*));
-
-    if (game->occupancy_map == NULL) {
-        endwin();
-        exit(1);
-    }
-
-    for (int y = 0; y < rows; y++) {
-        game->occupancy_map[y] = (char*)malloc(cols * sizeof(char));
-        if (game->occupancy_map[y] == NULL) {
-            endwin();
-            free_occupancy_map(game);
-            exit(1);
-        }
-    }
-
-    for (int y = 0; y < rows; y++) {
-        for (int x = 0; x < cols; x++) {
-            if (y == 0 || x == 0 || x == cols - 1 || y == rows - 1) {
-                game->occupancy_map[y][x] = WALL;
-            } else {
-                game->occupancy_map[y][x] = EMPTY;
-            }
-        }
-    }
+    occupancy_init(&game->occupancy_map, game->arena_rows, game->arena_cols);
 }
 
 void change_game_speed(Game* game, increment_t increment) {
@@ -205,3 +186,235 @@ int load_levels(char*** files) {
     }
     return count;
 }
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/**
+ * list_files - Lists the files in a directory with a given suffix
+ * @dir: directory to list
+ * @suffix: file name ending to match, e.g. ".swr"
+ * @paths: receives a heap array of "dir/name" paths, sorted by name
+ *
+ * RETURNS
+ * Number of paths, 0 if the directory cannot be read.
+ */
+int list_files(const char* dir, const char* suffix, char*** paths) {
+    DIR* d = opendir(dir);
+    const size_t suffix_len = strlen(suffix);
+    const struct dirent* entry = NULL;
+    int count = 0;
+
+    *paths = NULL;
+    if (!d) {
+        return 0;
+    }
+    while ((entry = readdir(d))) {
+        const size_t len = strlen(entry->d_name);
+        if (len < suffix_len || strcmp(entry->d_name + len - suffix_len, suffix) != 0) {
+            continue;
+        }
+        char** tmp = (char**)realloc((void*)*paths, sizeof(char*) * (size_t)(count + 1));
+        char* path = (char*)malloc(strlen(dir) + len + 2);
+        if (!tmp || !path) {
+            exit(1);
+        }
+        sprintf(path, "%s/%s", dir, entry->d_name);
+        *paths = tmp;
+        (*paths)[count++] = path;
+    }
+    closedir(d);
+    qsort((void*)*paths, (size_t)count, sizeof(char*), compare_paths);
+    return count;
+}
+
+/**
+ * hash_bytes - 64-bit FNV-1a hash of a memory block
+ * @data: bytes to hash
+ * @size: number of bytes
+ *
+ * RETURNS
+ * The hash value.
+ */
+uint64_t hash_bytes(const void* data, const size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * read_file_contents - loads a whole file into memory
+ * @path: file to read
+ * @size: receives the number of bytes read
+ *
+ * The buffer is NUL-terminated so it can also be treated as a string.
+ *
+ * RETURNS
+ * Heap buffer owned by the caller, or NULL if the file cannot be read.
+ */
+char* read_file_contents(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+
+    char* buffer = NULL;
+    size_t len = 0;
+    char chunk[MAX_LINE_LENGTH];
+    size_t got = 0;
+
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        char* new_ptr = (char*)realloc(buffer, len + got + 1);
+        if (!new_ptr) {
+            free(buffer);
+            fclose(file);
+            return NULL;
+        }
+        buffer = new_ptr;
+        memcpy(buffer + len, chunk, got);
+        len += got;
+    }
+    fclose(file);
+
+    if (buffer == NULL) {
+        buffer = (char*)calloc(1, 1);
+    } else {
+        buffer[len] = '\0';
+    }
+    *size = len;
+    return buffer;
+}
+
+uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + ((uint64_t)ts.tv_nsec / 1000ULL);
+}
+
+uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * seed_game_rand - seeds the game's private random number generator
+ * @game: Main game struct
+ * @seed: level seed
+ *
+ * The simulation uses its own xorshift64* generator instead of rand(), so its
+ * state can be saved in snapshots and independent games can run side by side.
+ *
+ * RETURNS
+ * Void.
+ */
+void seed_game_rand(Game* game, const int seed) {
+    game->rng_state = ((uint64_t)(uint32_t)seed * RNG_SEED_MULTIPLIER) + 1;
+    if (game->rng_state == 0) {
+        game->rng_state = 1;
+    }
+}
+
+int game_rand(Game* game) {
+    uint64_t x = game->rng_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    game->rng_state = x;
+    return (int)((x * RNG_OUTPUT_MULTIPLIER) >> 33);
+}
+
+static int read_pending_byte(void) {
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    unsigned char ch = 0;
+    if (poll(&pfd, 1, 0) <= 0 || read(STDIN_FILENO, &ch, 1) != 1) {
+        return ERR;
+    }
+    return ch;
+}
+
+/*
+ * Escape sequences may arrive split over several reads, so the parser's
+ * position in one is kept between calls; otherwise the tail of an arrow key
+ * would come back as ordinary keys ("ESC [ D" as a 'D').
+ */
+static KeyParseState key_parse = KEY_PARSE_TEXT;
+
+static int parse_key_byte(const int byte) {
+    switch (key_parse) {
+        case KEY_PARSE_TEXT:
+            if (byte != KEY_ESCAPE) {
+                return byte;
+            }
+            key_parse = KEY_PARSE_ESCAPE;
+            break;
+        case KEY_PARSE_ESCAPE:
+            // CSI and SS3 run up to a final byte; any other byte is dropped with the ESC.
+            key_parse = byte == '[' || byte == 'O' ? KEY_PARSE_SEQUENCE : KEY_PARSE_TEXT;
+            break;
+        case KEY_PARSE_SEQUENCE:
+            if (byte >= '@' && byte <= '~') {
+                key_parse = KEY_PARSE_TEXT;
+            }
+            break;
+    }
+    return ERR;
+}
+
+/**
+ * read_key - Reads one pending key straight from the terminal
+ *
+ * Used while the render thread owns ncurses, so getch() is off limits.
+ * Escape sequences (arrow and function keys) are consumed and ignored.
+ *
+ * RETURNS
+ * The key byte, or ERR if no key is pending.
+ */
+int read_key(void) {
+    int byte = read_pending_byte();
+    while (byte != ERR) {
+        const int key = parse_key_byte(byte);
+        if (key != ERR) {
+            return key;
+        }
+        byte = read_pending_byte();
+    }
+    return ERR;
+}
+
+/**
+ * read_keys - Reads every key already waiting on the terminal
+ * @keys: receives the keys, in the order they were typed
+ * @max: capacity of @keys
+ *
+ * Takes whatever the terminal has buffered with a single read() instead of
+ * one poll() and read() per byte. Escape sequences are dropped as in
+ * read_key(), including one split between this read and the next.
+ *
+ * RETURNS
+ * The number of keys stored.
+ */
+int read_keys(int* keys, const int max) {
+    struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+    unsigned char bytes[INPUT_DRAIN_MAX];
+    const size_t want = max < INPUT_DRAIN_MAX ? (size_t)max : INPUT_DRAIN_MAX;
+    if (want == 0 || poll(&pfd, 1, 0) <= 0) {
+        return 0;
+    }
+    const ssize_t got = read(STDIN_FILENO, bytes, want);
+
+    int count = 0;
+    for (ssize_t i = 0; i < got; i++) {
+        const int key = parse_key_byte(bytes[i]);
+        if (key != ERR) {
+            keys[count++] = key;
+        }
+    }
+    return count;
+}
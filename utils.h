@@ -5,7 +5,9 @@
 
 void strip_newline(char* str);
 void init_curses();
+int pair_color(ColorPair pair);
 
+void size_windows(WIN* main_win, WIN* status_win, const conf_t* config);
 void setup_windows(WIN* main_win, WIN* status_win, const conf_t* config);
 void setup_menu_window(WIN* menu_win);
 
@@ -15,5 +17,16 @@ void init_occupancy_map(Game* game);
 void change_game_speed(Game* game, increment_t increment);
 
 int load_levels(char*** files);
+int list_files(const char* dir, const char* suffix, char*** paths);
+
+uint64_t hash_bytes(const void* data, size_t size);
+char* read_file_contents(const char* path, size_t* size);
+uint64_t monotonic_us(void);
+uint64_t monotonic_ns(void);
+int read_key(void);
+int read_keys(int* keys, int max);
+
+void seed_game_rand(Game* game, int seed);
+int game_rand(Game* game);
 
 #endif  // UTILS_H
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "headless.h"
+#include "pool.h"
+#include "ranking.h"
+#include "replay.h"
+#include "replay_index.h"
+#include "types.h"
+#include "utils.h"
+#include "verify.h"
+
+/*
+ * A ranked score is only trusted if its replay, re-simulated from the level
+ * and seed stored in it, ends with that score. Playback runs headless like a
+ * tournament game, so whole ranking files are checked at simulation speed and
+ * in parallel.
+ */
+
+static VerifyStatus replay_claim(Game* game, const RankingNode* entry) {
+    if (entry->replay_id == 0) {
+        return VERIFY_NO_REPLAY;
+    }
+    char path[MAX_LINE_LENGTH];
+    replay_path_for_id(entry->replay_id, path, sizeof(path));
+    if (replay_open(&game->replay, path) != 0) {
+        return VERIFY_BAD_REPLAY;
+    }
+    if (strncmp(game->replay.header.username, entry->username, MAX_USERNAME_LENGTH) != 0) {
+        return VERIFY_WRONG_PLAYER;
+    }
+
+    headless_playback_start(game);
+    while (game->running) {
+        simulate_tick(game);
+    }
+    const int desynced =
+            game->replay.desynced || game->replay.tick != game->replay.header.ticks;
+    headless_playback_finish(game);
+
+    if (desynced) {
+        return VERIFY_DESYNC;
+    }
+    return game->score == entry->score ? VERIFY_OK : VERIFY_WRONG_SCORE;
+}
+
+/**
+ * verify_ranking - Re-simulates the replay behind a ranking entry
+ * @check: entry to check; receives the status, replayed score and tick count
+ *
+ * The replay must belong to the entry's player, play back without a
+ * checksum mismatch for exactly as many ticks as were recorded, and end
+ * with the entry's score.
+ *
+ * RETURNS
+ * Void.
+ */
+void verify_ranking(RankingCheck* check) {
+    Game game = {0};
+    game.replay.fd = -1;
+    game.replay.replay_state = REPLAY_OFF;
+
+    check->status = replay_claim(&game, check->entry);
+    check->replayed_score = game.score;
+    check->ticks = game.replay.tick;
+    replay_free(&game.replay);
+}
+
+const char* verify_status_name(const VerifyStatus status) {
+    switch (status) {
+        case VERIFY_OK:
+            return "ok";
+        case VERIFY_NO_REPLAY:
+            return "no replay";
+        case VERIFY_BAD_REPLAY:
+            return "replay missing or corrupt";
+        case VERIFY_WRONG_PLAYER:
+            return "replay of another player";
+        case VERIFY_DESYNC:
+            return "replay desyncs";
+        case VERIFY_WRONG_SCORE:
+            return "score does not match replay";
+    }
+    return "unknown";
+}
+
+static void verify_task(void* ctx, const int index) {
+    verify_ranking(&((RankingCheck*)ctx)[index]);
+}
+
+static int report_checks(const RankingCheck* checks, const int count) {
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        const RankingCheck* check = &checks[i];
+        if (check->status == VERIFY_OK) {
+            continue;
+        }
+        failed++;
+        printf("#%-4d %-20s %8d  replay %-6u %s", i + 1, check->entry->username,
+               check->entry->score, (unsigned int)check->entry->replay_id,
+               verify_status_name(check->status));
+        if (check->status == VERIFY_WRONG_SCORE) {
+            printf(" (replay scores %d)", check->replayed_score);
+        }
+        printf("\n");
+    }
+    return failed;
+}
+
+/**
+ * run_verify_rankings - Re-verifies every entry of the ranking file
+ * @threads: threads to replay on, 0 for one per core
+ *
+ * RETURNS
+ * The process exit status: 0 if every entry is backed by its replay, 1 otherwise.
+ */
+int run_verify_rankings(int threads) {
+    RankingNode* head = load_rankings();
+    int count = 0;
+    for (const RankingNode* node = head; node; node = node->next) {
+        count++;
+    }
+
+    RankingCheck* checks = (RankingCheck*)calloc((size_t)count + 1, sizeof(RankingCheck));
+    if (!checks) {
+        exit(1);
+    }
+    int i = 0;
+    for (const RankingNode* node = head; node; node = node->next) {
+        checks[i++].entry = node;
+    }
+    threads = threads > 0 ? threads : pool_default_threads();
+
+    Pool pool;
+    pool_start(&pool, threads);
+    const uint64_t start = monotonic_us();
+    pool_run(&pool, verify_task, checks, count);
+    const uint64_t elapsed = monotonic_us() - start;
+    pool_stop(&pool);
+
+    const int failed = report_checks(checks, count);
+    uint64_t ticks = 0;
+    for (i = 0; i < count; i++) {
+        ticks += checks[i].ticks;
+    }
+    const double seconds = elapsed > 0 ? (double)elapsed / 1000000.0 : 1e-6;
+    printf("%d of %d ranked scores verified, %llu ticks replayed in %.2f s on %d threads\n",
+           count - failed, count, (unsigned long long)ticks, seconds, threads);
+
+    free(checks);
+    free_rankings(head);
+    return failed > 0;
+}
@@ -0,0 +1,10 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "types.h"
+
+void verify_ranking(RankingCheck* check);
+const char* verify_status_name(VerifyStatus status);
+int run_verify_rankings(int threads);
+
+#endif  // VERIFY_H